@@ -0,0 +1,126 @@
+//// Afinidade de threads e nós NUMA //////////////////////////////////////////
+
+// Veja afinidade.h.
+
+#include <fstream>
+#include <sstream>
+#include <pthread.h>
+#include <sched.h>
+
+#include "afinidade.h"
+
+using namespace std;
+
+// Maior nó NUMA procurado em /sys/devices/system/node.
+static const int MAX_NOS = 1024;
+
+int Topologia::nucleos() const {
+  int n = 0;
+  for (size_t i=0; i<nos.size(); i++) {
+    n += nos[i].size();
+  }
+  return n;
+}
+
+// Lê uma lista de núcleos no formato do *sysfs* ("0-3,8,10-11"),
+// só com os núcleos que estão em *permitidos*.
+static vector<int> le_lista(const string &lista, const cpu_set_t &permitidos) {
+  vector<int> cpus;
+  istringstream s(lista);
+  string faixa;
+  int de, ate, c;
+  char traco;
+
+  while (getline(s, faixa, ',')) {
+    istringstream f(faixa);
+    if (!(f >> de)) {
+      continue;
+    }
+    ate = de;
+    if (f >> traco && traco == '-' && !(f >> ate)) {
+      ate = de;
+    }
+    for (c=de; c<=ate && c<CPU_SETSIZE; c++) {
+      if (CPU_ISSET(c, &permitidos)) {
+        cpus.push_back(c);
+      }
+    }
+  }
+  return cpus;
+}
+
+Topologia le_topologia() {
+  Topologia topologia;
+  cpu_set_t permitidos;
+  vector<int> todos;
+  int no, c, faltas = 0;
+
+  if (sched_getaffinity(0, sizeof(permitidos), &permitidos) != 0) {
+    CPU_ZERO(&permitidos);
+    CPU_SET(0, &permitidos);
+  }
+  // Os nós podem ter números esparsos (um nó sem memória some), então
+  // só paramos depois de várias ausências seguidas.
+  for (no=0; no<MAX_NOS && faltas<64; no++) {
+    ostringstream nome;
+    nome << "/sys/devices/system/node/node" << no << "/cpulist";
+    ifstream arquivo(nome.str().c_str());
+    string lista;
+
+    if (!getline(arquivo, lista)) {
+      faltas++;
+      continue;
+    }
+    faltas = 0;
+    vector<int> cpus = le_lista(lista, permitidos);
+    if (!cpus.empty()) {
+      topologia.nos.push_back(cpus);
+    }
+  }
+  if (topologia.nos.empty()) {
+    for (c=0; c<CPU_SETSIZE; c++) {
+      if (CPU_ISSET(c, &permitidos)) {
+        todos.push_back(c);
+      }
+    }
+    topologia.nos.push_back(todos);
+  }
+  return topologia;
+}
+
+bool le_afinidade(const string &nome, Afinidade *afinidade) {
+  if (nome == "nao") {
+    *afinidade = AFINIDADE_NENHUMA;
+  } else if (nome == "cpu") {
+    *afinidade = AFINIDADE_CPU;
+  } else if (nome == "no") {
+    *afinidade = AFINIDADE_NO;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+int fixa_thread(const Topologia &topologia, Afinidade afinidade, int t) {
+  int n = topologia.nos.size(), no = t % n;
+  const vector<int> &cpus = topologia.nos[no];
+  cpu_set_t conjunto;
+  size_t i;
+
+  if (afinidade == AFINIDADE_NENHUMA) {
+    return 0;
+  }
+  CPU_ZERO(&conjunto);
+  if (afinidade == AFINIDADE_CPU) {
+    CPU_SET(cpus[(t / n) % cpus.size()], &conjunto);
+  } else {
+    for (i=0; i<cpus.size(); i++) {
+      CPU_SET(cpus[i], &conjunto);
+    }
+  }
+  if (pthread_setaffinity_np(pthread_self(), sizeof(conjunto),
+                             &conjunto) != 0) {
+    return -1;
+  }
+  return no;
+}
@@ -0,0 +1,51 @@
+#ifndef _AFINIDADE_H_
+#define _AFINIDADE_H_
+
+//// Afinidade de threads e nós NUMA //////////////////////////////////////////
+
+// Em máquinas com mais de um soquete, a memória é dividida em nós NUMA:
+// cada núcleo acessa a memória do seu nó bem mais rápido que a dos
+// outros. Uma *thread* que o sistema migra de soquete continua usando
+// a tabela de transposição que ficou no nó antigo, e cada consulta
+// atravessa a interconexão.
+//
+// Para evitar isso, as *threads* da busca em lote (veja lote.h) podem
+// ser fixadas em um núcleo ou em um nó. Como o Linux coloca cada página
+// no nó da *thread* que a toca primeiro (*first touch*), basta que cada
+// *thread* se fixe antes de criar e zerar a sua tabela para que ela
+// fique toda na memória local.
+//
+// A topologia é lida de /sys/devices/system/node, sem depender da
+// libnuma; sem essa informação (ou fora do Linux), tudo vira um nó só.
+// Só contam os núcleos que o processo pode usar (por exemplo, dentro
+// de um *taskset* ou de um *cgroup*).
+
+#include <vector>
+#include <string>
+
+enum Afinidade {
+  AFINIDADE_NENHUMA,  // o sistema escolhe (padrão)
+  AFINIDADE_CPU,      // cada thread fixa em um núcleo
+  AFINIDADE_NO        // cada thread fixa nos núcleos de um nó NUMA
+};
+
+// Núcleos de cada nó NUMA (só os nós com algum núcleo utilizável).
+struct Topologia {
+  std::vector<std::vector<int> > nos;
+
+  int nucleos() const;
+};
+
+Topologia le_topologia();
+
+// Lê o nome de uma afinidade ("nao", "cpu" ou "no"); retorna *false*
+// se o nome for desconhecido.
+bool le_afinidade(const std::string &nome, Afinidade *afinidade);
+
+// Fixa a *thread* número *t* conforme a afinidade. As *threads* são
+// espalhadas entre os nós (a 0 no primeiro, a 1 no segundo...) e, no
+// modo CPU, entre os núcleos de cada nó. Retorna o nó escolhido (0 sem
+// afinidade) ou -1 se o sistema recusar.
+int fixa_thread(const Topologia &topologia, Afinidade afinidade, int t);
+
+#endif /* _AFINIDADE_H_ */
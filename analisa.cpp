@@ -0,0 +1,182 @@
+//// Análise de posições em lote //////////////////////////////////////////////
+
+// O *analisa* busca muitas posições de uma vez com a busca em lote
+// (veja lote.h), para anotar conjuntos de dados. Cada linha da entrada
+// é uma posição no formato de *le_posicao()*, seguida, se quiser, dos
+// limites daquela posição, como no *go* do servidor:
+//
+//     0 --------/--------/--------/---10---/---01---/--------/--------/-------- depth 6
+//
+// Para cada linha, na mesma ordem, escreve
+//
+//     <linha> <coluna> <ganho> <nivel> <nos>
+//
+// com a jogada nas coordenadas do arquivo de jogadas ("pass" quando não
+// há jogada). Ao final, mostra a vazão do lote na saída de erro, com a
+// porcentagem de acertos nas consultas às tabelas de transposição e de
+// colisões ao guardar (posições descartadas para dar lugar a outras).
+//
+// Uso:
+//
+//     $ ./analisa [-d nivel] [-m ms] [-n nos] [-j threads] [-T mb] [-C]
+//                 [-A afinidade] [-H] [-D] [entrada...]
+//
+// * -d, -m, -n: limites das posições que não trazem os seus (padrão:
+//   nível 6, sem prazo, sem limite de nós; "nodes N" na linha);
+// * -j: *threads* (padrão: número de núcleos);
+// * -T: tamanho em MB da tabela de transposição de cada *thread* (0:
+//   sem tabela);
+// * -C: uma tabela por nó NUMA, compartilhada pelas suas *threads*;
+// * -A: afinidade das *threads*: "nao" (padrão), "cpu" ou "no" (veja
+//   afinidade.h);
+// * -H: tabelas com páginas grandes;
+// * -D: modo determinístico (veja lote.h): a saída se repete em toda
+//   execução com o mesmo -j;
+// * entradas: arquivos de posições (padrão: a entrada padrão).
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+#include <unistd.h>
+
+#include "reversi.h"
+#include "lote.h"
+
+static void uso(const char *comando) {
+  cerr << "Uso: " << comando << " [-d nivel] [-m ms] [-n nos] [-j threads]"
+       << " [-T mb] [-C] [-A nao|cpu|no] [-H] [-D] [entrada...]\n";
+  exit(1);
+}
+
+// Lê as posições de uma entrada; retorna *false* na primeira linha
+// inválida, com a mensagem em *erro*.
+static bool le_pedidos(istream &entrada, const string &nome, int nivel,
+                       long tempo_ms, unsigned long long nos_max,
+                       vector<PedidoLote> *pedidos, string *erro) {
+  string linha, jogador, casas, chave;
+  int n = 0;
+
+  while (getline(entrada, linha)) {
+    istringstream campos(linha);
+    PedidoLote p;
+    bool ok = true;
+
+    n++;
+    if (!(campos >> jogador)) {
+      continue;
+    }
+    campos >> casas;
+    p.tabuleiro = le_posicao(jogador + " " + casas, &p.jogador);
+    p.nivel_max = nivel;
+    p.tempo_ms = tempo_ms;
+    p.nos_max = nos_max;
+    ok = p.tabuleiro != NULL;
+    while (ok && campos >> chave) {
+      if (chave == "depth") {
+        ok = !!(campos >> p.nivel_max);
+      } else if (chave == "movetime") {
+        ok = !!(campos >> p.tempo_ms);
+      } else if (chave == "nodes") {
+        ok = !!(campos >> p.nos_max);
+      } else {
+        ok = false;
+      }
+    }
+    if (!ok || (p.nivel_max <= 0 && p.tempo_ms <= 0 && p.nos_max == 0)) {
+      ostringstream s;
+      s << nome << ":" << n << ": linha inválida";
+      *erro = s.str();
+      if (p.tabuleiro != NULL) {
+        libera_tabuleiro(p.tabuleiro);
+      }
+      return false;
+    }
+    pedidos->push_back(p);
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  int nivel = 6, opcao, i;
+  long tempo_ms = 0;
+  unsigned long long nos_max = 0;
+  OpcoesLote opcoes;
+  EstatisticasLote estat;
+  vector<PedidoLote> pedidos;
+  vector<Resultado> resultados;
+  string erro;
+  bool ok = true;
+
+  while ((opcao = getopt(argc, argv, "d:m:n:j:T:CA:HD")) != -1) {
+    switch (opcao) {
+    case 'd': nivel = atoi(optarg); break;
+    case 'm': tempo_ms = atol(optarg); break;
+    case 'n': nos_max = strtoull(optarg, NULL, 10); break;
+    case 'j': opcoes.threads = atoi(optarg); break;
+    case 'T': opcoes.tabela_mb = atol(optarg); break;
+    case 'C': opcoes.compartilhada = true; break;
+    case 'A':
+      if (!le_afinidade(optarg, &opcoes.afinidade)) {
+        uso(argv[0]);
+      }
+      break;
+    case 'H': opcoes.paginas_grandes = true; break;
+    case 'D': opcoes.deterministica = true; break;
+    default: uso(argv[0]);
+    }
+  }
+  if (nivel < 0 || tempo_ms < 0 || opcoes.threads < 0) {
+    uso(argv[0]);
+  }
+
+  if (optind == argc) {
+    ok = le_pedidos(cin, "-", nivel, tempo_ms, nos_max, &pedidos, &erro);
+  }
+  for (i=optind; ok && i<argc; i++) {
+    ifstream entrada(argv[i]);
+    if (!entrada) {
+      erro = string(argv[i]) + ": não foi possível abrir";
+      ok = false;
+    } else {
+      ok = le_pedidos(entrada, argv[i], nivel, tempo_ms, nos_max, &pedidos,
+                      &erro);
+    }
+  }
+  if (!ok) {
+    cerr << erro << endl;
+    return 1;
+  }
+
+  resultados = busca_lote(pedidos, opcoes, &estat);
+  for (i=0; i<(int) pedidos.size(); i++) {
+    const Resultado &r = resultados[i];
+    int tam = (*pedidos[i].tabuleiro[0]).size() - 2;
+    if (r.pos.linha == -1) {
+      cout << "pass";
+    } else {
+      cout << tam - r.pos.linha << " " << r.pos.coluna - 1;
+    }
+    cout << " " << r.ganho << " " << r.nivel << " " << r.nos << "\n";
+    libera_tabuleiro(pedidos[i].tabuleiro);
+  }
+  cout.flush();
+
+  cerr << fixed << setprecision(2)
+       << estat.posicoes << " posições em " << estat.segundos << " s com "
+       << estat.threads << " threads: " << estat.posicoes_por_segundo()
+       << " posições/s, " << setprecision(0)
+       << (estat.segundos > 0 ? estat.nos / estat.segundos : 0)
+       << " nós/s (" << estat.tarefas << " tarefas, " << estat.roubos
+       << " roubos)" << endl;
+  if (estat.tabela.consultas > 0) {
+    cerr << setprecision(1) << "tabela: "
+         << 100.0 * estat.tabela.acertos / estat.tabela.consultas
+         << "% de acertos, "
+         << (estat.tabela.guardas == 0 ? 0.0 :
+             100.0 * estat.tabela.substituicoes / estat.tabela.guardas)
+         << "% de colisões" << endl;
+  }
+  return 0;
+}
@@ -0,0 +1,198 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+//// Arena e pool de objetos //////////////////////////////////////////////////
+
+// A busca precisa de memória temporária em cada nó (listas de jogadas,
+// ganhos, registros para desfazer jogadas). Em vez de pedir cada
+// pedaço ao alocador global, usamos uma *arena*: blocos grandes dos
+// quais a memória é cortada em sequência (*bump allocation*). Liberar
+// é só voltar o ponteiro a uma marca anterior, ou ao início.
+//
+// Os blocos nunca são devolvidos ao sistema enquanto a arena existir;
+// assim, depois da primeira busca (que 'aquece' a arena), as buscas
+// seguintes não fazem nenhuma chamada ao alocador global.
+//
+// Apenas tipos triviais (sem construtor nem destrutor) devem ser
+// alocados diretamente na arena. Uma arena não deve ser compartilhada
+// entre *threads*: cada *thread* tem a sua (veja *arena_busca* em
+// reversi.h).
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+class Arena {
+
+  struct Bloco {
+    Bloco *prox;
+    size_t tam; // bytes de dados do bloco
+  };
+
+  // Os dados começam logo após o cabeçalho, com alinhamento máximo.
+  static const size_t CABECALHO = (sizeof(Bloco) + 15) & ~(size_t) 15;
+  static const size_t TAM_BLOCO = 64 * 1024;
+
+  Bloco *_primeiro; // lista de blocos, em ordem de uso
+  Bloco *_atual;    // bloco de onde estamos cortando memória
+  size_t _usado;    // bytes já usados em *_atual*
+
+  static char *dados(Bloco *b) {
+    return reinterpret_cast<char *>(b) + CABECALHO;
+  }
+
+  static size_t alinha(size_t n, size_t alinhamento) {
+    return (n + alinhamento - 1) & ~(alinhamento - 1);
+  }
+
+  // Passa para o próximo bloco que comporte *bytes*, criando um novo
+  // se necessário.
+  void proximo_bloco(size_t bytes) {
+    Bloco *b = _atual == NULL ? _primeiro : _atual->prox;
+
+    if (b == NULL || b->tam < bytes) {
+      size_t tam = bytes > TAM_BLOCO ? bytes : TAM_BLOCO;
+      Bloco *novo = static_cast<Bloco *>(operator new(CABECALHO + tam));
+      novo->tam = tam;
+      novo->prox = b;
+      if (_atual == NULL) {
+        _primeiro = novo;
+      } else {
+        _atual->prox = novo;
+      }
+      b = novo;
+    }
+    _atual = b;
+    _usado = 0;
+  }
+
+  // Não copiamos arenas.
+  Arena(Arena const &);
+  Arena &operator= (Arena const &);
+
+public:
+
+  // Ponto da arena ao qual podemos voltar, liberando tudo o que foi
+  // alocado depois dele.
+  struct Marca {
+    Bloco *bloco;
+    size_t usado;
+  };
+
+  Arena()
+    : _primeiro(NULL), _atual(NULL), _usado(0)
+  {
+  }
+
+  ~Arena() {
+    while (_primeiro != NULL) {
+      Bloco *prox = _primeiro->prox;
+      operator delete(_primeiro);
+      _primeiro = prox;
+    }
+  }
+
+  // Aloca *bytes* com o alinhamento pedido (potência de 2, até 16).
+  void *aloca(size_t bytes, size_t alinhamento) {
+    size_t inicio = alinha(_usado, alinhamento);
+
+    if (_atual == NULL || inicio + bytes > _atual->tam) {
+      proximo_bloco(bytes);
+      inicio = 0;
+    }
+    _usado = inicio + bytes;
+    return dados(_atual) + inicio;
+  }
+
+  // Aloca espaço para *n* objetos (triviais) do tipo T.
+  template <class T>
+  T *aloca(size_t n) {
+    return static_cast<T *>(aloca(n * sizeof(T), alignof(T)));
+  }
+
+  Marca marca() const {
+    Marca m = {_atual, _usado};
+    return m;
+  }
+
+  // Libera tudo o que foi alocado depois da marca.
+  void volta(Marca m) {
+    _atual = m.bloco;
+    _usado = m.usado;
+  }
+
+  // Libera tudo, mantendo os blocos para as próximas alocações.
+  void reinicia() {
+    _atual = NULL;
+    _usado = 0;
+  }
+
+  // Total de bytes reservados pela arena.
+  size_t reservado() const {
+    size_t total = 0;
+    Bloco *b;
+
+    for (b=_primeiro; b!=NULL; b=b->prox) {
+      total += b->tam;
+    }
+    return total;
+  }
+
+};
+
+// *Pool* de objetos de um mesmo tipo, para estruturas que nascem e
+// morrem com frequência e fora de ordem (por exemplo, descritores de
+// tarefas da busca paralela), onde a disciplina de pilha da arena não
+// serve. Os objetos devolvidos vão para uma lista de livres e são
+// reaproveitados; a memória vem de uma arena própria e só é liberada
+// com o *pool*. Assim como a arena, o *pool* não é sincronizado.
+template <class T>
+class Pool {
+
+  union Livre {
+    Livre *prox;
+    alignas(T) char objeto[sizeof(T)];
+  };
+
+  Arena _arena;
+  Livre *_livres;
+  size_t _em_uso;
+
+public:
+
+  Pool()
+    : _livres(NULL), _em_uso(0)
+  {
+  }
+
+  // Constrói um objeto com os argumentos dados.
+  template <class... Args>
+  T *pega(Args&&... args) {
+    Livre *l = _livres;
+
+    if (l != NULL) {
+      _livres = l->prox;
+    } else {
+      l = _arena.aloca<Livre>(1);
+    }
+    _em_uso++;
+    return new (l->objeto) T(std::forward<Args>(args)...);
+  }
+
+  // Destrói o objeto e guarda sua memória para reaproveitamento.
+  void devolve(T *objeto) {
+    Livre *l = reinterpret_cast<Livre *>(objeto);
+
+    objeto->~T();
+    l->prox = _livres;
+    _livres = l;
+    _em_uso--;
+  }
+
+  size_t em_uso() const {
+    return _em_uso;
+  }
+
+};
+
+#endif /* _ARENA_H_ */
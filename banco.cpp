@@ -0,0 +1,94 @@
+//// Banco de posições das partidas ///////////////////////////////////////////
+
+// Veja banco.h.
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "reversi.h"
+#include "simetria.h"
+#include "banco.h"
+
+uint64_t chave_banco(uint64_t chave_zobrist, int tam) {
+  // A chave do motor já traz o tamanho (*chave_tamanho()*); trocamos o
+  // número dele pelo do banco, que é o dos bancos já gravados.
+  uint64_t chave = chave_zobrist ^ chave_tamanho(tam) ^
+                   mistura(0xB0A0ULL << 32 | tam);
+
+  return chave == 0 ? 1 : chave;
+}
+
+uint64_t chave_banco(char jogador, string **tabuleiro) {
+  int transformacao;
+
+  return chave_banco(chave_canonica(jogador, tabuleiro, &transformacao),
+                     (*tabuleiro[0]).size() - 2);
+}
+
+BancoPartidas::BancoPartidas()
+  : _fd(-1), _mapa(MAP_FAILED), _bytes(0), _bits(0), _cabecalho(NULL),
+    _entradas(NULL)
+{
+}
+
+BancoPartidas::~BancoPartidas() {
+  if (_mapa != MAP_FAILED) {
+    munmap(_mapa, _bytes);
+  }
+  if (_fd >= 0) {
+    close(_fd);
+  }
+}
+
+bool BancoPartidas::abre(const string &caminho, string *erro) {
+  struct stat st;
+
+  _fd = open(caminho.c_str(), O_RDONLY);
+  if (_fd < 0 || fstat(_fd, &st) < 0) {
+    *erro = caminho + ": " + strerror(errno);
+    return false;
+  }
+  _bytes = st.st_size;
+  if (_bytes < sizeof(CabecalhoBanco)) {
+    *erro = caminho + ": não é um banco de posições";
+    return false;
+  }
+  _mapa = mmap(NULL, _bytes, PROT_READ, MAP_SHARED, _fd, 0);
+  if (_mapa == MAP_FAILED) {
+    *erro = caminho + ": " + strerror(errno);
+    return false;
+  }
+  _cabecalho = static_cast<const CabecalhoBanco *>(_mapa);
+  _entradas = reinterpret_cast<const EntradaBanco *>(_cabecalho + 1);
+  if (memcmp(_cabecalho->magica, "RVBANCO3", 8) != 0 ||
+      _cabecalho->slots < 2 ||
+      (_cabecalho->slots & (_cabecalho->slots - 1)) != 0 ||
+      _bytes != sizeof(CabecalhoBanco) +
+                _cabecalho->slots * sizeof(EntradaBanco)) {
+    *erro = caminho + ": não é um banco de posições (ou está truncado)";
+    return false;
+  }
+  while ((1ULL << _bits) < _cabecalho->slots) {
+    _bits++;
+  }
+  // As consultas saltam para posições aleatórias do arquivo.
+  madvise(_mapa, _bytes, MADV_RANDOM);
+  return true;
+}
+
+const EntradaBanco *BancoPartidas::consulta(uint64_t chave) const {
+  uint64_t mascara = _cabecalho->slots - 1;
+  uint64_t i;
+
+  for (i=slot_banco(chave, _bits); _entradas[i].chave != 0;
+       i=(i + 1) & mascara) {
+    if (_entradas[i].chave == chave) {
+      return &_entradas[i];
+    }
+  }
+  return NULL;
+}
@@ -0,0 +1,98 @@
+#ifndef _BANCO_H_
+#define _BANCO_H_
+
+//// Banco de posições das partidas ///////////////////////////////////////////
+
+// Índice em disco de todas as posições que aparecem em uma coleção de
+// partidas (arquivos de jogadas ou fragmentos do *gera*), montado pelo
+// *indexa* (veja indexa.cpp). Para cada posição guardamos quantas vezes
+// ela apareceu, como terminaram essas partidas (do ponto de vista das
+// pretas) e um exemplo de onde ela aparece (a partida de menor número e
+// o lance).
+//
+// Posições simétricas (veja simetria.h) são a mesma entrada: a chave é
+// a da imagem canônica. O exemplo, então, pode mostrar a posição
+// consultada rodada ou refletida.
+//
+// O arquivo é uma tabela *hash* de endereçamento aberto (sondagem
+// linear), com um cabeçalho seguido das entradas. Uma consulta mapeia
+// o arquivo na memória (*mmap*) e lê apenas as poucas páginas da
+// sondagem, então responde em microssegundos mesmo com milhões de
+// partidas, sem carregar o índice. A sondagem começa no slot dado
+// pelos bits altos da chave (*slot_banco()*): em ordem de chave, as
+// entradas ficam em ordem no arquivo, e o *indexa* grava a tabela
+// inteira em uma passada, sem montá-la na memória.
+
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+
+struct CabecalhoBanco {
+  char magica[8];         // "RVBANCO3"
+  uint64_t slots;         // potência de 2, pelo menos 2
+  uint64_t posicoes;      // slots ocupados
+  uint64_t jogos;
+  uint64_t lances;
+};
+
+// Uma posição. A chave 0 marca um slot vazio.
+struct EntradaBanco {
+  uint64_t chave;
+  uint32_t ocorrencias;
+  uint32_t vitorias;      // das pretas
+  uint32_t empates;
+  uint32_t derrotas;
+  int64_t soma_diferenca; // soma das diferenças finais de peças (pretas)
+  uint64_t jogo;          // exemplo: partida de menor número...
+  uint32_t lance;         // ... e o lance (0 = posição inicial)
+  uint32_t tam;           // tamanho do tabuleiro
+};
+
+static_assert(sizeof(CabecalhoBanco) == 40 && sizeof(EntradaBanco) == 48,
+              "o formato do banco não depende da plataforma");
+
+// Chave de uma posição no banco: a chave canônica do motor (veja
+// simetria.h) combinada com o tamanho do tabuleiro, nunca 0.
+uint64_t chave_banco(char jogador, std::string **tabuleiro);
+uint64_t chave_banco(uint64_t chave_zobrist, int tam);
+
+// Primeiro slot da sondagem da *chave* em uma tabela de 2^*bits*
+// slots: os *bits* altos da chave.
+inline uint64_t slot_banco(uint64_t chave, int bits) {
+  return bits == 0 ? 0 : chave >> (64 - bits);
+}
+
+// Banco aberto para consulta.
+class BancoPartidas {
+
+  int _fd;
+  void *_mapa;
+  size_t _bytes;
+  int _bits;              // log2 dos slots
+  const CabecalhoBanco *_cabecalho;
+  const EntradaBanco *_entradas;
+
+  // Não copiamos bancos.
+  BancoPartidas(BancoPartidas const &);
+  BancoPartidas &operator= (BancoPartidas const &);
+
+public:
+
+  BancoPartidas();
+  ~BancoPartidas();
+
+  // Abre o arquivo; retorna *false* (com a mensagem em *erro*) se ele
+  // não existir ou não for um banco.
+  bool abre(const std::string &caminho, std::string *erro);
+
+  // Entrada da posição com a chave dada, ou NULL se ela não aparece
+  // em nenhuma partida.
+  const EntradaBanco *consulta(uint64_t chave) const;
+
+  const CabecalhoBanco &cabecalho() const {
+    return *_cabecalho;
+  }
+
+};
+
+#endif /* _BANCO_H_ */
@@ -0,0 +1,896 @@
+//// Benchmark do motor Reversi ///////////////////////////////////////////////
+
+// Executa um conjunto fixo (e versionado) de posições em várias
+// profundidades e tamanhos de tabuleiro, medindo para cada uma:
+//
+// * o tempo até completar a profundidade pedida;
+// * a quantidade de nós visitados e nós/segundo;
+// * a quantidade de alocações (chamadas ao *operator new*), que deve
+//   ser zero nas buscas;
+// * o pico de memória residente (RSS).
+//
+// Cada medida de busca roda em um processo filho (via *fork()*), de
+// forma que o pico de memória e as alocações de um caso não
+// contaminem os outros. Também em processos novos, medimos o início: o
+// tempo até as tabelas de cada tamanho estarem prontas, a frio (sem o
+// cache em arquivo) e a quente (veja tabelas.h), e a busca com a tabela
+// de transposição em tabuleiros enormes. Em seguida rodamos
+// *microbenchmarks* de *pos_jogaveis()*, *executa()*, *pontos()*, do
+// *Board::play()* do verificador, das consultas à tabela de
+// transposição e do registro de uma jogada nas métricas de produção
+// (veja metricas.h).
+//
+// À parte (com -e), mede a escalabilidade da busca em lote (veja
+// lote.h): as posições alcançadas em duas jogadas a partir de cada
+// caso são buscadas com 1, 2, 4... *threads* até o número de núcleos,
+// mostrando posições/segundo, aceleração e eficiência em relação a uma
+// *thread*. Essa medida depende da máquina e não entra na referência.
+//
+// Os resultados são comparados com um arquivo de referência, acusando
+// regressões acima dos limites configurados. Uso:
+//
+//     $ bench/bench [-p posicoes] [-b referencia] [-g] [-f filtro]
+//                   [-t pct] [-n pct] [-a pct] [-m pct] [-s | -x]
+//     $ bench/bench -e nivel [-p posicoes] [-f filtro] [-A afinidade] [-H]
+//
+// * -p: arquivo de posições (padrão bench/posicoes.txt);
+// * -b: arquivo de referência (padrão bench/referencia.txt);
+// * -g: grava as medidas como nova referência, em vez de comparar;
+// * -f: executa apenas os casos cujo nome contém o filtro;
+// * -t, -n, -a, -m: limites (em %) para tempo, nós, alocações e RSS;
+// * -s: apenas as buscas; -x: apenas os *microbenchmarks*;
+// * -e: apenas a escalabilidade, buscando cada posição até o nível dado;
+// * -A, -H: afinidade das *threads* ("nao", "cpu" ou "no") e páginas
+//   grandes nas tabelas da escalabilidade, como no analisa.
+//
+// O programa termina com código 1 se alguma regressão for encontrada.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <functional>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "../reversi.h"
+#include "../lote.h"
+#include "../tabelas.h"
+#include "../transposicao.h"
+#include "../metricas.h"
+#include "board.h"
+
+//// Contagem de alocações ////////////////////////////////////////////////////
+
+// Substituímos o *operator new* global para contar as alocações feitas
+// pelo motor (e pela biblioteca padrão em nome dele).
+static atomic<unsigned long long> alocacoes(0);
+
+void *operator new(size_t tam) {
+  void *p;
+
+  alocacoes.fetch_add(1, memory_order_relaxed);
+  p = malloc(tam ? tam : 1);
+  if (p == NULL) {
+    throw bad_alloc();
+  }
+  return p;
+}
+
+void *operator new[](size_t tam) {
+  return operator new(tam);
+}
+
+void operator delete(void *p) noexcept {
+  free(p);
+}
+
+void operator delete[](void *p) noexcept {
+  free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+  free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+  free(p);
+}
+
+//// Estruturas ///////////////////////////////////////////////////////////////
+
+// Um caso do conjunto de posições.
+struct Caso {
+  string nome;
+  string categoria;
+  vector<int> profundidades;
+  string posicao;
+};
+
+// Resultado de uma medida. Para os *microbenchmarks*, *tempo* é dado em
+// nanossegundos por operação e *alocacoes* é por operação; para as
+// buscas, *tempo* é dado em milissegundos.
+struct Medida {
+  double tempo;
+  unsigned long long nos;
+  unsigned long long alocacoes;
+  long rss_kb;
+  bool jogada_perdida;    // a busca repetida com a tabela mudou a jogada
+};
+
+// Limites (em %) acima dos quais uma medida é considerada regressão.
+struct Limites {
+  double tempo;
+  double nos;
+  double alocacoes;
+  double rss;
+};
+
+typedef chrono::steady_clock Relogio;
+
+static double segundos_desde(Relogio::time_point inicio) {
+  return chrono::duration<double>(Relogio::now() - inicio).count();
+}
+
+//// Leitura das posições e da referência /////////////////////////////////////
+
+// Lê o conjunto de posições. Linhas vazias e iniciadas por '#' são
+// ignoradas; a linha "versao <n>" identifica a versão do conjunto.
+static vector<Caso> le_casos(const string &nome_arquivo, int *versao) {
+  ifstream arquivo(nome_arquivo.c_str());
+  vector<Caso> casos;
+  string linha, profs, prof;
+  int num_linha = 0;
+
+  if (!arquivo.good()) {
+    cerr << "Não foi possível abrir " << nome_arquivo << endl;
+    exit(1);
+  }
+  *versao = 0;
+  while (getline(arquivo, linha)) {
+    num_linha++;
+    if (linha.empty() || linha[0] == '#') {
+      continue;
+    }
+    istringstream campos(linha);
+    if (linha.compare(0, 7, "versao ") == 0) {
+      campos >> prof >> *versao;
+      continue;
+    }
+    Caso caso;
+    campos >> caso.nome >> caso.categoria >> profs >> ws;
+    getline(campos, caso.posicao);
+    istringstream lista(profs);
+    while (getline(lista, prof, ',')) {
+      caso.profundidades.push_back(atoi(prof.c_str()));
+    }
+    char jogador;
+    string **tabuleiro = le_posicao(caso.posicao, &jogador);
+    if (tabuleiro == NULL || caso.profundidades.empty()) {
+      cerr << "Posição inválida em " << nome_arquivo
+           << " linha " << num_linha << endl;
+      exit(1);
+    }
+    libera_tabuleiro(tabuleiro);
+    casos.push_back(caso);
+  }
+  return casos;
+}
+
+// Chave de uma medida na referência: nome do caso e profundidade
+// (0 para os *microbenchmarks*).
+static string chave(const string &nome, int prof) {
+  ostringstream s;
+  s << nome << " " << prof;
+  return s.str();
+}
+
+// Lê o arquivo de referência (se existir).
+static map<string, Medida> le_referencia(const string &nome_arquivo) {
+  ifstream arquivo(nome_arquivo.c_str());
+  map<string, Medida> ref;
+  string linha, nome;
+  int prof;
+  Medida m;
+
+  while (getline(arquivo, linha)) {
+    if (linha.empty() || linha[0] == '#') {
+      continue;
+    }
+    istringstream campos(linha);
+    campos >> nome >> prof >> m.tempo >> m.nos >> m.alocacoes >> m.rss_kb;
+    if (!campos.fail()) {
+      ref[chave(nome, prof)] = m;
+    }
+  }
+  return ref;
+}
+
+//// Comparação com a referência //////////////////////////////////////////////
+
+// Acrescenta a *problemas* uma descrição se *novo* passou de *antigo*
+// mais *pct* por cento (e mais uma folga absoluta, para medidas muito
+// pequenas e ruidosas).
+static void compara(const char *nome, double novo, double antigo,
+                    double pct, double folga, string *problemas) {
+  ostringstream s;
+
+  if (antigo <= 0 || novo <= antigo * (1 + pct / 100) + folga) {
+    return;
+  }
+  s << " " << nome << " +" << fixed << setprecision(0)
+    << (novo / antigo - 1) * 100 << "%";
+  *problemas += s.str();
+}
+
+// Mostra uma linha de resultado e compara com a referência. Devolve
+// *true* se houve regressão.
+static bool relata(const string &nome, int prof, const Medida &m,
+                   const map<string, Medida> &ref, const Limites &lim,
+                   bool micro) {
+  map<string, Medida>::const_iterator r = ref.find(chave(nome, prof));
+  string problemas;
+  double nos_s = m.tempo > 0 ? m.nos / (m.tempo / 1000) : 0;
+
+  cout << left << setw(28) << nome << right << setw(5) << prof
+       << fixed << setprecision(3) << setw(12) << m.tempo
+       << setw(12) << m.nos << setprecision(0) << setw(12) << nos_s
+       << setw(11) << m.alocacoes << setw(10) << m.rss_kb << "  ";
+
+  // A busca com a arena aquecida não pode alocar nada.
+  if (!micro && m.alocacoes > 0) {
+    cout << "ERRO: a busca chamou o alocador global" << endl;
+    return true;
+  }
+  if (!micro && m.jogada_perdida) {
+    cout << "ERRO: a tabela de transposição perdeu a jogada" << endl;
+    return true;
+  }
+  if (r == ref.end()) {
+    cout << "(sem referência)" << endl;
+    return false;
+  }
+  // Buscas abaixo de 1 ms e operações abaixo de 20 ns variam muito de
+  // uma execução para outra; damos essa folga absoluta no tempo.
+  compara("tempo", m.tempo, r->second.tempo, lim.tempo,
+          micro ? 20 : 1, &problemas);
+  compara("nós", m.nos, r->second.nos, lim.nos, 0, &problemas);
+  compara("alocações", m.alocacoes, r->second.alocacoes, lim.alocacoes,
+          0, &problemas);
+  compara("rss", m.rss_kb, r->second.rss_kb, lim.rss, 0, &problemas);
+  if (problemas.empty()) {
+    cout << "ok" << endl;
+    return false;
+  }
+  cout << "REGRESSÃO:" << problemas << endl;
+  return true;
+}
+
+//// Medidas de busca /////////////////////////////////////////////////////////
+
+// Executa *mede* em um processo filho, que devolve a medida pelo
+// *pipe* (com o pico de memória do filho).
+static Medida no_filho(const function<void (Medida *)> &mede,
+                       const string &descricao) {
+  Medida m;
+  int canal[2];
+  pid_t pid;
+  int estado;
+
+  memset(&m, 0, sizeof(m));
+  if (pipe(canal) != 0) {
+    perror("pipe");
+    exit(1);
+  }
+  pid = fork();
+  if (pid < 0) {
+    perror("fork");
+    exit(1);
+  }
+
+  if (pid == 0) {
+    struct rusage uso;
+
+    close(canal[0]);
+    mede(&m);
+    getrusage(RUSAGE_SELF, &uso);
+    m.rss_kb = uso.ru_maxrss;
+    if (write(canal[1], &m, sizeof(m)) != sizeof(m)) {
+      _exit(1);
+    }
+    _exit(0);
+  }
+
+  close(canal[1]);
+  if (read(canal[0], &m, sizeof(m)) != sizeof(m)) {
+    cerr << "Falha ao medir " << descricao << endl;
+    exit(1);
+  }
+  close(canal[0]);
+  waitpid(pid, &estado, 0);
+  return m;
+}
+
+// Mede uma busca de profundidade *prof* a partir da posição do caso,
+// em um processo filho.
+//
+// O tempo e os nós são os da primeira busca. As alocações são contadas
+// em uma segunda busca idêntica, com a arena já aquecida: é a garantia
+// de que o caminho quente da busca não chama o alocador global (e
+// qualquer valor diferente de zero é acusado como erro).
+static Medida mede_busca(const Caso &caso, int prof) {
+  ostringstream descricao;
+
+  descricao << caso.nome << " em profundidade " << prof;
+  return no_filho([&](Medida *m) {
+    char jogador;
+    string **tabuleiro = le_posicao(caso.posicao, &jogador);
+    unsigned long long alocacoes_antes;
+    Relogio::time_point inicio;
+
+    nos_visitados = 0;
+    inicio = Relogio::now();
+    planeja(jogador, tabuleiro, prof);
+    m->tempo = segundos_desde(inicio) * 1000;
+    m->nos = nos_visitados;
+    alocacoes_antes = alocacoes.load();
+    planeja(jogador, tabuleiro, prof);
+    m->alocacoes = alocacoes.load() - alocacoes_antes;
+  }, descricao.str());
+}
+
+//// Medidas de inicialização /////////////////////////////////////////////////
+
+// Tamanhos em que medimos a preparação das tabelas (veja tabelas.h):
+// um pequeno, que não usa o cache em arquivo, e alguns grandes.
+static const int TAMANHOS_INICIO[] = {8, 64, 256, 1024};
+
+// Mede, em um processo novo, o tempo até as tabelas do tamanho *tam*
+// estarem prontas, com o cache no diretório *dir*: a frio, sem o
+// arquivo (calculando e gravando); a quente, mapeando o arquivo
+// gravado antes.
+static Medida mede_inicio(const string &dir, int tam) {
+  ostringstream descricao;
+
+  descricao << "o início em " << tam << "x" << tam;
+  return no_filho([&](Medida *m) {
+    Relogio::time_point inicio = Relogio::now();
+
+    diretorio_cache_tabelas(dir);
+    tabelas(tam);
+    m->tempo = segundos_desde(inicio) * 1000;
+  }, descricao.str());
+}
+
+//// Tabela de transposição em tabuleiros enormes ///////////////////////////
+
+// Tamanhos em que medimos a busca com a tabela de transposição. A
+// tabela guarda a linha e a coluna da jogada em poucos bits (veja
+// transposicao.h), e o 256x256 é o primeiro tamanho em que elas não
+// cabem em um byte.
+static const int TAMANHOS_TABELA[] = {256};
+static const int PROF_TABELA = 3;
+
+// Posição dos casos: o meio-8, de cabeça para baixo, no canto inferior
+// direito de um tabuleiro *tam* x *tam*, onde a melhor jogada fica na
+// última linha.
+static const char *const CANTO_TABELA[8] = {
+  "--------", "--10----", "--0001--", "-00011--",
+  "0001010-", "0010110-", "1100-1--", "10------"
+};
+
+static string posicao_canto(int tam) {
+  string s = "0 ";
+  int linha;
+
+  for (linha=0; linha<tam; linha++) {
+    if (linha > 0) {
+      s += "/";
+    }
+    s += string(tam - 8, '-');
+    s += linha >= tam - 8 ? CANTO_TABELA[linha - (tam - 8)] : "--------";
+  }
+  return s;
+}
+
+// Mede, em um processo filho, a busca no tamanho *tam* com uma tabela
+// de transposição nova, como a do servidor. O tempo e os nós são os da
+// primeira busca; a segunda, idêntica, encontra a raiz na tabela e
+// deve devolver a mesma jogada, e as alocações são contadas nela.
+static Medida mede_busca_tabela(int tam) {
+  ostringstream descricao;
+
+  descricao << "a busca com a tabela em " << tam << "x" << tam;
+  return no_filho([&](Medida *m) {
+    TabelaTransposicao tabela(TAM_TABELA_PADRAO);
+    char jogador;
+    string **tabuleiro = le_posicao(posicao_canto(tam), &jogador);
+    unsigned long long alocacoes_antes;
+    Relogio::time_point inicio;
+    Posicao primeira;
+
+    tabela_busca = &tabela;
+    nos_visitados = 0;
+    inicio = Relogio::now();
+    primeira = *planeja(jogador, tabuleiro, PROF_TABELA);
+    m->tempo = segundos_desde(inicio) * 1000;
+    m->nos = nos_visitados;
+    alocacoes_antes = alocacoes.load();
+    Posicao segunda = *planeja(jogador, tabuleiro, PROF_TABELA);
+    m->alocacoes = alocacoes.load() - alocacoes_antes;
+    m->jogada_perdida = segunda.linha != primeira.linha ||
+                        segunda.coluna != primeira.coluna;
+    tabela_busca = NULL;
+  }, descricao.str());
+}
+
+//// Microbenchmarks //////////////////////////////////////////////////////////
+
+// Cada *microbenchmark* repete a operação em lotes até passar o tempo
+// mínimo abaixo, para que a medida não dependa da resolução do
+// relógio.
+static const double TEMPO_MINIMO = 0.2;
+static const int LOTE = 256;
+
+// Preenche a medida a partir do total de operações, do tempo gasto e
+// das alocações feitas.
+static Medida por_operacao(long ops, double segundos,
+                           unsigned long long alocs) {
+  Medida m;
+
+  m.tempo = segundos * 1e9 / ops;
+  m.nos = 0;
+  m.alocacoes = (alocs + ops / 2) / ops;
+  m.rss_kb = 0;
+  m.jogada_perdida = false;
+  return m;
+}
+
+// Gera as jogadas como a busca faz: em um vetor já alocado.
+static Medida micro_pos_jogaveis(char jogador, string **tabuleiro) {
+  int tam = (*tabuleiro[0]).size() - 2;
+  vector<Posicao> v(tam * tam);
+  unsigned long long a0 = alocacoes.load();
+  Relogio::time_point inicio = Relogio::now();
+  long ops = 0;
+  int i;
+
+  do {
+    for (i=0; i<LOTE; i++) {
+      pos_jogaveis(jogador, tabuleiro, &v[0]);
+    }
+    ops += LOTE;
+  } while (segundos_desde(inicio) < TEMPO_MINIMO);
+  return por_operacao(ops, segundos_desde(inicio), alocacoes.load() - a0);
+}
+
+static Medida micro_pontos(char jogador, string **tabuleiro) {
+  unsigned long long a0 = alocacoes.load();
+  Relogio::time_point inicio = Relogio::now();
+  long ops = 0;
+  int i;
+
+  do {
+    for (i=0; i<LOTE; i++) {
+      pontos(jogador, tabuleiro);
+    }
+    ops += LOTE;
+  } while (segundos_desde(inicio) < TEMPO_MINIMO);
+  return por_operacao(ops, segundos_desde(inicio), alocacoes.load() - a0);
+}
+
+// Executa e desfaz cada jogada possível da posição, como a busca faz
+// em cada nó. A medida é do par *executa()* + *desfaz()*.
+static Medida micro_executa(char jogador, string **tabuleiro) {
+  vector<Posicao> jogaveis = pos_jogaveis(jogador, tabuleiro);
+  unsigned long long a0 = alocacoes.load();
+  Relogio::time_point inicio = Relogio::now();
+  Desfazer desfazer;
+  long ops = 0;
+  int i;
+
+  if (jogaveis.empty()) {
+    return por_operacao(1, 0, 0);
+  }
+  do {
+    for (i=0; i<LOTE; i++) {
+      executa(&jogaveis[(ops + i) % jogaveis.size()], jogador, tabuleiro,
+              &desfazer);
+      desfaz(&desfazer, tabuleiro);
+    }
+    ops += LOTE;
+  } while (segundos_desde(inicio) < TEMPO_MINIMO);
+  return por_operacao(ops, segundos_desde(inicio), alocacoes.load() - a0);
+}
+
+// Gera um jogo completo a partir da posição inicial, escolhendo
+// sempre a jogada do *minimax* de nível 1, já nas coordenadas do
+// verificador (linha 0 embaixo).
+static vector<Move> jogo_referencia(int tam) {
+  string **tabuleiro = novo_tabuleiro(tam);
+  vector<Move> jogo;
+  char jogador = PRETO, oponente;
+  Posicao *pos;
+
+  while (true) {
+    oponente = jogador == PRETO ? BRANCO : PRETO;
+    if (!tem_jogada(jogador, tabuleiro)) {
+      if (!tem_jogada(oponente, tabuleiro)) {
+        break;
+      }
+      jogador = oponente;
+      continue;
+    }
+    pos = planeja(jogador, tabuleiro, 1);
+    executa(pos, jogador, tabuleiro);
+    jogo.push_back(Move(jogador == PRETO ? black : white,
+                        Cell(tam - pos->linha, pos->coluna - 1)));
+    jogador = oponente;
+  }
+  libera_tabuleiro(tabuleiro);
+  return jogo;
+}
+
+// Reproduz o jogo de referência no *Board* do verificador. A medida é
+// por jogada (incluindo a construção do tabuleiro, amortizada).
+static Medida micro_board_play(int tam) {
+  vector<Move> jogo = jogo_referencia(tam);
+  unsigned long long a0 = alocacoes.load();
+  Relogio::time_point inicio = Relogio::now();
+  long ops = 0;
+  vector<Move>::size_type i;
+
+  do {
+    Board board(tam);
+    for (i=0; i<jogo.size(); i++) {
+      board.play(jogo[i]);
+    }
+    ops += jogo.size();
+  } while (segundos_desde(inicio) < TEMPO_MINIMO);
+  return por_operacao(ops, segundos_desde(inicio), alocacoes.load() - a0);
+}
+
+// Tamanho da tabela de transposição medida: bem maior que o cache,
+// como as tabelas das buscas longas.
+static const size_t MB_MICRO_TABELA = 64;
+
+// Mede a tabela de transposição, com metade das casas ocupadas:
+// *guarda()* de posições novas ou *busca()* de posições sorteadas
+// (metade delas presentes). Cada consulta depende do resultado da
+// anterior, de forma que a medida é a latência de uma consulta (a
+// espera pela memória), e não a vazão de consultas independentes.
+static Medida micro_tabela(bool guarda) {
+  TabelaTransposicao tabela(MB_MICRO_TABELA);
+  unsigned long long n = tabela.entradas(), x = 0, a0, k;
+  Relogio::time_point inicio;
+  EntradaTT entrada;
+  long ops = 0;
+  int i;
+
+  for (k=0; k<n/2; k++) {
+    tabela.guarda(mistura(k), 1, 0, TT_EXATO, -1, -1);
+  }
+  a0 = alocacoes.load();
+  inicio = Relogio::now();
+  do {
+    for (i=0; i<LOTE; i++) {
+      if (guarda) {
+        tabela.guarda(mistura(n + ops + i), 1, 0, TT_EXATO, -1, -1);
+      } else {
+        x = mistura(x + tabela.busca(mistura(x % n), &entrada));
+      }
+    }
+    ops += LOTE;
+  } while (segundos_desde(inicio) < TEMPO_MINIMO);
+  return por_operacao(ops, segundos_desde(inicio), alocacoes.load() - a0);
+}
+
+// Registro de uma jogada do 8x8 nas métricas, com a leitura do relógio
+// que a busca faz ao terminar (veja *registra_metricas()* em
+// reversi.cpp). Deve ficar muito abaixo de 1% da jogada mais rápida.
+static Medida micro_metricas() {
+  MetricasMotor metricas;
+  string **tabuleiro = novo_tabuleiro(8);
+  unsigned long long a0;
+  Relogio::time_point inicio;
+  long ops = 0;
+  int i;
+
+  metricas.registra(tabuleiro, 0, 0, 0, 0);
+  a0 = alocacoes.load();
+  inicio = Relogio::now();
+  do {
+    for (i=0; i<LOTE; i++) {
+      metricas.registra(tabuleiro, segundos_desde(inicio), 1000, 10, 3);
+    }
+    ops += LOTE;
+  } while (segundos_desde(inicio) < TEMPO_MINIMO);
+  libera_tabuleiro(tabuleiro);
+  return por_operacao(ops, segundos_desde(inicio), alocacoes.load() - a0);
+}
+
+//// Escalabilidade da busca em lote /////////////////////////////////////////
+
+// Acrescenta a *pedidos* as posições alcançadas a partir de *tabuleiro*
+// em *jogadas* jogadas (passadas de vez incluídas; o jogo terminado
+// não entra).
+static void expande(char jogador, string **tabuleiro, int jogadas,
+                    int nivel, vector<PedidoLote> *pedidos) {
+  vector<Posicao> posicoes;
+  size_t k;
+
+  if (jogadas == 0) {
+    PedidoLote p = {jogador, copia_tabuleiro(tabuleiro), nivel, 0, 0};
+    pedidos->push_back(p);
+    return;
+  }
+  posicoes = pos_jogaveis(jogador, tabuleiro);
+  for (k=0; k<posicoes.size(); k++) {
+    string **filho = copia_tabuleiro(tabuleiro);
+    char seguinte;
+
+    executa(&posicoes[k], jogador, filho);
+    seguinte = proximo(jogador, filho);
+    if (seguinte == '0' || seguinte == '1') {
+      expande(seguinte, filho, jogadas - 1, nivel, pedidos);
+    }
+    libera_tabuleiro(filho);
+  }
+}
+
+static void escalabilidade(const vector<Caso> &casos, const string &filtro,
+                           int nivel, const OpcoesLote &base) {
+  vector<PedidoLote> pedidos;
+  vector<int> threads;
+  double base_s = 0;
+  size_t i;
+  int n = le_topologia().nucleos(), t;
+
+  for (i=0; i<casos.size(); i++) {
+    if (casos[i].nome.find(filtro) == string::npos) {
+      continue;
+    }
+    char jogador;
+    string **tabuleiro = le_posicao(casos[i].posicao, &jogador);
+    expande(jogador, tabuleiro, 2, nivel, &pedidos);
+    libera_tabuleiro(tabuleiro);
+  }
+  for (t=1; t<n; t*=2) {
+    threads.push_back(t);
+  }
+  threads.push_back(n);
+
+  cout << "Escalabilidade: " << pedidos.size() << " posições, nível "
+       << nivel << ", " << n << " núcleos\n"
+       << setw(8) << "threads" << setw(12) << "tempo(s)"
+       << setw(12) << "posicoes/s" << setw(14) << "nos/s"
+       << setw(12) << "aceleracao" << setw(12) << "eficiencia" << endl;
+  for (i=0; i<threads.size(); i++) {
+    OpcoesLote opcoes = base;
+    EstatisticasLote estat;
+    double aceleracao;
+
+    // Cada chamada cria tabelas novas, então as medidas não se
+    // contaminam.
+    opcoes.threads = threads[i];
+    busca_lote(pedidos, opcoes, &estat);
+    if (i == 0) {
+      base_s = estat.segundos;
+    }
+    aceleracao = estat.segundos > 0 ? base_s / estat.segundos : 0;
+    cout << setw(8) << estat.threads << fixed << setprecision(3)
+         << setw(12) << estat.segundos << setprecision(1)
+         << setw(12) << estat.posicoes_por_segundo() << setprecision(0)
+         << setw(14) << (estat.segundos > 0 ? estat.nos / estat.segundos : 0)
+         << setprecision(2) << setw(12) << aceleracao
+         << setw(11) << aceleracao / threads[i] * 100 << "%" << endl;
+  }
+  for (i=0; i<pedidos.size(); i++) {
+    libera_tabuleiro(pedidos[i].tabuleiro);
+  }
+}
+
+//// Programa principal ///////////////////////////////////////////////////////
+
+static void uso(const char *comando) {
+  cerr << "Uso: " << comando << " [-p posicoes] [-b referencia] [-g]"
+       << " [-f filtro] [-t pct] [-n pct] [-a pct] [-m pct] [-s | -x]\n"
+       << "     " << comando << " -e nivel [-p posicoes] [-f filtro]"
+       << " [-A nao|cpu|no] [-H]\n";
+  exit(1);
+}
+
+int main(int argc, char *argv[]) {
+  string nome_posicoes = "bench/posicoes.txt";
+  string nome_referencia = "bench/referencia.txt";
+  string filtro;
+  bool grava = false, buscas = true, micros = true, regressao = false;
+  Limites lim = {25, 0, 0, 10};
+  map<string, Medida> ref;
+  map<int, bool> tamanhos_play;
+  vector<Caso> casos;
+  ofstream saida;
+  OpcoesLote opcoes_lote;
+  int versao, opcao, nivel_escala = 0;
+  vector<Caso>::size_type i;
+  vector<int>::size_type p;
+
+  while ((opcao = getopt(argc, argv, "p:b:gf:t:n:a:m:sxe:A:H")) != -1) {
+    switch (opcao) {
+    case 'p': nome_posicoes = optarg; break;
+    case 'b': nome_referencia = optarg; break;
+    case 'g': grava = true; break;
+    case 'f': filtro = optarg; break;
+    case 't': lim.tempo = atof(optarg); break;
+    case 'n': lim.nos = atof(optarg); break;
+    case 'a': lim.alocacoes = atof(optarg); break;
+    case 'm': lim.rss = atof(optarg); break;
+    case 's': micros = false; break;
+    case 'x': buscas = false; break;
+    case 'e': nivel_escala = atoi(optarg); break;
+    case 'A':
+      if (!le_afinidade(optarg, &opcoes_lote.afinidade)) {
+        uso(argv[0]);
+      }
+      break;
+    case 'H': opcoes_lote.paginas_grandes = true; break;
+    default: uso(argv[0]);
+    }
+  }
+
+  casos = le_casos(nome_posicoes, &versao);
+  if (nivel_escala > 0) {
+    escalabilidade(casos, filtro, nivel_escala, opcoes_lote);
+    return 0;
+  }
+  if (!grava) {
+    ref = le_referencia(nome_referencia);
+  } else {
+    saida.open(nome_referencia.c_str());
+    saida << "# Referência do benchmark (posições versão " << versao
+          << ")\n# <caso> <prof> <tempo> <nós> <alocações> <rss_kb>\n";
+  }
+
+  cout << "Posições: " << nome_posicoes << " (versão " << versao << ")\n"
+       << left << setw(28) << "caso" << right << setw(5) << "prof"
+       << setw(12) << "tempo" << setw(12) << "nos" << setw(12) << "nos/s"
+       << setw(11) << "alocacoes" << setw(10) << "rss(kB)" << endl;
+
+  for (i=0; buscas && i<casos.size(); i++) {
+    if (casos[i].nome.find(filtro) == string::npos) {
+      continue;
+    }
+    for (p=0; p<casos[i].profundidades.size(); p++) {
+      int prof = casos[i].profundidades[p];
+      Medida m = mede_busca(casos[i], prof);
+      regressao |= relata(casos[i].nome, prof, m, ref, lim, false);
+      if (grava) {
+        saida << casos[i].nome << " " << prof << " " << m.tempo << " "
+              << m.nos << " " << m.alocacoes << " " << m.rss_kb << "\n";
+      }
+    }
+  }
+
+  // A preparação das tabelas, em um diretório de cache temporário.
+  if (buscas && string("inicio").find(filtro) != string::npos) {
+    char dir[] = "/tmp/reversi-bench-XXXXXX";
+
+    if (mkdtemp(dir) == NULL) {
+      perror("mkdtemp");
+      exit(1);
+    }
+    for (p=0; p<sizeof(TAMANHOS_INICIO)/sizeof(TAMANHOS_INICIO[0]); p++) {
+      int tam = TAMANHOS_INICIO[p];
+      ostringstream frio, quente, arquivo;
+      Medida medidas[2];
+      int k;
+
+      frio << "inicio-frio:" << tam;
+      quente << "inicio-quente:" << tam;
+      string nomes[2] = {frio.str(), quente.str()};
+      medidas[0] = mede_inicio(dir, tam);
+      medidas[1] = mede_inicio(dir, tam);
+      for (k=0; k<2; k++) {
+        regressao |= relata(nomes[k], 0, medidas[k], ref, lim, false);
+        if (grava) {
+          saida << nomes[k] << " 0 " << medidas[k].tempo << " 0 0 "
+                << medidas[k].rss_kb << "\n";
+        }
+      }
+      arquivo << dir << "/tabelas-" << tam << ".bin";
+      unlink(arquivo.str().c_str());
+    }
+    rmdir(dir);
+  }
+
+  // A busca com a tabela de transposição nos tamanhos enormes.
+  if (buscas && string("tabela").find(filtro) != string::npos) {
+    for (p=0; p<sizeof(TAMANHOS_TABELA)/sizeof(TAMANHOS_TABELA[0]); p++) {
+      ostringstream nome;
+      Medida m;
+
+      nome << "tabela:" << TAMANHOS_TABELA[p];
+      m = mede_busca_tabela(TAMANHOS_TABELA[p]);
+      regressao |= relata(nome.str(), PROF_TABELA, m, ref, lim, false);
+      if (grava) {
+        saida << nome.str() << " " << PROF_TABELA << " " << m.tempo << " "
+              << m.nos << " " << m.alocacoes << " " << m.rss_kb << "\n";
+      }
+    }
+  }
+
+  // Os *microbenchmarks* usam as posições de meio de jogo.
+  for (i=0; micros && i<casos.size(); i++) {
+    if (casos[i].categoria != "meio" ||
+        casos[i].nome.find(filtro) == string::npos) {
+      continue;
+    }
+    char jogador;
+    string **tabuleiro = le_posicao(casos[i].posicao, &jogador);
+    int tam = (*tabuleiro[0]).size() - 2;
+    ostringstream nome_play;
+    nome_play << "Board::play:" << tam;
+    string nomes[4] = {"pos_jogaveis:" + casos[i].nome,
+                       "executa:" + casos[i].nome,
+                       "pontos:" + casos[i].nome,
+                       nome_play.str()};
+    Medida medidas[4];
+    int k, qtd = 3;
+
+    medidas[0] = micro_pos_jogaveis(jogador, tabuleiro);
+    medidas[1] = micro_executa(jogador, tabuleiro);
+    medidas[2] = micro_pontos(jogador, tabuleiro);
+    // O jogo reproduzido pelo *Board::play()* depende só do tamanho.
+    if (!tamanhos_play[tam]) {
+      medidas[3] = micro_board_play(tam);
+      tamanhos_play[tam] = true;
+      qtd = 4;
+    }
+    for (k=0; k<qtd; k++) {
+      regressao |= relata(nomes[k], 0, medidas[k], ref, lim, true);
+      if (grava) {
+        saida << nomes[k] << " 0 " << medidas[k].tempo << " 0 "
+              << medidas[k].alocacoes << " 0\n";
+      }
+    }
+    libera_tabuleiro(tabuleiro);
+  }
+
+  if (micros && string("tabela").find(filtro) != string::npos) {
+    string nomes[2] = {"tabela:busca", "tabela:guarda"};
+    Medida medidas[2] = {micro_tabela(false), micro_tabela(true)};
+    int k;
+
+    for (k=0; k<2; k++) {
+      regressao |= relata(nomes[k], 0, medidas[k], ref, lim, true);
+      if (grava) {
+        saida << nomes[k] << " 0 " << medidas[k].tempo << " 0 "
+              << medidas[k].alocacoes << " 0\n";
+      }
+    }
+  }
+
+  if (micros && string("metricas").find(filtro) != string::npos) {
+    Medida m = micro_metricas();
+
+    regressao |= relata("metricas:registra", 0, m, ref, lim, true);
+    if (grava) {
+      saida << "metricas:registra 0 " << m.tempo << " 0 " << m.alocacoes
+            << " 0\n";
+    }
+  }
+
+  if (grava) {
+    cout << "Referência gravada em " << nome_referencia << endl;
+  }
+  return regressao ? 1 : 0;
+}
@@ -0,0 +1,321 @@
+//// Calibração do corte provável /////////////////////////////////////////////
+
+// O *calibra* estima os parâmetros do *ProbCut* (veja probcut.h) a
+// partir de partidas gravadas: sorteia posições das partidas, busca
+// cada uma nos níveis de cada par (nivel, nivel_raso) e ajusta, por
+// mínimos quadrados, v = a * v' + b, com o desvio padrão dos resíduos
+// em *sigma*. Posições cujo ganho é de fim de jogo (±999999) ficam de
+// fora do ajuste.
+//
+// Com -c, em vez de calibrar, compara a busca com e sem o corte
+// provável nas posições sorteadas: nós, tempo, quantas vezes a jogada
+// escolhida foi a mesma e o erro médio do ganho.
+//
+// Uso:
+//
+//     $ ./calibra -o probcut.txt [-p nivel:raso,...] [-l limiar]
+//                 [-n posicoes] [-j threads] [-t tam] entrada...
+//     $ ./calibra -c probcut.txt [-d nivel] [-n posicoes] [-j threads]
+//                 [-t tam] entrada...
+//
+// * -o: grava os parâmetros calibrados neste arquivo;
+// * -p: pares de níveis a calibrar (padrão 4:2,5:3,6:2,6:4,7:3);
+// * -l: limiar gravado com os parâmetros (padrão 1.5);
+// * -c: compara a busca sem e com os parâmetros deste arquivo;
+// * -d: nível da comparação (padrão 6);
+// * -n: número de posições sorteadas (padrão 500);
+// * -j: *threads* (padrão: número de núcleos);
+// * -t: tamanho das partidas sem cabeçalho (padrão 8);
+// * entradas: como no *indexa* (veja partidas.h).
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <unistd.h>
+
+#include "reversi.h"
+#include "probcut.h"
+#include "partidas.h"
+
+// Uma posição sorteada, descrita como em *le_posicao()*.
+struct Amostra {
+  int tam;
+  string posicao;
+};
+
+// Sorteia cerca de *n* posições, espalhadas pelas partidas: uma a cada
+// tantas jogadas, sem contar as posições finais.
+static vector<Amostra> sorteia(const vector<Partida> &partidas, int n) {
+  vector<vector<JogadaArquivo> > todas;
+  vector<Amostra> amostras;
+  size_t total = 0, passo, k = 0, i, j;
+
+  for (i=0; i<partidas.size(); i++) {
+    todas.push_back(jogadas(partidas[i]));
+    total += todas.back().size();
+  }
+  passo = max((size_t) 1, total / max(n, 1));
+  for (i=0; i<partidas.size(); i++) {
+    int tam = partidas[i].tam;
+    string **tabuleiro = novo_tabuleiro(tam);
+    for (j=0; j<todas[i].size(); j++) {
+      const JogadaArquivo &jogada = todas[i][j];
+      char jogador = jogada.preta ? PRETO : BRANCO;
+      Posicao pos = { tam - jogada.linha, jogada.coluna + 1 };
+      if (k++ % passo == passo / 2 && (int) amostras.size() < n) {
+        Amostra a = { tam, escreve_posicao(jogador, tabuleiro) };
+        amostras.push_back(a);
+      }
+      executa(&pos, jogador, tabuleiro);
+    }
+    libera_tabuleiro(tabuleiro);
+  }
+  return amostras;
+}
+
+// Executa *f(i)* para i de 0 a n - 1 em *threads* paralelas.
+template <class F>
+static void paralelo(size_t n, int threads, F f) {
+  vector<thread> trabalhadores;
+  atomic<size_t> proxima(0);
+  int t;
+
+  for (t=0; t<threads; t++) {
+    trabalhadores.push_back(thread([&]() {
+      size_t i;
+      while ((i = proxima++) < n) {
+        f(i);
+      }
+    }));
+  }
+  for (t=0; t<threads; t++) {
+    trabalhadores[t].join();
+  }
+}
+
+// Resultado de uma busca de uma amostra.
+struct Busca {
+  float ganho;
+  Posicao pos;
+  unsigned long long nos;
+};
+
+static Busca busca(const Amostra &amostra, int nivel) {
+  char jogador;
+  string **tabuleiro = le_posicao(amostra.posicao, &jogador);
+  GanhoPos aux;
+  Busca b;
+
+  arena_busca.reinicia();
+  nos_visitados = 0;
+  aux = minimax(jogador, tabuleiro, nivel);
+  b.ganho = aux.ganho;
+  b.pos = *aux.pos;
+  b.nos = nos_visitados;
+  arena_busca.reinicia();
+  libera_tabuleiro(tabuleiro);
+  return b;
+}
+
+//// Calibração ///////////////////////////////////////////////////////////////
+
+static vector<pair<int, int> > le_pares(const string &s) {
+  vector<pair<int, int> > pares;
+  istringstream entrada(s);
+  string item;
+  int nivel, raso;
+
+  while (getline(entrada, item, ',')) {
+    if (sscanf(item.c_str(), "%d:%d", &nivel, &raso) != 2 ||
+        raso < 1 || raso >= nivel) {
+      cerr << "Par de níveis inválido: " << item << endl;
+      exit(1);
+    }
+    pares.push_back(make_pair(nivel, raso));
+  }
+  return pares;
+}
+
+static int calibra(const vector<Amostra> &amostras,
+                   const vector<pair<int, int> > &pares, float limiar,
+                   int threads, const string &saida) {
+  set<int> niveis;
+  vector<int> lista;
+  vector<vector<float> > ganhos(amostras.size());
+  ProbCut resultado;
+  size_t i, k;
+
+  for (k=0; k<pares.size(); k++) {
+    niveis.insert(pares[k].first);
+    niveis.insert(pares[k].second);
+  }
+  lista.assign(niveis.begin(), niveis.end());
+  paralelo(amostras.size(), threads, [&](size_t i) {
+    for (size_t n=0; n<lista.size(); n++) {
+      ganhos[i].push_back(busca(amostras[i], lista[n]).ganho);
+    }
+  });
+
+  // Um ajuste por tamanho de tabuleiro e par de níveis.
+  set<int> tamanhos;
+  for (i=0; i<amostras.size(); i++) {
+    tamanhos.insert(amostras[i].tam);
+  }
+  resultado.limiar = limiar;
+  cout << "tam nivel raso amostras a b sigma" << endl;
+  for (set<int>::iterator t=tamanhos.begin(); t!=tamanhos.end(); ++t) {
+    for (k=0; k<pares.size(); k++) {
+      size_t fundo = lower_bound(lista.begin(), lista.end(), pares[k].first) -
+                     lista.begin();
+      size_t raso = lower_bound(lista.begin(), lista.end(), pares[k].second) -
+                    lista.begin();
+      double sx = 0, sy = 0, sxx = 0, sxy = 0, n = 0, a, b, residuos = 0;
+      for (i=0; i<amostras.size(); i++) {
+        double x = ganhos[i][raso], y = ganhos[i][fundo];
+        if (amostras[i].tam != *t || fabs(x) >= 999999 || fabs(y) >= 999999) {
+          continue;
+        }
+        sx += x; sy += y; sxx += x * x; sxy += x * y; n++;
+      }
+      if (n < 10 || n * sxx - sx * sx <= 0) {
+        cerr << *t << "x" << *t << " " << pares[k].first << ":"
+             << pares[k].second << ": amostras insuficientes" << endl;
+        continue;
+      }
+      a = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+      b = (sy - a * sx) / n;
+      for (i=0; i<amostras.size(); i++) {
+        double x = ganhos[i][raso], y = ganhos[i][fundo];
+        if (amostras[i].tam != *t || fabs(x) >= 999999 || fabs(y) >= 999999) {
+          continue;
+        }
+        residuos += (y - a * x - b) * (y - a * x - b);
+      }
+      CorteProb c = { *t, pares[k].first, pares[k].second, (float) a,
+                      (float) b, (float) sqrt(residuos / n) };
+      cout << c.tam << " " << c.nivel << " " << c.nivel_raso << " " << n
+           << " " << c.a << " " << c.b << " " << c.sigma << endl;
+      if (a <= 0) {
+        cerr << "  (inclinação não positiva: par descartado)" << endl;
+        continue;
+      }
+      resultado.acrescenta(c);
+    }
+  }
+  if (!resultado.grava(saida)) {
+    perror(saida.c_str());
+    return 1;
+  }
+  return 0;
+}
+
+//// Comparação ///////////////////////////////////////////////////////////////
+
+static int compara(const vector<Amostra> &amostras, ProbCut *parametros,
+                   int nivel, int threads) {
+  vector<Busca> sem(amostras.size()), com(amostras.size());
+  unsigned long long nos_sem = 0, nos_com = 0;
+  double t_sem, t_com, erro = 0;
+  int iguais = 0, n = 0;
+  size_t i;
+
+  typedef chrono::steady_clock Relogio;
+  Relogio::time_point inicio = Relogio::now();
+  probcut = NULL;
+  paralelo(amostras.size(), threads, [&](size_t i) {
+    sem[i] = busca(amostras[i], nivel);
+  });
+  t_sem = chrono::duration<double>(Relogio::now() - inicio).count();
+
+  inicio = Relogio::now();
+  probcut = parametros;
+  paralelo(amostras.size(), threads, [&](size_t i) {
+    com[i] = busca(amostras[i], nivel);
+  });
+  t_com = chrono::duration<double>(Relogio::now() - inicio).count();
+  probcut = NULL;
+
+  for (i=0; i<amostras.size(); i++) {
+    nos_sem += sem[i].nos;
+    nos_com += com[i].nos;
+    iguais += sem[i].pos.linha == com[i].pos.linha &&
+              sem[i].pos.coluna == com[i].pos.coluna;
+    if (fabs(sem[i].ganho) < 999999 && fabs(com[i].ganho) < 999999) {
+      erro += fabs(sem[i].ganho - com[i].ganho);
+      n++;
+    }
+  }
+  cout << fixed << setprecision(2)
+       << amostras.size() << " posições no nível " << nivel << "\n"
+       << "  sem corte: " << nos_sem << " nós, " << t_sem << " s\n"
+       << "  com corte: " << nos_com << " nós, " << t_com << " s ("
+       << 100.0 * nos_com / max(nos_sem, 1ULL) << "% dos nós)\n"
+       << "  mesma jogada em " << 100.0 * iguais / max(amostras.size(),
+                                                       (size_t) 1)
+       << "% das posições; erro médio do ganho " << (n ? erro / n : 0)
+       << endl;
+  return 0;
+}
+
+static void uso(const char *comando) {
+  cerr << "Uso: " << comando << " -o saida [-p nivel:raso,...] [-l limiar]"
+       << " [-n posicoes] [-j threads] [-t tam] entrada...\n"
+       << "     " << comando << " -c parametros [-d nivel] [-n posicoes]"
+       << " [-j threads] [-t tam] entrada...\n";
+  exit(1);
+}
+
+int main(int argc, char *argv[]) {
+  string saida, parametros, pares = "4:2,5:3,6:2,6:4,7:3", erro;
+  int n = 500, threads = sysconf(_SC_NPROCESSORS_ONLN), tam = 8, nivel = 6;
+  float limiar = 1.5;
+  int opcao;
+  Textos textos;
+  vector<Partida> partidas;
+
+  while ((opcao = getopt(argc, argv, "o:p:l:c:d:n:j:t:")) != -1) {
+    switch (opcao) {
+    case 'o': saida = optarg; break;
+    case 'p': pares = optarg; break;
+    case 'l': limiar = atof(optarg); break;
+    case 'c': parametros = optarg; break;
+    case 'd': nivel = atoi(optarg); break;
+    case 'n': n = atoi(optarg); break;
+    case 'j': threads = atoi(optarg); break;
+    case 't': tam = atoi(optarg); break;
+    default: uso(argv[0]);
+    }
+  }
+  if (saida.empty() == parametros.empty() || optind == argc ||
+      threads < 1 || n < 1 || nivel < 1) {
+    uso(argv[0]);
+  }
+
+  if (!le_partidas(vector<string>(argv + optind, argv + argc), tam,
+                   &textos, &partidas, &erro)) {
+    cerr << erro << endl;
+    return 1;
+  }
+  vector<Amostra> amostras = sorteia(partidas, n);
+  cerr << amostras.size() << " posições de " << partidas.size()
+       << " partidas" << endl;
+
+  if (!saida.empty()) {
+    return calibra(amostras, le_pares(pares), limiar, threads, saida);
+  }
+  ProbCut p;
+  if (!p.carrega(parametros, &erro)) {
+    cerr << erro << endl;
+    return 1;
+  }
+  return compara(amostras, &p, nivel, threads);
+}
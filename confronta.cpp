@@ -0,0 +1,874 @@
+//// Confronto entre duas configurações do motor /////////////////////////////
+
+// Uma otimização da busca só vale se o motor continuar jogando tão bem
+// quanto antes (ou melhor), e o *joga()* só põe o motor contra ele
+// mesmo, com uma configuração. O *confronta* põe duas configurações,
+// A e B, uma contra a outra: cada lado é um processo do motor no modo
+// servidor (veja servidor.h), com executável, opções e limites do *go*
+// próprios. Dá para comparar, por exemplo, a compilação nova com a
+// anterior no mesmo nível, o corte provável contra a busca exata, ou
+// um limite de nós contra um prazo.
+//
+// Cada abertura é jogada duas vezes, com as cores trocadas, de forma
+// que a vantagem de uma abertura desequilibrada se cancela. As
+// aberturas são sorteadas (jogadas aleatórias a partir da posição
+// inicial), sem repetir posições simétricas, e só entram as que uma
+// busca no nível *NIVEL_EQUILIBRIO* dá como equilibradas; ou vêm de um
+// arquivo, uma por linha, no formato de *le_posicao()*. As partidas
+// são repartidas entre *threads*, cada uma com o seu par de motores,
+// que recebem *newgame* (esvaziando a tabela de transposição) a cada
+// partida.
+//
+// Uso:
+//
+//     $ ./confronta [-e motor] [-E motor] [-o opcoes] [-O opcoes]
+//                   [-g go] [-G go] [-n aberturas] [-t tam] [-a jogadas]
+//                   [-x margem] [-i aberturas] [-r semente] [-j jogos]
+//                   [-T segundos] [-s elo0,elo1[,alfa,beta]]
+//
+// * -e, -E: executáveis do motor de A e de B (padrão: 'reversi' ao
+//   lado do *confronta*; B usa o de A);
+// * -o, -O: opções do motor de A e de B, separadas por espaços (por
+//   exemplo, "-S 4 -P probcut.txt"); o -s é acrescentado;
+// * -g, -G: limites do *go* de A e de B (padrão "depth 6"; B usa os de
+//   A), por exemplo "nodes 200000" ou "movetime 50";
+// * -n: número de aberturas (padrão 100), isto é, o dobro de partidas;
+// * -t: tamanho do tabuleiro (padrão 8);
+// * -a: jogadas sorteadas em cada abertura (padrão 6);
+// * -x: maior ganho, em peças, da busca de equilíbrio (padrão 2);
+// * -i: arquivo de aberturas, no lugar das sorteadas (-t, -a e -x são
+//   ignorados);
+// * -r: semente do sorteio das aberturas (padrão 1);
+// * -j: partidas em paralelo (padrão: número de núcleos);
+// * -T: prazo de cada jogada, em segundos (padrão 60), somado ao dobro
+//   do *movetime* do lado, se houver;
+// * -s: teste sequencial (SPRT) da hipótese "A é elo1 mais forte" contra
+//   "A é elo0 mais forte", com as probabilidades de erro alfa e beta
+//   (padrão 0.05); o confronto para assim que o teste decide.
+//
+// O progresso vai para a saída de erros a cada par de partidas
+// completado; ao final (ou no Ctrl-C, com o que já foi jogado), a saída
+// mostra:
+//
+// * vitórias, empates e derrotas de A e a contagem dos pares (de 0 a 2
+//   pontos de A nas duas partidas de uma abertura);
+// * a diferença de Elo de A para B, com o intervalo de 95%;
+// * o teste sequencial, se pedido: a razão de verossimilhança (LLR) e os
+//   limites de decisão;
+// * de cada lado, jogadas, nós por jogada e nós por segundo (o tempo é
+//   o do confronto, do *go* ao *bestmove*), e as partidas perdidas por
+//   jogadas ilegais ou por falta de resposta.
+//
+// O Elo é o logístico: a pontuação média *p* de A equivale a
+// 400 log10(p / (1 - p)). Como as duas partidas de uma abertura não são
+// independentes (a abertura pesa nas duas), a variância vem dos pares,
+// e não das partidas (o modelo "pentanomial"); o LLR do teste usa a
+// mesma média e variância, com a aproximação normal.
+//
+// Uma jogada ilegal perde a partida, e a falta de resposta também: o
+// lado cujo motor sai, responde com um erro ou passa do prazo da
+// jogada (-T) perde a partida, e o seu motor é morto e iniciado de
+// novo para as partidas seguintes. Só um motor que não responde ao
+// *isready* logo ao ser iniciado interrompe o confronto.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "reversi.h"
+#include "simetria.h"
+
+// Nível da busca que decide se uma abertura sorteada está equilibrada.
+// No 8x8 com 6 jogadas sorteadas, a margem padrão (2 peças) aceita
+// cerca de três quartos delas.
+static const int NIVEL_EQUILIBRIO = 6;
+
+static volatile sig_atomic_t interrompido = 0;
+
+static void interrompe(int) {
+  interrompido = 1;
+}
+
+//// Configuração /////////////////////////////////////////////////////////////
+
+// Um lado do confronto.
+struct Lado {
+  string motor;
+  vector<string> opcoes;
+  string go;
+  int prazo;              // de cada jogada, em ms
+};
+
+struct Configuracao {
+  Lado lados[2];
+  int aberturas;
+  int tam;
+  int aleatorias;
+  int margem;
+  unsigned semente;
+  int jogos;
+  bool sprt;
+  double elo0, elo1, alfa, beta;
+};
+
+// Separa as palavras de *s* (sem aspas nem escapes).
+static vector<string> palavras(const string &s) {
+  vector<string> v;
+  istringstream entrada(s);
+  string palavra;
+
+  while (entrada >> palavra) {
+    v.push_back(palavra);
+  }
+  return v;
+}
+
+// Prazo de uma jogada com os limites *go*, em ms: *segundos*, mais o
+// dobro do *movetime* (a busca pode passar um pouco do prazo, e o
+// processo pode ficar um tempo sem a CPU com uma partida por núcleo).
+static int prazo_jogada(const string &go, int segundos) {
+  vector<string> v = palavras(go);
+  int movetime = 0;
+  size_t i;
+
+  for (i=0; i+1<v.size(); i++) {
+    if (v[i] == "movetime") {
+      movetime = atoi(v[i + 1].c_str());
+    }
+  }
+  return 2 * movetime + 1000 * segundos;
+}
+
+// Lê "elo0,elo1[,alfa,beta]".
+static bool le_sprt(const string &s, Configuracao *c) {
+  vector<double> v;
+  istringstream entrada(s);
+  string item;
+  char *fim;
+
+  while (getline(entrada, item, ',')) {
+    v.push_back(strtod(item.c_str(), &fim));
+    if (item.empty() || *fim != '\0') {
+      return false;
+    }
+  }
+  if ((v.size() != 2 && v.size() != 4) || v[0] >= v[1]) {
+    return false;
+  }
+  c->elo0 = v[0];
+  c->elo1 = v[1];
+  if (v.size() == 4) {
+    c->alfa = v[2];
+    c->beta = v[3];
+  }
+  c->sprt = true;
+  return c->alfa > 0 && c->alfa < 0.5 && c->beta > 0 && c->beta < 0.5;
+}
+
+//// Aberturas ////////////////////////////////////////////////////////////////
+
+// Uma abertura: a posição e o jogador da vez.
+struct Abertura {
+  string **tabuleiro;
+  char jogador;
+};
+
+// Sorteia até *c.aberturas* aberturas distintas (a menos de simetrias)
+// e equilibradas. Desiste depois de muitas tentativas seguidas sem uma
+// abertura nova, devolvendo as que encontrou.
+static vector<Abertura> sorteia_aberturas(const Configuracao &c) {
+  vector<Abertura> aberturas;
+  set<unsigned long long> vistas;
+  mt19937 sorteio(c.semente);
+  vector<Posicao> jogaveis;
+  Posicao pos;
+  Resultado r;
+  int falhas = 0, i, t;
+  char jogador;
+
+  while ((int) aberturas.size() < c.aberturas && falhas < 1000 &&
+         !interrompido) {
+    string **tabuleiro = novo_tabuleiro(c.tam);
+
+    jogador = PRETO;
+    for (i=0; i<c.aleatorias && jogador != '9'; i++) {
+      jogaveis = pos_jogaveis(jogador, tabuleiro);
+      pos = jogaveis[sorteio() % jogaveis.size()];
+      executa(&pos, jogador, tabuleiro);
+      jogador = proximo(jogador, tabuleiro);
+    }
+    if (jogador == '9' ||
+        !vistas.insert(chave_canonica(jogador, tabuleiro, &t)).second) {
+      libera_tabuleiro(tabuleiro);
+      falhas++;
+      continue;
+    }
+    r = aprofunda(jogador, tabuleiro, NIVEL_EQUILIBRIO, NULL, nullptr);
+    if (fabs(r.ganho) > c.margem) {
+      libera_tabuleiro(tabuleiro);
+      falhas++;
+      continue;
+    }
+    aberturas.push_back(Abertura{tabuleiro, jogador});
+    falhas = 0;
+  }
+  return aberturas;
+}
+
+// Lê as aberturas de um arquivo (uma posição por linha; linhas vazias
+// são ignoradas). Todas devem ter o mesmo tamanho e não podem ter
+// terminado.
+static bool le_aberturas(const string &nome, vector<Abertura> *aberturas) {
+  ifstream entrada(nome.c_str());
+  string linha;
+  Abertura a;
+  int n = 0;
+
+  if (!entrada) {
+    perror(nome.c_str());
+    return false;
+  }
+  while (getline(entrada, linha)) {
+    n++;
+    if (linha.find_first_not_of(" \t\r") == string::npos) {
+      continue;
+    }
+    a.tabuleiro = le_posicao(linha, &a.jogador);
+    if (a.tabuleiro != NULL && !tem_jogada(a.jogador, a.tabuleiro)) {
+      a.jogador = proximo(a.jogador, a.tabuleiro);
+    }
+    if (a.tabuleiro == NULL || a.jogador == '9' ||
+        (!aberturas->empty() && (*a.tabuleiro[0]).size() !=
+         (*(*aberturas)[0].tabuleiro[0]).size())) {
+      cerr << nome << ":" << n << ": abertura inválida" << endl;
+      if (a.tabuleiro != NULL) {
+        libera_tabuleiro(a.tabuleiro);
+      }
+      return false;
+    }
+    aberturas->push_back(a);
+  }
+  return true;
+}
+
+//// Processos do motor ///////////////////////////////////////////////////////
+
+// Um processo do motor no modo servidor, com a entrada e a saída em
+// *pipes*. A saída é lida direto do descritor, com *poll()*, para que
+// um motor travado não prenda a *thread*: toda leitura tem um prazo.
+class Motor {
+
+  pid_t _pid;
+  int _entrada;
+  int _saida;
+  string _lido;           // o que já veio depois da última linha
+
+public:
+
+  Motor() : _pid(-1), _entrada(-1), _saida(-1) {}
+  ~Motor() { encerra(); }
+
+  Motor(const Motor &) = delete;
+  Motor &operator=(const Motor &) = delete;
+
+  bool inicia(const Lado &lado) {
+    int para_motor[2], do_motor[2];
+    vector<char *> args;
+    size_t i;
+
+    if (pipe2(para_motor, O_CLOEXEC) < 0) {
+      perror("pipe");
+      return false;
+    }
+    if (pipe2(do_motor, O_CLOEXEC) < 0) {
+      perror("pipe");
+      close(para_motor[0]);
+      close(para_motor[1]);
+      return false;
+    }
+    args.push_back(const_cast<char *>(lado.motor.c_str()));
+    args.push_back(const_cast<char *>("-s"));
+    for (i=0; i<lado.opcoes.size(); i++) {
+      args.push_back(const_cast<char *>(lado.opcoes[i].c_str()));
+    }
+    args.push_back(NULL);
+
+    _pid = fork();
+    if (_pid < 0) {
+      perror("fork");
+      close(para_motor[0]);
+      close(para_motor[1]);
+      close(do_motor[0]);
+      close(do_motor[1]);
+      return false;
+    }
+    if (_pid == 0) {
+      dup2(para_motor[0], 0);
+      dup2(do_motor[1], 1);
+      execv(lado.motor.c_str(), args.data());
+      perror(lado.motor.c_str());
+      _exit(127);
+    }
+    close(para_motor[0]);
+    close(do_motor[1]);
+    _entrada = para_motor[1];
+    _saida = do_motor[0];
+    _lido.clear();
+
+    // O motor está pronto quando responde ao *isready*; se ele não
+    // começou (executável errado, opção inválida), a saída fecha antes.
+    Relogio::time_point limite =
+      Relogio::now() + chrono::milliseconds(lado.prazo);
+    string linha;
+    if (envia("isready")) {
+      while (le_linha(&linha, limite)) {
+        if (linha == "readyok") {
+          return true;
+        }
+      }
+    }
+    if (!interrompido) {
+      cerr << "\nO motor " << lado.motor << " não respondeu ao isready"
+           << endl;
+    }
+    encerra(true);
+    return false;
+  }
+
+  bool envia(const string &comando) {
+    string linha = comando + "\n";
+    const char *p = linha.data();
+    size_t n = linha.size();
+    ssize_t escrito;
+
+    while (n > 0) {
+      escrito = write(_entrada, p, n);
+      if (escrito < 0 && errno == EINTR) {
+        continue;
+      }
+      if (escrito <= 0) {
+        return false;
+      }
+      p += escrito;
+      n -= escrito;
+    }
+    return true;
+  }
+
+  // Lê a próxima linha, esperando até *limite*. Devolve *false* se o
+  // prazo acabar, se a saída fechar (o motor saiu) ou no Ctrl-C.
+  bool le_linha(string *linha, Relogio::time_point limite) {
+    char dados[4096];
+    struct pollfd p;
+    size_t fim;
+    ssize_t lido;
+    long long resta;
+    int n;
+
+    while ((fim = _lido.find('\n')) == string::npos) {
+      resta = chrono::duration_cast<chrono::milliseconds>(
+        limite - Relogio::now()).count();
+      if (interrompido || resta <= 0) {
+        return false;
+      }
+      // Acordamos a cada 100 ms para ver o Ctrl-C.
+      p.fd = _saida;
+      p.events = POLLIN;
+      n = poll(&p, 1, (int) min(resta, 100LL));
+      if (n < 0 && errno != EINTR) {
+        return false;
+      }
+      if (n <= 0) {
+        continue;
+      }
+      lido = read(_saida, dados, sizeof(dados));
+      if (lido < 0 && errno == EINTR) {
+        continue;
+      }
+      if (lido <= 0) {
+        return false;
+      }
+      _lido.append(dados, lido);
+    }
+    linha->assign(_lido, 0, fim);
+    _lido.erase(0, fim + 1);
+    return true;
+  }
+
+  // Encerra o motor com *quit* ou, se *matar* (ele pode estar travado),
+  // com SIGKILL.
+  void encerra(bool matar = false) {
+    int status;
+
+    if (_pid <= 0) {
+      return;
+    }
+    if (matar) {
+      kill(_pid, SIGKILL);
+    } else {
+      envia("quit");
+    }
+    close(_entrada);
+    close(_saida);
+    waitpid(_pid, &status, 0);
+    _pid = -1;
+  }
+
+};
+
+//// Partidas /////////////////////////////////////////////////////////////////
+
+// Totais de um lado.
+struct Estatisticas {
+  unsigned long long jogadas;
+  unsigned long long nos;
+  double segundos;
+  int ilegais;
+  int sem_resposta;       // partidas perdidas por falta de resposta
+};
+
+// Estado do confronto, compartilhado pelas *threads*.
+struct Confronto {
+  mutex trava;
+  atomic<int> proxima;     // próxima partida a começar
+  atomic<bool> parar;
+  bool falhou;
+  vector<int> pontos;      // meios pontos de A em cada partida (-1)
+  int vitorias, empates, derrotas;
+  int pares[5];            // pares com 0, 1, ..., 4 meios pontos de A
+  Estatisticas lados[2];
+};
+
+// Pede a jogada ao *motor*, com os limites do *lado*. Devolve *false*
+// se ele não respondeu dentro do prazo (ou respondeu com um erro).
+static bool pede_jogada(Motor *motor, const Lado &lado, char jogador,
+                        string **tabuleiro, Posicao *pos,
+                        unsigned long long *nos) {
+  int tam = (*tabuleiro[0]).size() - 2;
+  Relogio::time_point limite =
+    Relogio::now() + chrono::milliseconds(lado.prazo);
+  string linha, palavra;
+  int linha_arq, coluna_arq;
+
+  if (!motor->envia("position " + escreve_posicao(jogador, tabuleiro)) ||
+      !motor->envia("go " + lado.go)) {
+    return false;
+  }
+  while (motor->le_linha(&linha, limite)) {
+    if (linha.compare(0, 6, "error ") == 0) {
+      cerr << "\nO motor respondeu: " << linha << endl;
+      return false;
+    }
+    if (linha.compare(0, 9, "bestmove ") != 0) {
+      continue;
+    }
+    istringstream campos(linha.substr(9));
+    *pos = POS_NULA;
+    *nos = 0;
+    if (campos >> linha_arq >> coluna_arq) {
+      pos->linha = tam - linha_arq;
+      pos->coluna = coluna_arq + 1;
+    } else {
+      campos.clear();
+      campos >> palavra;
+    }
+    while (campos >> palavra) {
+      if (palavra == "nodes") {
+        campos >> *nos;
+      }
+    }
+    return true;
+  }
+  return false;
+}
+
+// O motor do *lado* não respondeu: ele perde a partida e é iniciado de
+// novo. Devolve os meios pontos de A, ou -1 no Ctrl-C ou se o motor não
+// voltar.
+static int sem_resposta(const Configuracao &c, int lado, Motor motores[2],
+                        Estatisticas lados[2]) {
+  motores[lado].encerra(true);
+  if (interrompido) {
+    return -1;
+  }
+  lados[lado].sem_resposta++;
+  cerr << "\nO motor de " << (lado == 0 ? "A" : "B") << " não respondeu"
+       << " e perde a partida; iniciando de novo" << endl;
+  if (!motores[lado].inicia(c.lados[lado])) {
+    return -1;
+  }
+  return lado == 0 ? 0 : 2;
+}
+
+// Joga a partida entre os motores, com A de pretas ou de brancas, e
+// devolve os meios pontos de A (-1 no Ctrl-C ou se um motor não puder
+// ser iniciado de novo).
+static int joga_partida(const Configuracao &c, const Abertura &a,
+                        bool a_pretas, Motor motores[2],
+                        Estatisticas lados[2]) {
+  string **tabuleiro = copia_tabuleiro(a.tabuleiro);
+  int tam = (*tabuleiro[0]).size() - 2, lado, diferenca;
+  char jogador = a.jogador;
+  unsigned long long nos;
+  Relogio::time_point inicio;
+  Posicao pos;
+
+  for (lado=0; lado<2; lado++) {
+    if (!motores[lado].envia("newgame " + to_string(tam))) {
+      libera_tabuleiro(tabuleiro);
+      return sem_resposta(c, lado, motores, lados);
+    }
+  }
+  while (jogador != '9') {
+    // O lado 0 (A) joga com as pretas se *a_pretas*.
+    lado = (jogador == PRETO) == a_pretas ? 0 : 1;
+    inicio = Relogio::now();
+    if (!pede_jogada(&motores[lado], c.lados[lado], jogador, tabuleiro,
+                     &pos, &nos)) {
+      libera_tabuleiro(tabuleiro);
+      return sem_resposta(c, lado, motores, lados);
+    }
+    lados[lado].jogadas++;
+    lados[lado].nos += nos;
+    lados[lado].segundos +=
+      chrono::duration<double>(Relogio::now() - inicio).count();
+    if (pos.linha == -1 || !pos_valida(&pos, jogador, tabuleiro)) {
+      // Jogada ilegal: o lado perde.
+      lados[lado].ilegais++;
+      libera_tabuleiro(tabuleiro);
+      return lado == 0 ? 0 : 2;
+    }
+    executa(&pos, jogador, tabuleiro);
+    jogador = proximo(jogador, tabuleiro);
+  }
+
+  diferenca = pontos(a_pretas ? PRETO : BRANCO, tabuleiro);
+  libera_tabuleiro(tabuleiro);
+  return diferenca > 0 ? 2 : (diferenca == 0 ? 1 : 0);
+}
+
+//// Estatística //////////////////////////////////////////////////////////////
+
+// Pontuação esperada para uma diferença de Elo, e o inverso.
+static double pontuacao(double elo) {
+  return 1 / (1 + pow(10, -elo / 400));
+}
+
+static double elo(double pontuacao) {
+  if (pontuacao <= 0) {
+    return -INFINITY;
+  }
+  if (pontuacao >= 1) {
+    return INFINITY;
+  }
+  return 400 * log10(pontuacao / (1 - pontuacao));
+}
+
+// Média e variância da pontuação de A por par (de 0 a 1), e o número de
+// pares.
+static int media_pares(const int pares[5], double *media,
+                       double *variancia) {
+  int n = 0, k;
+
+  *media = *variancia = 0;
+  for (k=0; k<5; k++) {
+    n += pares[k];
+    *media += pares[k] * k / 4.0;
+  }
+  if (n == 0) {
+    return 0;
+  }
+  *media /= n;
+  for (k=0; k<5; k++) {
+    *variancia += pares[k] * (k / 4.0 - *media) * (k / 4.0 - *media);
+  }
+  *variancia /= n;
+  return n;
+}
+
+// Razão de verossimilhança (logaritmo) entre elo1 e elo0, na
+// aproximação normal; 0 enquanto a variância for nula.
+static double llr(const Configuracao &c, const int pares[5]) {
+  double media, variancia, s0 = pontuacao(c.elo0), s1 = pontuacao(c.elo1);
+  int n = media_pares(pares, &media, &variancia);
+
+  if (n == 0 || variancia == 0) {
+    return 0;
+  }
+  return n * (s1 - s0) * (2 * media - s0 - s1) / (2 * variancia);
+}
+
+//// Threads //////////////////////////////////////////////////////////////////
+
+// Laço de uma *thread*: joga as próximas partidas até acabarem ou até o
+// confronto parar. A partida 2k é a abertura k com A de pretas; a
+// 2k+1, a mesma com as cores trocadas.
+static void trabalha(const Configuracao &c, const vector<Abertura> &aberturas,
+                     Confronto *confronto) {
+  Motor motores[2];
+  Estatisticas lados[2] = {{0, 0, 0, 0, 0}, {0, 0, 0, 0, 0}};
+  int partida, resultado, par, lado;
+  double a, b;
+
+  for (lado=0; lado<2; lado++) {
+    if (!motores[lado].inicia(c.lados[lado])) {
+      lock_guard<mutex> trava(confronto->trava);
+      confronto->falhou = confronto->falhou || !interrompido;
+      confronto->parar = true;
+      return;
+    }
+  }
+
+  while (!confronto->parar.load() && !interrompido &&
+         (partida = confronto->proxima++) < 2 * (int) aberturas.size()) {
+    resultado = joga_partida(c, aberturas[partida / 2], partida % 2 == 0,
+                             motores, lados);
+
+    lock_guard<mutex> trava(confronto->trava);
+    for (lado=0; lado<2; lado++) {
+      confronto->lados[lado].jogadas += lados[lado].jogadas;
+      confronto->lados[lado].nos += lados[lado].nos;
+      confronto->lados[lado].segundos += lados[lado].segundos;
+      confronto->lados[lado].ilegais += lados[lado].ilegais;
+      confronto->lados[lado].sem_resposta += lados[lado].sem_resposta;
+      lados[lado] = Estatisticas{0, 0, 0, 0, 0};
+    }
+    if (resultado < 0) {
+      // O motor que não voltou já foi relatado por *inicia()*.
+      confronto->falhou = confronto->falhou || !interrompido;
+      confronto->parar = true;
+      break;
+    }
+    confronto->pontos[partida] = resultado;
+    if (resultado == 2) {
+      confronto->vitorias++;
+    } else if (resultado == 1) {
+      confronto->empates++;
+    } else {
+      confronto->derrotas++;
+    }
+
+    par = partida / 2;
+    if (confronto->pontos[2 * par] >= 0 &&
+        confronto->pontos[2 * par + 1] >= 0) {
+      confronto->pares[confronto->pontos[2 * par] +
+                       confronto->pontos[2 * par + 1]]++;
+      if (c.sprt) {
+        a = log(c.beta / (1 - c.alfa));
+        b = log((1 - c.beta) / c.alfa);
+        if (llr(c, confronto->pares) <= a || llr(c, confronto->pares) >= b) {
+          confronto->parar = true;
+        }
+      }
+      cerr << "\r" << confronto->vitorias + confronto->empates +
+        confronto->derrotas << " partidas: +" << confronto->vitorias
+           << " =" << confronto->empates << " -" << confronto->derrotas;
+      if (c.sprt) {
+        cerr << ", LLR " << fixed << setprecision(2)
+             << llr(c, confronto->pares);
+      }
+      cerr << "   " << flush;
+    }
+  }
+}
+
+//// Programa principal ///////////////////////////////////////////////////////
+
+static void uso(const char *comando) {
+  cerr << "Uso: " << comando << " [-e motor] [-E motor] [-o opcoes]"
+       << " [-O opcoes] [-g go] [-G go] [-n aberturas] [-t tam]"
+       << " [-a jogadas] [-x margem] [-i aberturas] [-r semente]"
+       << " [-j jogos] [-T segundos] [-s elo0,elo1[,alfa,beta]]\n";
+  exit(1);
+}
+
+// Mostra o resultado do confronto.
+static void relatorio(const Configuracao &c, const Confronto &confronto) {
+  const char *nomes[2] = {"A", "B"};
+  double media, variancia, erro, baixo, alto, a, b, r;
+  int n = media_pares(confronto.pares, &media, &variancia), lado, k;
+
+  cout << "Partidas: " << confronto.vitorias + confronto.empates +
+    confronto.derrotas << " (A: +" << confronto.vitorias << " ="
+       << confronto.empates << " -" << confronto.derrotas << ")\n";
+  cout << "Pares:";
+  for (k=0; k<5; k++) {
+    cout << " " << confronto.pares[k];
+  }
+  cout << " (0 a 2 pontos de A)\n";
+
+  if (n > 0) {
+    erro = 1.96 * sqrt(variancia / n);
+    baixo = elo(media - erro);
+    alto = elo(media + erro);
+    cout << fixed << setprecision(1)
+         << "Elo de A - B: " << showpos << elo(media) << " +- "
+         << noshowpos << (alto - baixo) / 2 << " (95%: " << showpos
+         << baixo << " a " << alto << noshowpos << ")\n";
+  }
+  if (c.sprt) {
+    a = log(c.beta / (1 - c.alfa));
+    b = log((1 - c.beta) / c.alfa);
+    r = llr(c, confronto.pares);
+    cout << fixed << setprecision(2)
+         << "SPRT [" << c.elo0 << ", " << c.elo1 << "] (alfa " << c.alfa
+         << ", beta " << c.beta << "): LLR " << r << " em [" << a << ", "
+         << b << "], "
+         << (r >= b ? "H1 aceita (A é mais forte)" :
+             r <= a ? "H0 aceita" : "inconclusivo") << "\n";
+  }
+  for (lado=0; lado<2; lado++) {
+    const Estatisticas &e = confronto.lados[lado];
+
+    cout << nomes[lado] << ": " << e.jogadas << " jogadas, " << fixed
+         << setprecision(0)
+         << (e.jogadas > 0 ? (double) e.nos / e.jogadas : 0)
+         << " nós/jogada, "
+         << (e.segundos > 0 ? e.nos / e.segundos : 0) << " nós/s";
+    if (e.ilegais > 0) {
+      cout << ", " << e.ilegais << " jogadas ilegais";
+    }
+    if (e.sem_resposta > 0) {
+      cout << ", " << e.sem_resposta << " partidas sem resposta";
+    }
+    cout << "\n";
+  }
+}
+
+int main(int argc, char *argv[]) {
+  Configuracao c;
+  Confronto confronto;
+  vector<Abertura> aberturas;
+  vector<thread> threads;
+  string arquivo_aberturas, motor;
+  bool com_motor_b = false, com_go_b = false;
+  int opcao, t, segundos = 60;
+  size_t i;
+
+  c.lados[0].go = "depth 6";
+  c.aberturas = 100;
+  c.tam = 8;
+  c.aleatorias = 6;
+  c.margem = 2;
+  c.semente = 1;
+  c.jogos = sysconf(_SC_NPROCESSORS_ONLN);
+  c.sprt = false;
+  c.alfa = c.beta = 0.05;
+
+  // O motor fica, por padrão, no mesmo diretório do *confronta*.
+  motor = argv[0];
+  c.lados[0].motor = motor.find('/') == string::npos ? "./reversi" :
+    motor.substr(0, motor.rfind('/') + 1) + "reversi";
+
+  while ((opcao = getopt(argc, argv, "e:E:o:O:g:G:n:t:a:x:i:r:j:T:s:")) != -1) {
+    switch (opcao) {
+    case 'e': c.lados[0].motor = optarg; break;
+    case 'E': c.lados[1].motor = optarg; com_motor_b = true; break;
+    case 'o': c.lados[0].opcoes = palavras(optarg); break;
+    case 'O': c.lados[1].opcoes = palavras(optarg); break;
+    case 'g': c.lados[0].go = optarg; break;
+    case 'G': c.lados[1].go = optarg; com_go_b = true; break;
+    case 'n': c.aberturas = atoi(optarg); break;
+    case 't': c.tam = atoi(optarg); break;
+    case 'a': c.aleatorias = atoi(optarg); break;
+    case 'x': c.margem = atoi(optarg); break;
+    case 'i': arquivo_aberturas = optarg; break;
+    case 'r': c.semente = strtoul(optarg, NULL, 10); break;
+    case 'j': c.jogos = atoi(optarg); break;
+    case 'T': segundos = atoi(optarg); break;
+    case 's':
+      if (!le_sprt(optarg, &c)) {
+        uso(argv[0]);
+      }
+      break;
+    default: uso(argv[0]);
+    }
+  }
+  if (optind < argc || c.aberturas < 1 || c.tam < 4 || c.tam % 2 != 0 ||
+      c.aleatorias < 0 || c.margem < 0 || c.jogos < 1 || segundos < 1) {
+    uso(argv[0]);
+  }
+  if (!com_motor_b) {
+    c.lados[1].motor = c.lados[0].motor;
+  }
+  if (!com_go_b) {
+    c.lados[1].go = c.lados[0].go;
+  }
+  for (t=0; t<2; t++) {
+    c.lados[t].prazo = prazo_jogada(c.lados[t].go, segundos);
+  }
+
+  // Um motor que morre não deve derrubar o confronto.
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGINT, interrompe);
+  signal(SIGTERM, interrompe);
+
+  if (!arquivo_aberturas.empty()) {
+    if (!le_aberturas(arquivo_aberturas, &aberturas)) {
+      return 1;
+    }
+    if ((int) aberturas.size() > c.aberturas) {
+      for (i=c.aberturas; i<aberturas.size(); i++) {
+        libera_tabuleiro(aberturas[i].tabuleiro);
+      }
+      aberturas.resize(c.aberturas);
+    }
+  } else {
+    aberturas = sorteia_aberturas(c);
+    if ((int) aberturas.size() < c.aberturas && !interrompido) {
+      cerr << "Só há " << aberturas.size() << " aberturas distintas e"
+           << " equilibradas; use mais jogadas sorteadas (-a) ou uma"
+           << " margem maior (-x)" << endl;
+    }
+  }
+  if (aberturas.empty()) {
+    cerr << "Nenhuma abertura" << endl;
+    return 1;
+  }
+
+  confronto.proxima = 0;
+  confronto.parar = false;
+  confronto.falhou = false;
+  confronto.pontos.assign(2 * aberturas.size(), -1);
+  confronto.vitorias = confronto.empates = confronto.derrotas = 0;
+  fill(confronto.pares, confronto.pares + 5, 0);
+  for (t=0; t<2; t++) {
+    confronto.lados[t] = Estatisticas{0, 0, 0, 0, 0};
+  }
+
+  for (t=0; t<min(c.jogos, 2 * (int) aberturas.size()); t++) {
+    threads.push_back(thread(trabalha, cref(c), cref(aberturas),
+                             &confronto));
+  }
+  for (i=0; i<threads.size(); i++) {
+    threads[i].join();
+  }
+  cerr << endl;
+
+  for (i=0; i<aberturas.size(); i++) {
+    libera_tabuleiro(aberturas[i].tabuleiro);
+  }
+  relatorio(c, confronto);
+  if (interrompido) {
+    cerr << "Interrompido: o resultado é parcial" << endl;
+  }
+  return confronto.falhou || interrompido ? 1 : 0;
+}
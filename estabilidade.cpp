@@ -0,0 +1,245 @@
+//// Peças estáveis ///////////////////////////////////////////////////////////
+
+// Veja estabilidade.h.
+
+#include <cstring>
+
+#include "perfil.h"
+#include "reversi.h"
+#include "estabilidade.h"
+#include "fronteira.h"
+
+//// Caminho rápido: 8x8 //////////////////////////////////////////////////////
+
+// Como em simetria.cpp, a casa (linha, coluna) é o bit
+// 8 * (linha - 1) + (coluna - 1). Cada eixo vira um par de
+// deslocamentos do *bitboard* inteiro, e a propagação é feita para
+// todas as casas de uma vez.
+
+typedef unsigned long long Bitboard;
+
+static const Bitboard COLUNA_1 = 0x0101010101010101ULL;
+static const Bitboard COLUNA_8 = 0x8080808080808080ULL;
+static const Bitboard LINHA_1 = 0x00000000000000FFULL;
+static const Bitboard LINHA_8 = 0xFF00000000000000ULL;
+
+// Casas das diagonais (linha - coluna constante) e antidiagonais
+// (linha + coluna constante), 15 de cada.
+struct Diagonais {
+  Bitboard diagonal[15], antidiagonal[15];
+
+  Diagonais() {
+    memset(this, 0, sizeof(*this));
+    for (int casa=0; casa<64; casa++) {
+      diagonal[casa / 8 - casa % 8 + 7] |= 1ULL << casa;
+      antidiagonal[casa / 8 + casa % 8] |= 1ULL << casa;
+    }
+  }
+};
+
+static const Diagonais DIAGONAIS;
+
+// Peças de *cor* estáveis, sendo *cheias* as casas cujos eixos estão
+// cheios (um *bitboard* por eixo).
+static Bitboard estaveis_cor(Bitboard cor, const Bitboard cheias[4]) {
+  Bitboard estavel = 0, anterior;
+
+  do {
+    anterior = estavel;
+    estavel = cor &
+      (cheias[0] | (((estavel << 1) & ~COLUNA_1) | COLUNA_1) |
+                   (((estavel >> 1) & ~COLUNA_8) | COLUNA_8)) &
+      (cheias[1] | (estavel << 8) | LINHA_1 | (estavel >> 8) | LINHA_8) &
+      (cheias[2] | (((estavel << 9) & ~COLUNA_1) | COLUNA_1 | LINHA_1) |
+                   (((estavel >> 9) & ~COLUNA_8) | COLUNA_8 | LINHA_8)) &
+      (cheias[3] | (((estavel << 7) & ~COLUNA_8) | COLUNA_8 | LINHA_1) |
+                   (((estavel >> 7) & ~COLUNA_1) | COLUNA_1 | LINHA_8));
+  } while (estavel != anterior);
+  return estavel;
+}
+
+static void estaveis_8x8(Bitboard pretas, Bitboard brancas, int *qtd_pretas,
+                         int *qtd_brancas) {
+  Bitboard ocupadas = pretas | brancas, cheias[4] = {0, 0, 0, 0}, colunas;
+  int i;
+
+  colunas = ocupadas;
+  for (i=0; i<8; i++) {
+    if (((ocupadas >> (8 * i)) & 0xFF) == 0xFF) {
+      cheias[0] |= LINHA_1 << (8 * i);
+    }
+    colunas &= ocupadas >> (8 * i);
+  }
+  cheias[1] = (colunas & 0xFF) * COLUNA_1;
+  for (i=0; i<15; i++) {
+    if ((ocupadas & DIAGONAIS.diagonal[i]) == DIAGONAIS.diagonal[i]) {
+      cheias[2] |= DIAGONAIS.diagonal[i];
+    }
+    if ((ocupadas & DIAGONAIS.antidiagonal[i]) == DIAGONAIS.antidiagonal[i]) {
+      cheias[3] |= DIAGONAIS.antidiagonal[i];
+    }
+  }
+  *qtd_pretas = __builtin_popcountll(estaveis_cor(pretas, cheias));
+  *qtd_brancas = __builtin_popcountll(estaveis_cor(brancas, cheias));
+}
+
+static void bitboards(string **tabuleiro, Bitboard *pretas,
+                      Bitboard *brancas) {
+  int linha, coluna;
+
+  *pretas = *brancas = 0;
+  for (linha=1; linha<=8; linha++) {
+    for (coluna=1; coluna<=8; coluna++) {
+      char peca = (*tabuleiro[linha])[coluna];
+      Bitboard bit = 1ULL << (8 * (linha - 1) + (coluna - 1));
+      *pretas |= peca == PRETO ? bit : 0;
+      *brancas |= peca == BRANCO ? bit : 0;
+    }
+  }
+}
+
+//// Caminho geral ////////////////////////////////////////////////////////////
+
+// Os 4 eixos, cada um dado por uma das suas duas direções.
+static const int EIXOS[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+
+// Marcamos as peças estáveis uma casa por byte, como no tabuleiro com
+// bordas, e propagamos até não mudar mais, alternando o sentido da
+// varredura para que a estabilidade chegue logo aos quatro lados. Toda
+// a memória vem da arena da busca.
+static void estaveis_geral(string **tabuleiro, int *pretas, int *brancas) {
+  int m = (*tabuleiro[0]).size(), n = m - 2;
+  int l, c, e, i, j, k, mudou;
+  char peca;
+  Arena::Marca marca = arena_busca.marca();
+  char *estavel = arena_busca.aloca<char>(m * m);
+  char *cheia[4];
+
+  // Eixos cheios: linhas, colunas, diagonais (l - c constante) e
+  // antidiagonais (l + c constante).
+  for (e=0; e<4; e++) {
+    cheia[e] = arena_busca.aloca<char>(2 * m);
+    memset(cheia[e], 1, 2 * m);
+  }
+  memset(estavel, 0, m * m);
+  for (l=1; l<=n; l++) {
+    for (c=1; c<=n; c++) {
+      if ((*tabuleiro[l])[c] == VAZIO) {
+        cheia[0][l] = 0;
+        cheia[1][c] = 0;
+        cheia[2][l - c + n] = 0;
+        cheia[3][l + c] = 0;
+      }
+    }
+  }
+
+  *pretas = *brancas = 0;
+  k = 0;
+  do {
+    mudou = 0;
+    for (i=0; i<n*n; i++) {
+      j = k % 2 == 0 ? i : n * n - 1 - i;
+      l = j / n + 1;
+      c = j % n + 1;
+      peca = (*tabuleiro[l])[c];
+      if (estavel[l * m + c] || (peca != PRETO && peca != BRANCO)) {
+        continue;
+      }
+      for (e=0; e<4; e++) {
+        int dl = EIXOS[e][0], dc = EIXOS[e][1];
+        int indice = e == 0 ? l : e == 1 ? c : e == 2 ? l - c + n : l + c;
+        char a = (*tabuleiro[l - dl])[c - dc];
+        char b = (*tabuleiro[l + dl])[c + dc];
+        if (!cheia[e][indice] &&
+            a != BORDA && !(a == peca && estavel[(l - dl) * m + c - dc]) &&
+            b != BORDA && !(b == peca && estavel[(l + dl) * m + c + dc])) {
+          break;
+        }
+      }
+      if (e == 4) {
+        estavel[l * m + c] = 1;
+        mudou = 1;
+        if (peca == PRETO) {
+          (*pretas)++;
+        } else {
+          (*brancas)++;
+        }
+      }
+    }
+    k++;
+  } while (mudou);
+  arena_busca.volta(marca);
+}
+
+void estaveis(string **tabuleiro, int *pretas, int *brancas) {
+  Bitboard p, b;
+
+  if ((*tabuleiro[0]).size() == 10) {
+    bitboards(tabuleiro, &p, &b);
+    estaveis_8x8(p, b, pretas, brancas);
+  } else {
+    estaveis_geral(tabuleiro, pretas, brancas);
+  }
+}
+
+//// Corte ////////////////////////////////////////////////////////////////////
+
+// Antes de calcular as peças estáveis, vemos se o corte seria possível
+// mesmo que todas as peças fossem estáveis (no 8x8, o *bitboard* já
+// dá essa contagem de graça). Os limites são os de estabilidade.h,
+// com duas ressalvas: um limite positivo para o oponente não limita
+// nada, pois um fim de jogo vencido vale 999999, e um limite 0
+// significa que o jogo acaba no máximo empatado (que vale 0).
+bool corte_estavel(char jogador, string **tabuleiro, int nivel,
+                   float alfa, float beta, float *ganho) {
+  int m = (*tabuleiro[0]).size(), n = m - 2;
+  int pretas = 0, brancas = 0, meus, dele, max_ocupadas, limite;
+  bool acima, abaixo;
+  Bitboard p = 0, b = 0;
+  Fronteira *f = fronteira(tabuleiro);
+  int l, c;
+  PERFIL_ESCOPO(PERFIL_ESTABILIDADE);
+
+  if (n == 8) {
+    bitboards(tabuleiro, &p, &b);
+    pretas = __builtin_popcountll(p);
+    brancas = __builtin_popcountll(b);
+  } else if (f != NULL) {
+    pretas = f->pecas(PRETO);
+    brancas = f->pecas(BRANCO);
+  } else {
+    for (l=1; l<=n; l++) {
+      for (c=1; c<=n; c++) {
+        pretas += (*tabuleiro[l])[c] == PRETO;
+        brancas += (*tabuleiro[l])[c] == BRANCO;
+      }
+    }
+  }
+  max_ocupadas = min(pretas + brancas + nivel, n * n);
+  meus = jogador == PRETO ? pretas : brancas;
+  dele = jogador == PRETO ? brancas : pretas;
+  acima = 2 * meus - max_ocupadas >= max(beta, 0.0f);
+  abaixo = max_ocupadas - 2 * dele <= min(alfa, 0.0f);
+  if (!acima && !abaixo) {
+    return false;
+  }
+
+  if (n == 8) {
+    estaveis_8x8(p, b, &pretas, &brancas);
+  } else {
+    estaveis_geral(tabuleiro, &pretas, &brancas);
+  }
+  meus = jogador == PRETO ? pretas : brancas;
+  dele = jogador == PRETO ? brancas : pretas;
+  limite = 2 * meus - max_ocupadas;
+  if (acima && limite >= max(beta, 0.0f)) {
+    *ganho = limite;
+    return true;
+  }
+  limite = max_ocupadas - 2 * dele;
+  if (abaixo && limite <= min(alfa, 0.0f)) {
+    *ganho = limite;
+    return true;
+  }
+  return false;
+}
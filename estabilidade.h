@@ -0,0 +1,32 @@
+#ifndef _ESTABILIDADE_H_
+#define _ESTABILIDADE_H_
+
+//// Peças estáveis ///////////////////////////////////////////////////////////
+
+// Uma peça é estável se nenhuma jogada futura pode invertê-la. Usamos
+// o critério conservador de sempre: em cada um dos 4 eixos (linha,
+// coluna e as duas diagonais), a peça precisa estar protegida, seja
+// porque o eixo está cheio (não há onde jogar nele), seja porque um
+// dos vizinhos no eixo é a borda ou uma peça estável da mesma cor (um
+// traçado ao longo do eixo teria que inverter o vizinho também). Os
+// cantos são estáveis logo de início, e a estabilidade se propaga a
+// partir deles até não mudar mais.
+//
+// As peças estáveis limitam o ganho de qualquer busca a partir da
+// posição: com *e* peças estáveis do oponente e no máximo *c* casas
+// ocupadas nas folhas, o jogador termina com no máximo c - e peças, e
+// a diferença não passa de c - 2e. Se esse limite já fica abaixo da
+// janela, o nó pode ser cortado sem ser expandido.
+
+#include <string>
+
+// Conta as peças estáveis de cada cor.
+void estaveis(std::string **tabuleiro, int *pretas, int *brancas);
+
+// Tenta cortar um nó do *minimax()* pelos limites das peças estáveis.
+// Se cortar, retorna *true*, com o limite do ganho (fora da janela) em
+// *ganho*.
+bool corte_estavel(char jogador, std::string **tabuleiro, int nivel,
+                   float alfa, float beta, float *ganho);
+
+#endif /* _ESTABILIDADE_H_ */
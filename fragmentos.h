@@ -0,0 +1,36 @@
+#ifndef _FRAGMENTOS_H_
+#define _FRAGMENTOS_H_
+
+//// Formato dos fragmentos de partidas ///////////////////////////////////////
+
+// As partidas geradas em lote (veja gera.cpp) ficam divididas em
+// fragmentos: pares de arquivos jogos-<k>.txt e jogos-<k>.idx.
+//
+// O .txt guarda as partidas uma após a outra, cada uma com uma linha
+// de cabeçalho seguida das jogadas no formato do arquivo de jogadas:
+//
+//     game <id> size <tam> depth <nivel> seed <semente>
+//     black 2 4
+//     white 2 5
+//     ...
+//
+// O .idx é uma sequência de *EntradaIndice*, uma por partida, na ordem
+// em que foram gravadas, apontando para o trecho do .txt (cabeçalho
+// incluído). Uma partida só conta como gravada depois que sua entrada
+// no índice está completa; o que houver além disso no .txt (por
+// exemplo, depois de uma queda) é descartado ao retomar.
+
+#include <stdint.h>
+
+struct EntradaIndice {
+  uint64_t jogo;          // identificador da partida
+  uint64_t inicio;        // deslocamento no .txt, em bytes
+  uint32_t tamanho;       // bytes da partida, cabeçalho incluído
+  uint16_t tam_tabuleiro;
+  uint16_t nivel;
+};
+
+static_assert(sizeof(EntradaIndice) == 24,
+              "o formato do .idx não depende da plataforma");
+
+#endif /* _FRAGMENTOS_H_ */
@@ -0,0 +1,130 @@
+//// Fronteira do tabuleiro ///////////////////////////////////////////////////
+
+// Veja fronteira.h.
+
+#include <algorithm>
+
+#include "fronteira.h"
+
+thread_local Fronteira *fronteira_busca = NULL;
+
+// Reserva de fronteiras da *thread* (veja *EscopoFronteira*) e quantas
+// estão ligadas.
+static thread_local vector<unique_ptr<Fronteira> > reserva;
+static thread_local size_t em_uso = 0;
+
+void Fronteira::monta(string **tabuleiro) {
+  int l, c, i;
+  char peca;
+
+  _tabuleiro = tabuleiro;
+  _lado = (*tabuleiro[0]).size();
+  _indice.assign(_lado * _lado, -1);
+  _vizinhas.assign(_lado * _lado, 0);
+  _casas.clear();
+  _casas.reserve(_lado * _lado);
+  _pecas[0] = _pecas[1] = 0;
+  for (l=1; l<_lado-1; l++) {
+    for (c=1; c<_lado-1; c++) {
+      peca = (*tabuleiro[l])[c];
+      if (peca == PRETO || peca == BRANCO) {
+        _pecas[peca - '0']++;
+        for (i=0; i<8; i++) {
+          _vizinhas[(l + DIRS[i][0]) * _lado + c + DIRS[i][1]]++;
+        }
+      }
+    }
+  }
+  for (l=1; l<_lado-1; l++) {
+    for (c=1; c<_lado-1; c++) {
+      if ((*tabuleiro[l])[c] == VAZIO && _vizinhas[l * _lado + c] > 0) {
+        insere(l * _lado + c);
+      }
+    }
+  }
+}
+
+void Fronteira::ocupa(const Posicao &pos, char jogador, int viradas) {
+  int casa = pos.linha * _lado + pos.coluna, vizinha, i;
+
+  if (_indice[casa] >= 0) {
+    remove(casa);
+  }
+  for (i=0; i<8; i++) {
+    vizinha = casa + DIRS[i][0] * _lado + DIRS[i][1];
+    if (++_vizinhas[vizinha] == 1 &&
+        (*_tabuleiro[pos.linha + DIRS[i][0]])[pos.coluna + DIRS[i][1]] ==
+        VAZIO) {
+      insere(vizinha);
+    }
+  }
+  _pecas[jogador - '0'] += 1 + viradas;
+  _pecas[1 - (jogador - '0')] -= viradas;
+}
+
+void Fronteira::esvazia(const Posicao &pos, char jogador, int viradas) {
+  int casa = pos.linha * _lado + pos.coluna, vizinha, i;
+
+  for (i=0; i<8; i++) {
+    vizinha = casa + DIRS[i][0] * _lado + DIRS[i][1];
+    if (--_vizinhas[vizinha] == 0 && _indice[vizinha] >= 0) {
+      remove(vizinha);
+    }
+  }
+  if (_vizinhas[casa] > 0) {
+    insere(casa);
+  }
+  _pecas[jogador - '0'] -= 1 + viradas;
+  _pecas[1 - (jogador - '0')] += viradas;
+}
+
+int Fronteira::jogaveis(char jogador, Posicao *v) const {
+  Posicao pos;
+  int i, qtd = 0;
+
+  for (i=0; i<(int) _casas.size(); i++) {
+    pos.linha = _casas[i] / _lado;
+    pos.coluna = _casas[i] % _lado;
+    if (pos_valida(&pos, jogador, _tabuleiro)) {
+      v[qtd++] = pos;
+    }
+  }
+  sort(v, v + qtd, [](const Posicao &a, const Posicao &b) {
+    return a.linha < b.linha || (a.linha == b.linha && a.coluna < b.coluna);
+  });
+  return qtd;
+}
+
+bool Fronteira::tem_jogada(char jogador) const {
+  Posicao pos;
+  int i;
+
+  for (i=0; i<(int) _casas.size(); i++) {
+    pos.linha = _casas[i] / _lado;
+    pos.coluna = _casas[i] % _lado;
+    if (pos_valida(&pos, jogador, _tabuleiro)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+EscopoFronteira::EscopoFronteira(string **tabuleiro) :
+  _anterior(fronteira_busca), _ligada(false) {
+  if ((int) (*tabuleiro[0]).size() - 2 >= TAM_FRONTEIRA &&
+      fronteira(tabuleiro) == NULL) {
+    if (em_uso == reserva.size()) {
+      reserva.emplace_back(new Fronteira());
+    }
+    fronteira_busca = reserva[em_uso++].get();
+    fronteira_busca->monta(tabuleiro);
+    _ligada = true;
+  }
+}
+
+EscopoFronteira::~EscopoFronteira() {
+  if (_ligada) {
+    em_uso--;
+  }
+  fronteira_busca = _anterior;
+}
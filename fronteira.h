@@ -0,0 +1,133 @@
+#ifndef _FRONTEIRA_H_
+#define _FRONTEIRA_H_
+
+//// Fronteira do tabuleiro ///////////////////////////////////////////////////
+
+// Uma jogada só é possível em uma casa vazia vizinha de alguma peça.
+// No 8x8 quase todas as casas vazias são assim, mas nos tabuleiros
+// enormes (64x64 e maiores) a maioria fica longe de tudo, e percorrer
+// todas as casas a cada nó (em *pos_jogaveis()*, *tem_jogada()* e
+// *pontos()*) custa muito mais que a própria busca.
+//
+// A *Fronteira* guarda o conjunto dessas casas e o número de peças de
+// cada cor, atualizados a cada *executa()* e *desfaz()*: ocupar uma
+// casa a tira da fronteira e pode colocar nela as vizinhas vazias;
+// desocupá-la faz o contrário. Cada casa guarda quantas vizinhas
+// ocupadas tem, de forma que a atualização custa 8 incrementos, e o
+// conjunto é um vetor com o índice de cada casa nele, de forma que
+// inserir e remover custam O(1). A geração de jogadas, então, testa só
+// as casas da fronteira e ordena as encontradas por linha e coluna: a
+// ordem é a mesma da varredura completa e a busca visita exatamente os
+// mesmos nós.
+//
+// A fronteira pertence a um tabuleiro e vale enquanto ele só mudar por
+// *executa()* e *desfaz()*. A busca liga uma (veja *EscopoFronteira*)
+// nos tabuleiros de pelo menos *TAM_FRONTEIRA* casas de lado; *joga()*
+// liga uma para a partida inteira, que as buscas das jogadas
+// reaproveitam. Nos demais casos (servidor, lote, Python, benchmark),
+// cada busca remonta a fronteira (uma varredura do tabuleiro, como um
+// *pos_jogaveis()*), mas na memória que a *thread* já usou para a
+// anterior: como a arena, as fronteiras de cada *thread* ficam
+// reservadas de uma busca para a outra, e a busca não chama o alocador
+// (veja bench/bench.cpp).
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "reversi.h"
+
+// Menor tamanho em que a fronteira compensa. No 8x8 quase toda casa
+// vazia está nela, e mantê-la custa mais do que economiza (a partida
+// no nível 8 fica uns 10% mais lenta); no 10x10 ela já ganha 10%.
+const int TAM_FRONTEIRA = 10;
+
+class Fronteira {
+
+  string **_tabuleiro;
+  int _lado;                        // tamanho com as bordas
+  vector<int> _casas;               // casas da fronteira, sem ordem
+  vector<int> _indice;              // posição de cada casa em _casas (-1)
+  vector<unsigned char> _vizinhas;  // peças vizinhas de cada casa
+  int _pecas[2];
+
+  // *_casas* tem espaço reservado para todas as casas: inserir nunca
+  // realoca.
+  void insere(int casa) {
+    _indice[casa] = _casas.size();
+    _casas.push_back(casa);
+  }
+
+  void remove(int casa) {
+    int ultima = _casas.back();
+
+    _casas[_indice[casa]] = ultima;
+    _indice[ultima] = _indice[casa];
+    _casas.pop_back();
+    _indice[casa] = -1;
+  }
+
+public:
+
+  Fronteira() : _tabuleiro(NULL), _lado(0) {}
+
+  // Monta a fronteira do *tabuleiro* percorrendo-o (uma vez). A memória
+  // de uma montagem anterior é reaproveitada, se bastar.
+  void monta(string **tabuleiro);
+
+  Fronteira(const Fronteira &) = delete;
+  Fronteira &operator=(const Fronteira &) = delete;
+
+  string **tabuleiro() const { return _tabuleiro; }
+  int tamanho() const { return _casas.size(); }
+  int pecas(char jogador) const { return _pecas[jogador - '0']; }
+
+  // O *jogador* ocupou a casa, virando *viradas* peças.
+  void ocupa(const Posicao &pos, char jogador, int viradas);
+  // A jogada do *jogador* na casa foi desfeita.
+  void esvazia(const Posicao &pos, char jogador, int viradas);
+
+  // Como *pos_jogaveis()* e *tem_jogada()*, testando só a fronteira.
+  int jogaveis(char jogador, Posicao *v) const;
+  bool tem_jogada(char jogador) const;
+
+};
+
+// Fronteira ligada na *thread* atual (NULL: nenhuma). As funções do
+// motor só a usam para o tabuleiro dela.
+extern thread_local Fronteira *fronteira_busca;
+
+inline Fronteira *fronteira(string **tabuleiro) {
+  return fronteira_busca != NULL &&
+    fronteira_busca->tabuleiro() == tabuleiro ? fronteira_busca : NULL;
+}
+
+// Espaço para as jogadas de uma posição: a fronteira, se houver, ou
+// todas as casas.
+inline int max_jogaveis(string **tabuleiro) {
+  Fronteira *f = fronteira(tabuleiro);
+  int tam = (*tabuleiro[0]).size() - 2;
+
+  return f != NULL ? f->tamanho() : tam * tam;
+}
+
+// Liga uma fronteira para o *tabuleiro* enquanto o escopo durar, a
+// menos que ele seja pequeno ou já tenha uma. As fronteiras vêm de uma
+// reserva da *thread*, uma por nível de escopos aninhados, e só a
+// primeira vez em cada nível (ou em um tabuleiro maior) aloca memória.
+class EscopoFronteira {
+
+  Fronteira *_anterior;
+  bool _ligada;
+
+public:
+
+  explicit EscopoFronteira(string **tabuleiro);
+  ~EscopoFronteira();
+
+  EscopoFronteira(const EscopoFronteira &) = delete;
+  EscopoFronteira &operator=(const EscopoFronteira &) = delete;
+
+};
+
+#endif /* _FRONTEIRA_H_ */
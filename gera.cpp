@@ -0,0 +1,515 @@
+//// Geração de partidas em lote //////////////////////////////////////////////
+
+// Para montar conjuntos de dados, em vez de rodar um './reversi >
+// game.txt' por partida em um *script*, o *gera* mantém um conjunto de
+// processos do motor trabalhando em paralelo (um por núcleo, por
+// padrão), cada um jogando uma partida com configuração e semente
+// próprias, e grava as partidas em fragmentos com índice (veja
+// fragmentos.h).
+//
+// Uso:
+//
+//     $ ./gera -o dir [-n jogos] [-j processos] [-t tam,tam...]
+//              [-d nivel,nivel...] [-m ms,ms...] [-N nos,nos...]
+//              [-a jogadas]
+//              [-r semente]
+//              [-f fragmentos] [-T segundos] [-e motor]
+//
+// * -o: diretório de saída (criado se não existir);
+// * -n: número de partidas (padrão 100);
+// * -j: processos em paralelo (padrão: número de núcleos);
+// * -t, -d, -m, -N: tamanhos de tabuleiro, níveis, prazos por jogada
+//   (em ms) e limites de nós por jogada, combinados em rodízio (padrão
+//   8, 3, 0 e 0; 0 é sem prazo ou sem limite). O limite de nós, ao
+//   contrário do prazo, não depende da máquina nem da carga, e sem
+//   prazo cada partida sai sempre igual para a mesma semente;
+// * -a: jogadas sorteadas no início de cada partida (padrão 4);
+// * -r: semente base; a partida *i* usa a semente base + *i*;
+// * -f: número de fragmentos (padrão: igual a -j);
+// * -T: tempo máximo por partida, em segundos (padrão 0, sem limite);
+// * -e: executável do motor (padrão: 'reversi' ao lado do *gera*).
+//
+// A configuração fica em dir/checkpoint. Se o diretório já tem uma,
+// a geração é retomada de onde parou (as opções de configuração da
+// linha de comando são ignoradas): as partidas já indexadas nos
+// fragmentos não são jogadas de novo. Uma partida cujo processo falha
+// é tentada até 3 vezes. Ctrl-C interrompe a geração, que pode ser
+// retomada depois.
+//
+// O progresso (partidas, partidas/s, jogadas/s e estimativa de
+// término) é mostrado na saída de erros a cada segundo.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "fragmentos.h"
+
+using namespace std;
+
+typedef chrono::steady_clock Relogio;
+
+// Tentativas por partida antes de desistir dela.
+static const int TENTATIVAS = 3;
+
+//// Configuração /////////////////////////////////////////////////////////////
+
+struct Configuracao {
+  int jogos;
+  vector<int> tamanhos;
+  vector<int> niveis;
+  vector<long> prazos;    // ms
+  vector<unsigned long long> limites_nos;
+  int aleatorias;
+  unsigned semente;
+  int fragmentos;
+};
+
+// Lê uma lista de inteiros separados por vírgulas.
+template <typename T>
+static vector<T> le_lista(const string &s) {
+  vector<T> v;
+  istringstream entrada(s);
+  string item;
+
+  while (getline(entrada, item, ',')) {
+    v.push_back((T) strtoll(item.c_str(), NULL, 10));
+  }
+  return v;
+}
+
+template <typename T>
+static string escreve_lista(const vector<T> &v) {
+  ostringstream s;
+  typename vector<T>::size_type i;
+
+  for (i=0; i<v.size(); i++) {
+    s << (i > 0 ? "," : "") << v[i];
+  }
+  return s.str();
+}
+
+// O *checkpoint* é um arquivo de texto com a configuração da geração,
+// uma chave por linha. É escrito em um arquivo temporário e renomeado,
+// para nunca ficar pela metade.
+static bool grava_checkpoint(const string &dir, const Configuracao &c) {
+  string caminho = dir + "/checkpoint", temporario = caminho + ".tmp";
+  ofstream saida(temporario.c_str());
+
+  saida << "versao 1\n"
+        << "jogos " << c.jogos << "\n"
+        << "tamanhos " << escreve_lista(c.tamanhos) << "\n"
+        << "niveis " << escreve_lista(c.niveis) << "\n"
+        << "tempo " << escreve_lista(c.prazos) << "\n"
+        << "nos " << escreve_lista(c.limites_nos) << "\n"
+        << "aleatorias " << c.aleatorias << "\n"
+        << "semente " << c.semente << "\n"
+        << "fragmentos " << c.fragmentos << "\n";
+  saida.close();
+  return !saida.fail() && rename(temporario.c_str(), caminho.c_str()) == 0;
+}
+
+static bool le_checkpoint(const string &dir, Configuracao *c) {
+  ifstream entrada((dir + "/checkpoint").c_str());
+  string chave, valor;
+
+  if (!entrada) {
+    return false;
+  }
+  while (entrada >> chave >> valor) {
+    if (chave == "jogos") c->jogos = atoi(valor.c_str());
+    else if (chave == "tamanhos") c->tamanhos = le_lista<int>(valor);
+    else if (chave == "niveis") c->niveis = le_lista<int>(valor);
+    else if (chave == "tempo") c->prazos = le_lista<long>(valor);
+    else if (chave == "nos") {
+      c->limites_nos = le_lista<unsigned long long>(valor);
+    }
+    else if (chave == "aleatorias") c->aleatorias = atoi(valor.c_str());
+    else if (chave == "semente") c->semente = strtoul(valor.c_str(), NULL, 10);
+    else if (chave == "fragmentos") c->fragmentos = atoi(valor.c_str());
+  }
+  return true;
+}
+
+//// Fragmentos ///////////////////////////////////////////////////////////////
+
+// Um fragmento aberto para acréscimo.
+struct Fragmento {
+  int txt, idx;
+  uint64_t fim; // tamanho válido do .txt
+};
+
+// Escreve tudo, tentando de novo após interrupções.
+static bool escreve_tudo(int fd, const void *dados, size_t n) {
+  const char *p = static_cast<const char *>(dados);
+  ssize_t escrito;
+
+  while (n > 0) {
+    escrito = write(fd, p, n);
+    if (escrito < 0 && errno == EINTR) {
+      continue;
+    }
+    if (escrito <= 0) {
+      return false;
+    }
+    p += escrito;
+    n -= escrito;
+  }
+  return true;
+}
+
+// Abre o fragmento *k*, descartando o que não chegou a ser indexado, e
+// marca em *prontos* as partidas que ele já contém.
+static bool abre_fragmento(const string &dir, int k, Fragmento *f,
+                           vector<bool> *prontos) {
+  ostringstream nome;
+  struct stat st;
+  EntradaIndice e;
+  off_t entradas;
+  off_t i;
+
+  nome << dir << "/jogos-" << k;
+  f->txt = open((nome.str() + ".txt").c_str(), O_RDWR | O_CREAT, 0644);
+  f->idx = open((nome.str() + ".idx").c_str(), O_RDWR | O_CREAT, 0644);
+  if (f->txt < 0 || f->idx < 0 || fstat(f->idx, &st) < 0) {
+    perror(nome.str().c_str());
+    return false;
+  }
+
+  entradas = st.st_size / sizeof(EntradaIndice);
+  f->fim = 0;
+  for (i=0; i<entradas; i++) {
+    if (pread(f->idx, &e, sizeof(e), i * sizeof(e)) != sizeof(e)) {
+      perror(nome.str().c_str());
+      return false;
+    }
+    if (e.jogo < prontos->size()) {
+      (*prontos)[e.jogo] = true;
+    }
+    f->fim = e.inicio + e.tamanho;
+  }
+  if (ftruncate(f->idx, entradas * sizeof(EntradaIndice)) < 0 ||
+      ftruncate(f->txt, f->fim) < 0 ||
+      lseek(f->idx, 0, SEEK_END) < 0 || lseek(f->txt, f->fim, SEEK_SET) < 0) {
+    perror(nome.str().c_str());
+    return false;
+  }
+  return true;
+}
+
+//// Processos ////////////////////////////////////////////////////////////////
+
+// Uma partida sendo jogada por um processo do motor.
+struct Trabalho {
+  pid_t pid;
+  int fd;              // saída do processo
+  uint64_t jogo;
+  int tam, nivel;
+  long prazo;
+  unsigned long long limite_nos;
+  unsigned semente;
+  string saida;
+  Relogio::time_point inicio;
+};
+
+static volatile sig_atomic_t interrompido = 0;
+
+static void interrompe(int) {
+  interrompido = 1;
+}
+
+// Inicia o motor para a partida *t*, com a saída em um *pipe*.
+static bool inicia(const string &motor, const Configuracao &c, Trabalho *t) {
+  int canal[2];
+  string tam, nivel, tempo, nos, aleatorias, semente;
+
+  if (pipe2(canal, O_CLOEXEC) < 0) {
+    perror("pipe");
+    return false;
+  }
+  tam = to_string(t->tam);
+  nivel = to_string(t->nivel);
+  tempo = to_string(t->prazo);
+  nos = to_string(t->limite_nos);
+  aleatorias = to_string(c.aleatorias);
+  semente = to_string(t->semente);
+
+  t->pid = fork();
+  if (t->pid < 0) {
+    perror("fork");
+    close(canal[0]);
+    close(canal[1]);
+    return false;
+  }
+  if (t->pid == 0) {
+    dup2(canal[1], 1);
+    close(canal[0]);
+    close(canal[1]);
+    execl(motor.c_str(), motor.c_str(), "-t", tam.c_str(), "-d",
+          nivel.c_str(), "-m", tempo.c_str(), "-N", nos.c_str(), "-a",
+          aleatorias.c_str(), "-r", semente.c_str(), (char *) NULL);
+    perror(motor.c_str());
+    _exit(127);
+  }
+  close(canal[1]);
+  t->fd = canal[0];
+  t->saida.clear();
+  t->inicio = Relogio::now();
+  return true;
+}
+
+//// Programa principal ///////////////////////////////////////////////////////
+
+static void uso(const char *comando) {
+  cerr << "Uso: " << comando << " -o dir [-n jogos] [-j processos]"
+       << " [-t tam,...] [-d nivel,...] [-m ms,...] [-N nos,...]"
+       << " [-a jogadas] [-r semente]"
+       << " [-f fragmentos] [-T segundos] [-e motor]\n";
+  exit(1);
+}
+
+int main(int argc, char *argv[]) {
+  Configuracao c;
+  string dir, motor, cabecalho;
+  int processos = sysconf(_SC_NPROCESSORS_ONLN), opcao, k;
+  long limite_s = 0;
+  vector<bool> prontos;
+  vector<Fragmento> fragmentos;
+  deque<uint64_t> fila;
+  vector<Trabalho> trabalhando;
+  vector<int> tentativas;
+  vector<struct pollfd> fds;
+  uint64_t jogo, feitos = 0, falhas = 0, jogadas = 0, ja_prontos;
+  uint64_t combinacao;
+  Relogio::time_point inicio = Relogio::now(), ultimo_relatorio = inicio;
+  char dados[4096];
+  ssize_t n;
+  size_t i;
+  int status;
+
+  c.jogos = 100;
+  c.tamanhos.push_back(8);
+  c.niveis.push_back(3);
+  c.prazos.push_back(0);
+  c.limites_nos.push_back(0);
+  c.aleatorias = 4;
+  c.semente = 1;
+  c.fragmentos = 0;
+
+  // O motor fica, por padrão, no mesmo diretório do *gera*.
+  motor = argv[0];
+  motor = motor.find('/') == string::npos ? "./reversi" :
+    motor.substr(0, motor.rfind('/') + 1) + "reversi";
+
+  while ((opcao = getopt(argc, argv, "o:n:j:t:d:m:N:a:r:f:T:e:")) != -1) {
+    switch (opcao) {
+    case 'o': dir = optarg; break;
+    case 'n': c.jogos = atoi(optarg); break;
+    case 'j': processos = atoi(optarg); break;
+    case 't': c.tamanhos = le_lista<int>(optarg); break;
+    case 'd': c.niveis = le_lista<int>(optarg); break;
+    case 'm': c.prazos = le_lista<long>(optarg); break;
+    case 'N': c.limites_nos = le_lista<unsigned long long>(optarg); break;
+    case 'a': c.aleatorias = atoi(optarg); break;
+    case 'r': c.semente = strtoul(optarg, NULL, 10); break;
+    case 'f': c.fragmentos = atoi(optarg); break;
+    case 'T': limite_s = atol(optarg); break;
+    case 'e': motor = optarg; break;
+    default: uso(argv[0]);
+    }
+  }
+  if (dir.empty() || optind < argc || processos < 1) {
+    uso(argv[0]);
+  }
+  if (c.fragmentos <= 0) {
+    c.fragmentos = processos;
+  }
+
+  if (mkdir(dir.c_str(), 0755) < 0 && errno != EEXIST) {
+    perror(dir.c_str());
+    return 1;
+  }
+  if (le_checkpoint(dir, &c)) {
+    cerr << "Retomando a geração em " << dir << endl;
+  } else if (!grava_checkpoint(dir, c)) {
+    cerr << "Não foi possível gravar " << dir << "/checkpoint" << endl;
+    return 1;
+  }
+  if (c.jogos < 0 || c.tamanhos.empty() || c.niveis.empty() ||
+      c.prazos.empty() || c.limites_nos.empty() || c.fragmentos < 1) {
+    cerr << "Configuração inválida" << endl;
+    return 1;
+  }
+
+  prontos.assign(c.jogos, false);
+  fragmentos.resize(c.fragmentos);
+  for (k=0; k<c.fragmentos; k++) {
+    if (!abre_fragmento(dir, k, &fragmentos[k], &prontos)) {
+      return 1;
+    }
+  }
+  for (jogo=0; jogo<(uint64_t) c.jogos; jogo++) {
+    if (!prontos[jogo]) {
+      fila.push_back(jogo);
+    }
+  }
+  ja_prontos = c.jogos - fila.size();
+  if (ja_prontos > 0) {
+    cerr << ja_prontos << " partidas já estavam prontas" << endl;
+  }
+  tentativas.assign(c.jogos, 0);
+
+  signal(SIGINT, interrompe);
+  signal(SIGTERM, interrompe);
+
+  while ((!fila.empty() && !interrompido) || !trabalhando.empty()) {
+    // Completamos o conjunto de processos.
+    while (!interrompido && !fila.empty() &&
+           (int) trabalhando.size() < processos) {
+      Trabalho t;
+      t.jogo = fila.front();
+      // O rodízio percorre os tamanhos, depois os níveis, os prazos e
+      // os limites de nós: todas as combinações aparecem.
+      combinacao = t.jogo;
+      t.tam = c.tamanhos[combinacao % c.tamanhos.size()];
+      combinacao /= c.tamanhos.size();
+      t.nivel = c.niveis[combinacao % c.niveis.size()];
+      combinacao /= c.niveis.size();
+      t.prazo = c.prazos[combinacao % c.prazos.size()];
+      combinacao /= c.prazos.size();
+      t.limite_nos = c.limites_nos[combinacao % c.limites_nos.size()];
+      t.semente = c.semente + t.jogo;
+      if (!inicia(motor, c, &t)) {
+        break;
+      }
+      fila.pop_front();
+      trabalhando.push_back(t);
+    }
+    if (interrompido) {
+      for (i=0; i<trabalhando.size(); i++) {
+        kill(trabalhando[i].pid, SIGKILL);
+      }
+    }
+
+    fds.resize(trabalhando.size());
+    for (i=0; i<trabalhando.size(); i++) {
+      fds[i].fd = trabalhando[i].fd;
+      fds[i].events = POLLIN;
+      fds[i].revents = 0;
+    }
+    if (poll(fds.data(), fds.size(), 250) < 0 && errno != EINTR) {
+      perror("poll");
+      return 1;
+    }
+
+    for (i=trabalhando.size(); i-- > 0; ) {
+      Trabalho &t = trabalhando[i];
+      bool terminou = false;
+
+      if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+        n = read(t.fd, dados, sizeof(dados));
+        if (n > 0) {
+          t.saida.append(dados, n);
+        } else if (n == 0 || errno != EINTR) {
+          terminou = true;
+        }
+      }
+      if (!terminou && limite_s > 0 &&
+          Relogio::now() - t.inicio > chrono::seconds(limite_s)) {
+        kill(t.pid, SIGKILL);
+      }
+      if (!terminou) {
+        continue;
+      }
+
+      close(t.fd);
+      waitpid(t.pid, &status, 0);
+      if (!interrompido && WIFEXITED(status) && WEXITSTATUS(status) == 0 &&
+          !t.saida.empty()) {
+        // A partida vai para o fragmento do seu número: primeiro o
+        // texto, depois a entrada do índice.
+        Fragmento &f = fragmentos[t.jogo % c.fragmentos];
+        EntradaIndice e;
+        ostringstream s;
+
+        s << "game " << t.jogo << " size " << t.tam << " depth " << t.nivel
+          << " seed " << t.semente << "\n";
+        cabecalho = s.str();
+        e.jogo = t.jogo;
+        e.inicio = f.fim;
+        e.tamanho = cabecalho.size() + t.saida.size();
+        e.tam_tabuleiro = t.tam;
+        e.nivel = t.nivel;
+        if (!escreve_tudo(f.txt, cabecalho.data(), cabecalho.size()) ||
+            !escreve_tudo(f.txt, t.saida.data(), t.saida.size()) ||
+            !escreve_tudo(f.idx, &e, sizeof(e))) {
+          perror("write");
+          return 1;
+        }
+        f.fim += e.tamanho;
+        feitos++;
+        jogadas += count(t.saida.begin(), t.saida.end(), '\n');
+      } else if (!interrompido) {
+        if (++tentativas[t.jogo] < TENTATIVAS) {
+          fila.push_front(t.jogo);
+        } else {
+          cerr << "\nPartida " << t.jogo << " falhou " << TENTATIVAS
+               << " vezes; desistindo dela" << endl;
+          falhas++;
+        }
+      }
+      trabalhando.erase(trabalhando.begin() + i);
+    }
+
+    // Relatório de progresso.
+    if (Relogio::now() - ultimo_relatorio >= chrono::seconds(1) ||
+        (fila.empty() && trabalhando.empty())) {
+      double s = chrono::duration<double>(Relogio::now() - inicio).count();
+      uint64_t total = ja_prontos + feitos;
+      double por_s = s > 0 ? feitos / s : 0;
+
+      ultimo_relatorio = Relogio::now();
+      cerr << "\r" << total << "/" << c.jogos << " partidas ("
+           << fixed << setprecision(1)
+           << (c.jogos > 0 ? 100.0 * total / c.jogos : 100.0) << "%), "
+           << setprecision(2) << por_s << " partidas/s, "
+           << setprecision(0) << (s > 0 ? jogadas / s : 0) << " jogadas/s, "
+           << trabalhando.size() << " processos";
+      if (por_s > 0 && !fila.empty()) {
+        cerr << ", faltam ~" << (fila.size() + trabalhando.size()) / por_s
+             << " s";
+      }
+      if (falhas > 0) {
+        cerr << ", " << falhas << " falhas";
+      }
+      cerr << "   " << flush;
+    }
+  }
+  cerr << endl;
+
+  for (k=0; k<c.fragmentos; k++) {
+    close(fragmentos[k].txt);
+    close(fragmentos[k].idx);
+  }
+  if (interrompido) {
+    cerr << "Interrompido; rode de novo com -o " << dir
+         << " para continuar" << endl;
+    return 1;
+  }
+  return falhas > 0 ? 1 : 0;
+}
@@ -0,0 +1,492 @@
+//// Índice de posições das partidas //////////////////////////////////////////
+
+// O *indexa* reproduz uma coleção de partidas (com o *Board* do
+// verificador, em test/) e monta o banco de posições descrito em
+// banco.h: para cada posição que aparece em alguma partida, quantas
+// vezes ela apareceu, como essas partidas terminaram e onde encontrar
+// um exemplo. Depois, responde consultas sobre posições sem reproduzir
+// nada, só sondando o banco mapeado na memória.
+//
+// Uso:
+//
+//     $ ./indexa -o banco [-t tam] [-j threads] entrada...
+//     $ ./indexa -c banco [posicao...]
+//
+// * -o: monta o banco a partir das entradas, que podem ser diretórios
+//   do *gera* (todos os fragmentos indexados deles) ou arquivos de
+//   partidas (o game.txt do motor ou um .txt de fragmento);
+// * -t: tamanho do tabuleiro das partidas sem cabeçalho (padrão 8);
+// * -j: *threads* reproduzindo partidas (padrão: número de núcleos);
+// * -c: consulta as posições dadas (no formato de *le_posicao()*) ou,
+//   sem posições na linha de comando, uma por linha da entrada padrão.
+//
+// As partidas dos fragmentos trazem número e tamanho no cabeçalho; as
+// de arquivos sem cabeçalho são numeradas depois de todas as outras,
+// na ordem da linha de comando.
+//
+// A montagem não guarda todas as posições na memória, para chegar a
+// milhões de partidas. O espaço das chaves é dividido em partes (pelos
+// bits altos da chave); cada *thread* junta as posições repetidas em
+// um *buffer* ordenado e, quando ele enche, despeja cada trecho no
+// arquivo temporário da sua parte. Depois, parte por parte, as
+// entradas são ordenadas e juntadas, e a tabela, gravada direto no
+// arquivo mapeado na memória, na ordem das chaves (veja banco.h). Na
+// memória, fica no máximo uma parte de cada vez. O banco é gravado em
+// um arquivo temporário e renomeado, para nunca ficar pela metade.
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "reversi.h"
+#include "banco.h"
+#include "partidas.h"
+#include "board.h"
+
+typedef chrono::steady_clock Relogio;
+
+// Partidas por parte do espaço de chaves: cerca de 1 milhão de
+// entradas (48 MB) a juntar de cada vez nas partidas do 8x8.
+static const size_t PARTIDAS_POR_PARTE = 16384;
+static const int MAX_BITS_PARTES = 8;
+
+// Entradas no *buffer* de cada *thread* antes de despejá-lo (3 MB).
+static const size_t TAM_BUFFER = 1 << 16;
+
+//// Partes ///////////////////////////////////////////////////////////////////
+
+// Arquivos temporários com as entradas de cada parte, já apagados do
+// diretório (somem ao fechar, mesmo se o *indexa* cair).
+struct Partes {
+  int bits;
+  vector<FILE *> arquivos;
+  unique_ptr<mutex[]> travas;
+  atomic<bool> erro;
+
+  Partes() : bits(0), erro(false) {}
+  ~Partes() {
+    for (size_t i=0; i<arquivos.size(); i++) {
+      fclose(arquivos[i]);
+    }
+  }
+
+  bool abre(const string &base, int bits_partes) {
+    size_t i;
+
+    bits = bits_partes;
+    travas.reset(new mutex[1 << bits]);
+    for (i=0; i<(size_t) 1 << bits; i++) {
+      string nome = base + ".parte-" + to_string(i);
+      FILE *f = fopen(nome.c_str(), "w+b");
+      if (f == NULL) {
+        return false;
+      }
+      unlink(nome.c_str());
+      arquivos.push_back(f);
+    }
+    return true;
+  }
+
+  int parte(uint64_t chave) const {
+    return slot_banco(chave, bits);
+  }
+
+  void acrescenta(int parte, const EntradaBanco *e, size_t n) {
+    lock_guard<mutex> trava(travas[parte]);
+
+    if (fwrite(e, sizeof(EntradaBanco), n, arquivos[parte]) != n) {
+      erro = true;
+    }
+  }
+};
+
+static void junta(EntradaBanco *d, const EntradaBanco &e) {
+  d->ocorrencias += e.ocorrencias;
+  d->vitorias += e.vitorias;
+  d->empates += e.empates;
+  d->derrotas += e.derrotas;
+  d->soma_diferenca += e.soma_diferenca;
+  if (e.jogo < d->jogo) {
+    d->jogo = e.jogo;
+    d->lance = e.lance;
+  }
+}
+
+// Ordena as entradas pela chave e junta as repetidas.
+static void compacta(vector<EntradaBanco> *entradas) {
+  size_t i, n = 0;
+
+  sort(entradas->begin(), entradas->end(),
+       [](const EntradaBanco &a, const EntradaBanco &b) {
+         return a.chave < b.chave;
+       });
+  for (i=0; i<entradas->size(); i++) {
+    if (n > 0 && (*entradas)[n - 1].chave == (*entradas)[i].chave) {
+      junta(&(*entradas)[n - 1], (*entradas)[i]);
+    } else {
+      (*entradas)[n++] = (*entradas)[i];
+    }
+  }
+  entradas->resize(n);
+}
+
+//// Reprodução ///////////////////////////////////////////////////////////////
+
+// Posições vistas por uma *thread* e ainda não despejadas nas partes.
+struct Vistas {
+  vector<EntradaBanco> entradas;
+  Partes *partes;
+};
+
+// Despeja o *buffer*: ordenado, cada parte é um trecho contíguo.
+static void despeja(Vistas *vistas) {
+  vector<EntradaBanco> &v = vistas->entradas;
+  size_t i, j;
+
+  compacta(&v);
+  for (i=0; i<v.size(); i=j) {
+    int parte = vistas->partes->parte(v[i].chave);
+    for (j=i; j<v.size() && vistas->partes->parte(v[j].chave) == parte; j++);
+    vistas->partes->acrescenta(parte, &v[i], j - i);
+  }
+  v.clear();
+}
+
+// Chave do banco para o *Board*, que copiamos para o tabuleiro do
+// motor (a linha 0 do *Board* é a última do motor).
+static uint64_t chave(const Board &board, Cell_state vez,
+                      string **tabuleiro) {
+  int tam = board.size(), r, c;
+  char jogador = vez == black ? PRETO : BRANCO;
+
+  for (r=0; r<tam; r++) {
+    for (c=0; c<tam; c++) {
+      Cell_state s = board[Cell(r, c)];
+      (*tabuleiro[tam - r])[c + 1] =
+        s == black ? PRETO : (s == white ? BRANCO : VAZIO);
+    }
+  }
+  return chave_banco(jogador, tabuleiro);
+}
+
+// Reproduz uma partida e acrescenta suas posições (a inicial, a de
+// depois de cada jogada e a final) a *vistas*. Retorna o número de
+// jogadas, ou -1 se alguma for inválida.
+static int reproduz(const Partida &partida, Vistas *vistas) {
+  Board board(partida.tam);
+  string **tabuleiro;
+  vector<JogadaArquivo> lidas = jogadas(partida);
+  vector<Move> jogadas;
+  vector<uint64_t> chaves;
+  int r, c, pretas = 0, brancas = 0;
+  size_t i;
+
+  for (i=0; i<lidas.size(); i++) {
+    jogadas.push_back(Move(lidas[i].preta ? black : white,
+                           Cell(lidas[i].linha, lidas[i].coluna)));
+  }
+  tabuleiro = novo_tabuleiro(partida.tam);
+  try {
+    for (i=0; i<jogadas.size(); i++) {
+      chaves.push_back(chave(board, jogadas[i].player(), tabuleiro));
+      board.play(jogadas[i]);
+    }
+  }
+  catch (Invalid_move_exception) {
+    libera_tabuleiro(tabuleiro);
+    return -1;
+  }
+  catch (out_of_range &) {
+    libera_tabuleiro(tabuleiro);
+    return -1;
+  }
+  // Na posição final não há jogador da vez de verdade; usamos o
+  // oponente de quem jogou por último, como se a partida seguisse.
+  chaves.push_back(chave(board, jogadas.empty() ||
+                         jogadas.back().player() == white ? black : white,
+                         tabuleiro));
+  libera_tabuleiro(tabuleiro);
+
+  for (r=0; r<partida.tam; r++) {
+    for (c=0; c<partida.tam; c++) {
+      pretas += board[Cell(r, c)] == black;
+      brancas += board[Cell(r, c)] == white;
+    }
+  }
+  for (i=0; i<chaves.size(); i++) {
+    EntradaBanco e;
+    memset(&e, 0, sizeof(e));
+    e.chave = chaves[i];
+    e.ocorrencias = 1;
+    e.vitorias = pretas > brancas;
+    e.empates = pretas == brancas;
+    e.derrotas = pretas < brancas;
+    e.soma_diferenca = pretas - brancas;
+    e.jogo = partida.jogo;
+    e.lance = i;
+    e.tam = partida.tam;
+    vistas->entradas.push_back(e);
+  }
+  if (vistas->entradas.size() >= TAM_BUFFER) {
+    despeja(vistas);
+  }
+  return jogadas.size();
+}
+
+//// Montagem /////////////////////////////////////////////////////////////////
+
+// Lê todas as entradas de uma parte.
+static bool le_parte(FILE *f, vector<EntradaBanco> *entradas) {
+  long bytes;
+
+  if (fflush(f) != 0 || fseek(f, 0, SEEK_END) != 0 || (bytes = ftell(f)) < 0 ||
+      fseek(f, 0, SEEK_SET) != 0) {
+    return false;
+  }
+  entradas->resize(bytes / sizeof(EntradaBanco));
+  return fread(entradas->data(), sizeof(EntradaBanco), entradas->size(), f) ==
+    entradas->size();
+}
+
+// Junta as entradas repetidas de cada parte, regravando-a ordenada e
+// sem repetições, e conta as posições distintas.
+static bool compacta_partes(Partes *partes, uint64_t *posicoes) {
+  vector<EntradaBanco> entradas;
+  size_t i;
+
+  *posicoes = 0;
+  for (i=0; i<partes->arquivos.size(); i++) {
+    FILE *f = partes->arquivos[i];
+    if (!le_parte(f, &entradas)) {
+      return false;
+    }
+    compacta(&entradas);
+    if (ftruncate(fileno(f), 0) < 0 || fseek(f, 0, SEEK_SET) != 0 ||
+        fwrite(entradas.data(), sizeof(EntradaBanco), entradas.size(), f) !=
+        entradas.size()) {
+      return false;
+    }
+    *posicoes += entradas.size();
+  }
+  return true;
+}
+
+// Grava a tabela com as *posicoes* das partes, que, em ordem de parte e
+// de chave, vão sendo postas em ordem nos slots do arquivo mapeado.
+static bool grava_banco(const string &caminho, Partes *partes,
+                        uint64_t posicoes, uint64_t jogos, uint64_t lances) {
+  CabecalhoBanco cabecalho;
+  vector<EntradaBanco> entradas;
+  EntradaBanco *tabela;
+  uint64_t slots = 2, mascara, i, k;
+  string temporario = caminho + ".tmp";
+  size_t bytes, p;
+  void *mapa;
+  int fd, bits = 1;
+  bool ok = true;
+
+  // Ocupação de no máximo metade: as sondagens continuam curtas.
+  while (slots < 2 * posicoes) {
+    slots *= 2;
+    bits++;
+  }
+  mascara = slots - 1;
+
+  memset(&cabecalho, 0, sizeof(cabecalho));
+  memcpy(cabecalho.magica, "RVBANCO3", 8);
+  cabecalho.slots = slots;
+  cabecalho.posicoes = posicoes;
+  cabecalho.jogos = jogos;
+  cabecalho.lances = lances;
+
+  // O arquivo nasce com os slots zerados (vazios), sem escrevê-los.
+  bytes = sizeof(cabecalho) + slots * sizeof(EntradaBanco);
+  fd = open(temporario.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  if (ftruncate(fd, bytes) < 0 ||
+      (mapa = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) ==
+      MAP_FAILED) {
+    close(fd);
+    return false;
+  }
+  madvise(mapa, bytes, MADV_SEQUENTIAL);
+  memcpy(mapa, &cabecalho, sizeof(cabecalho));
+  tabela = reinterpret_cast<EntradaBanco *>(
+    static_cast<CabecalhoBanco *>(mapa) + 1);
+
+  for (p=0; ok && p<partes->arquivos.size(); p++) {
+    ok = le_parte(partes->arquivos[p], &entradas);
+    for (k=0; ok && k<entradas.size(); k++) {
+      for (i=slot_banco(entradas[k].chave, bits); tabela[i].chave != 0;
+           i=(i + 1) & mascara);
+      tabela[i] = entradas[k];
+    }
+  }
+
+  ok = munmap(mapa, bytes) == 0 && ok;
+  ok = close(fd) == 0 && ok;
+  return ok && rename(temporario.c_str(), caminho.c_str()) == 0;
+}
+
+static int monta(const string &saida, const vector<string> &entradas,
+                 int tam, int threads) {
+  Textos textos;
+  vector<Partida> partidas;
+  string erro;
+  Partes partes;
+  vector<Vistas> vistas(threads);
+  vector<thread> trabalhadores;
+  atomic<size_t> proxima(0);
+  atomic<uint64_t> lances(0), invalidas(0);
+  uint64_t posicoes, jogos;
+  Relogio::time_point inicio = Relogio::now();
+  int t, bits = 0;
+
+  if (!le_partidas(entradas, tam, &textos, &partidas, &erro)) {
+    cerr << erro << endl;
+    return 1;
+  }
+  while (bits < MAX_BITS_PARTES &&
+         (PARTIDAS_POR_PARTE << bits) < partidas.size()) {
+    bits++;
+  }
+  if (!partes.abre(saida, bits)) {
+    perror(saida.c_str());
+    return 1;
+  }
+
+  for (t=0; t<threads; t++) {
+    vistas[t].entradas.reserve(TAM_BUFFER);
+    vistas[t].partes = &partes;
+    trabalhadores.push_back(thread([&, t]() {
+      size_t k;
+      int n;
+      while ((k = proxima++) < partidas.size()) {
+        n = reproduz(partidas[k], &vistas[t]);
+        if (n < 0) {
+          invalidas++;
+        } else {
+          lances += n;
+        }
+      }
+      despeja(&vistas[t]);
+      vector<EntradaBanco>().swap(vistas[t].entradas);
+    }));
+  }
+  for (t=0; t<threads; t++) {
+    trabalhadores[t].join();
+  }
+  jogos = partidas.size() - invalidas;
+  vector<Partida>().swap(partidas);
+
+  if (invalidas > 0) {
+    cerr << invalidas << " partida(s) com jogada inválida ignorada(s)" << endl;
+  }
+  if (partes.erro || !compacta_partes(&partes, &posicoes) ||
+      !grava_banco(saida, &partes, posicoes, jogos, lances)) {
+    perror(saida.c_str());
+    return 1;
+  }
+  cerr << jogos << " partidas, " << lances << " jogadas, " << posicoes
+       << " posições distintas em " << fixed << setprecision(2)
+       << chrono::duration<double>(Relogio::now() - inicio).count() << " s"
+       << endl;
+  return 0;
+}
+
+//// Consulta /////////////////////////////////////////////////////////////////
+
+static bool consulta(const BancoPartidas &banco, const string &descricao) {
+  char jogador;
+  string **tabuleiro = le_posicao(descricao, &jogador);
+  const EntradaBanco *e;
+
+  if (tabuleiro == NULL) {
+    cerr << "Posição inválida: " << descricao << endl;
+    return false;
+  }
+  Relogio::time_point inicio = Relogio::now();
+  e = banco.consulta(chave_banco(jogador, tabuleiro));
+  double us = chrono::duration<double, micro>(Relogio::now() - inicio).count();
+  libera_tabuleiro(tabuleiro);
+
+  cout << descricao << "\n";
+  if (e == NULL) {
+    cout << "  não aparece em nenhuma partida";
+  } else {
+    cout << "  " << e->ocorrencias << " partida(s); pretas vencem "
+         << e->vitorias << ", empatam " << e->empates << ", perdem "
+         << e->derrotas << "; diferença média " << fixed << setprecision(2)
+         << (double) e->soma_diferenca / e->ocorrencias
+         << "; ex.: partida " << e->jogo << ", lance " << e->lance;
+  }
+  cout << " (" << fixed << setprecision(1) << us << " us)" << endl;
+  return true;
+}
+
+static void uso(const char *comando) {
+  cerr << "Uso: " << comando << " -o banco [-t tam] [-j threads] entrada...\n"
+       << "     " << comando << " -c banco [posicao...]\n";
+  exit(1);
+}
+
+int main(int argc, char *argv[]) {
+  string saida, caminho, erro, linha;
+  int tam = 8, threads = sysconf(_SC_NPROCESSORS_ONLN), opcao, i;
+  bool ok = true;
+
+  while ((opcao = getopt(argc, argv, "o:c:t:j:")) != -1) {
+    switch (opcao) {
+    case 'o': saida = optarg; break;
+    case 'c': caminho = optarg; break;
+    case 't': tam = atoi(optarg); break;
+    case 'j': threads = atoi(optarg); break;
+    default: uso(argv[0]);
+    }
+  }
+  if (saida.empty() == caminho.empty() || tam < 4 || threads < 1) {
+    uso(argv[0]);
+  }
+
+  if (!saida.empty()) {
+    if (optind == argc) {
+      uso(argv[0]);
+    }
+    return monta(saida, vector<string>(argv + optind, argv + argc),
+                 tam, threads);
+  }
+
+  BancoPartidas banco;
+  if (!banco.abre(caminho, &erro)) {
+    cerr << erro << endl;
+    return 1;
+  }
+  if (optind < argc) {
+    for (i=optind; i<argc; i++) {
+      ok = consulta(banco, argv[i]) && ok;
+    }
+  } else {
+    while (getline(cin, linha)) {
+      if (!linha.empty()) {
+        ok = consulta(banco, linha) && ok;
+      }
+    }
+  }
+  return ok ? 0 : 1;
+}
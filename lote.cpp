@@ -0,0 +1,260 @@
+//// Busca em lote ////////////////////////////////////////////////////////////
+
+// Veja lote.h.
+
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <cmath>
+
+#include "lote.h"
+
+// Estimativa grosseira do custo de uma busca, em nós: com a poda
+// alfa-beta, cada nível multiplica os nós por algo como
+// *RAMIFICACAO*; com prazo, contamos *NOS_POR_MS* nós por ms. Só
+// serve para ordenar e agrupar as buscas (e, no modo determinístico,
+// para trocar o prazo por um limite de nós), então não precisa ser
+// precisa.
+static const double RAMIFICACAO = 3;
+static const double NOS_POR_MS = 1000;
+
+// Custo mínimo de uma tarefa: buscas menores que isso são agrupadas.
+static const double CUSTO_TAREFA = 5000;
+
+// Uma tarefa é uma faixa [inicio, fim) da ordem das buscas.
+struct Tarefa {
+  size_t inicio, fim;
+};
+
+// Fila de tarefas de uma *thread*. A dona consome pela frente (as
+// tarefas mais caras primeiro); as outras roubam do fim.
+class FilaTarefas {
+
+  mutex _mutex;
+  deque<Tarefa> _tarefas;
+
+public:
+
+  void poe(const Tarefa &t) {
+    lock_guard<mutex> trava(_mutex);
+    _tarefas.push_back(t);
+  }
+
+  bool pega(Tarefa *t) {
+    lock_guard<mutex> trava(_mutex);
+    if (_tarefas.empty()) {
+      return false;
+    }
+    *t = _tarefas.front();
+    _tarefas.pop_front();
+    return true;
+  }
+
+  bool rouba(Tarefa *t) {
+    lock_guard<mutex> trava(_mutex);
+    if (_tarefas.empty()) {
+      return false;
+    }
+    *t = _tarefas.back();
+    _tarefas.pop_back();
+    return true;
+  }
+
+};
+
+// Totais somados pelas *threads* ao terminar.
+struct Totais {
+  atomic<size_t> roubos;
+  atomic<unsigned long long> nos, consultas, acertos, guardas, substituicoes;
+};
+
+static double custo(const PedidoLote &p) {
+  int tam = (*p.tabuleiro[0]).size() - 2, vazias = 0, niveis, i, j;
+  double nos;
+
+  for (i=1; i<=tam; i++) {
+    for (j=1; j<=tam; j++) {
+      vazias += (*p.tabuleiro[i])[j] == VAZIO;
+    }
+  }
+  niveis = p.nivel_max > 0 ? min(p.nivel_max, vazias) : vazias;
+  nos = pow(RAMIFICACAO, niveis);
+  if (p.tempo_ms > 0) {
+    nos = min(nos, p.tempo_ms * NOS_POR_MS);
+  }
+  if (p.nos_max > 0) {
+    nos = min(nos, (double) p.nos_max);
+  }
+  return nos;
+}
+
+// Limite de nós de um pedido: no modo determinístico, o prazo também
+// vira nós.
+static unsigned long long limite_nos(const PedidoLote &p,
+                                     const OpcoesLote &opcoes) {
+  unsigned long long nos = p.nos_max;
+
+  if (opcoes.deterministica && p.tempo_ms > 0 &&
+      (nos == 0 || nos > p.tempo_ms * NOS_POR_MS)) {
+    nos = p.tempo_ms * NOS_POR_MS;
+  }
+  return nos;
+}
+
+// Laço de uma *thread* do lote: consome a própria fila e depois rouba
+// das outras, a partir da seguinte, até todas estarem vazias (nenhuma
+// tarefa nova aparece durante o lote, então uma volta sem sucesso
+// basta para terminar). No modo determinístico, só a própria fila.
+static void trabalha(int t, vector<FilaTarefas> &filas,
+                     const Topologia &topologia,
+                     const vector<TabelaTransposicao *> &compartilhadas,
+                     const vector<size_t> &ordem,
+                     const vector<PedidoLote> &pedidos,
+                     const OpcoesLote &opcoes, vector<Resultado> &resultados,
+                     Totais &totais) {
+  TabelaTransposicao *tabela = NULL;
+  ContadoresTT inicio = contadores_tt;
+  Controle controle;
+  Tarefa tarefa = {0, 0};
+  int n = filas.size(), v, tam;
+  size_t k;
+
+  fixa_thread(topologia, opcoes.afinidade, t);
+  if (!compartilhadas.empty()) {
+    tabela = compartilhadas[t % compartilhadas.size()];
+  } else if (opcoes.tabela_mb > 0) {
+    tabela = new TabelaTransposicao(opcoes.tabela_mb,
+                                    opcoes.paginas_grandes);
+  }
+  tabela_busca = tabela;
+  while (true) {
+    if (!filas[t].pega(&tarefa)) {
+      if (opcoes.deterministica) {
+        break;
+      }
+      for (v=1; v<n && !filas[(t + v) % n].rouba(&tarefa); v++);
+      if (v == n) {
+        break;
+      }
+      totais.roubos++;
+    }
+    for (k=tarefa.inicio; k<tarefa.fim; k++) {
+      const PedidoLote &p = pedidos[ordem[k]];
+      string **tabuleiro = copia_tabuleiro(p.tabuleiro);
+
+      tam = (*tabuleiro[0]).size() - 2;
+      controle.parar = false;
+      controle.prazo = Relogio::now() + chrono::milliseconds(p.tempo_ms);
+      controle.com_prazo = p.tempo_ms > 0 && !opcoes.deterministica;
+      controle.nos_max = limite_nos(p, opcoes);
+      resultados[ordem[k]] =
+        aprofunda(p.jogador, tabuleiro,
+                  p.nivel_max > 0 ? p.nivel_max : tam * tam, &controle,
+                  nullptr);
+      totais.nos += resultados[ordem[k]].nos;
+      libera_tabuleiro(tabuleiro);
+    }
+  }
+  tabela_busca = NULL;
+  if (compartilhadas.empty()) {
+    delete tabela;
+  }
+  totais.consultas += contadores_tt.consultas - inicio.consultas;
+  totais.acertos += contadores_tt.acertos - inicio.acertos;
+  totais.guardas += contadores_tt.guardas - inicio.guardas;
+  totais.substituicoes += contadores_tt.substituicoes - inicio.substituicoes;
+}
+
+// Cria a tabela compartilhada do nó *no* (em uma *thread* fixada nele,
+// para que as páginas fiquem na sua memória).
+static void cria_tabela(int no, const Topologia &topologia,
+                        const OpcoesLote &opcoes,
+                        TabelaTransposicao **tabela) {
+  if (opcoes.afinidade != AFINIDADE_NENHUMA) {
+    fixa_thread(topologia, AFINIDADE_NO, no);
+  }
+  *tabela = new TabelaTransposicao(opcoes.tabela_mb, opcoes.paginas_grandes);
+}
+
+vector<Resultado> busca_lote(const vector<PedidoLote> &pedidos,
+                             const OpcoesLote &opcoes,
+                             EstatisticasLote *estatisticas) {
+  Relogio::time_point inicio = Relogio::now();
+  size_t n = pedidos.size(), i, k;
+  vector<Resultado> resultados(n);
+  vector<double> custos(n);
+  vector<size_t> ordem(n);
+  vector<Tarefa> tarefas;
+  vector<thread> trabalhadores, criadores;
+  Topologia topologia = le_topologia();
+  vector<TabelaTransposicao *> compartilhadas;
+  Totais totais = {{0}, {0}, {0}, {0}, {0}, {0}};
+  int threads = opcoes.threads, t;
+  double soma;
+
+  // Das buscas mais caras para as mais baratas, juntando as pequenas
+  // em tarefas de pelo menos *CUSTO_TAREFA*.
+  for (i=0; i<n; i++) {
+    custos[i] = custo(pedidos[i]);
+    ordem[i] = i;
+  }
+  stable_sort(ordem.begin(), ordem.end(), [&](size_t a, size_t b) {
+    return custos[a] > custos[b];
+  });
+  for (i=0; i<n; i=k) {
+    soma = 0;
+    for (k=i; k<n && soma<CUSTO_TAREFA; k++) {
+      soma += custos[ordem[k]];
+    }
+    Tarefa tarefa = {i, k};
+    tarefas.push_back(tarefa);
+  }
+
+  if (threads <= 0) {
+    threads = topologia.nucleos();
+  }
+  threads = max(1, min(threads, (int) tarefas.size()));
+  vector<FilaTarefas> filas(threads);
+  for (i=0; i<tarefas.size(); i++) {
+    filas[i % threads].poe(tarefas[i]);
+  }
+  if (opcoes.compartilhada && opcoes.tabela_mb > 0 &&
+      !opcoes.deterministica) {
+    compartilhadas.resize(min(threads, (int) topologia.nos.size()));
+    for (t=0; t<(int) compartilhadas.size(); t++) {
+      criadores.push_back(thread(cria_tabela, t, cref(topologia),
+                                 cref(opcoes), &compartilhadas[t]));
+    }
+    for (t=0; t<(int) compartilhadas.size(); t++) {
+      criadores[t].join();
+    }
+  }
+  for (t=0; t<threads; t++) {
+    trabalhadores.push_back(thread(trabalha, t, ref(filas), cref(topologia),
+                                   cref(compartilhadas), cref(ordem),
+                                   cref(pedidos), cref(opcoes),
+                                   ref(resultados), ref(totais)));
+  }
+  for (t=0; t<threads; t++) {
+    trabalhadores[t].join();
+  }
+  for (t=0; t<(int) compartilhadas.size(); t++) {
+    delete compartilhadas[t];
+  }
+
+  if (estatisticas != NULL) {
+    estatisticas->posicoes = n;
+    estatisticas->tarefas = tarefas.size();
+    estatisticas->roubos = totais.roubos;
+    estatisticas->threads = threads;
+    estatisticas->nos = totais.nos;
+    estatisticas->tabela.consultas = totais.consultas;
+    estatisticas->tabela.acertos = totais.acertos;
+    estatisticas->tabela.guardas = totais.guardas;
+    estatisticas->tabela.substituicoes = totais.substituicoes;
+    estatisticas->segundos =
+      chrono::duration<double>(Relogio::now() - inicio).count();
+  }
+  return resultados;
+}
@@ -0,0 +1,96 @@
+#ifndef _LOTE_H_
+#define _LOTE_H_
+
+//// Busca em lote ////////////////////////////////////////////////////////////
+
+// Para analisar milhares de posições independentes (conjuntos de dados,
+// anotação de partidas), chamar *planeja()* uma a uma deixa núcleos
+// parados. A busca em lote recebe todas as posições de uma vez, cada
+// uma com seus limites, e distribui as buscas por um *pool* de
+// *threads* com roubo de trabalho:
+//
+// * estimamos o custo de cada busca (pelo nível, pelas casas vazias ou
+//   pelo prazo) e juntamos as buscas pequenas em tarefas de custo
+//   parecido, para que o custo de escalonar não pese;
+// * as tarefas são repartidas entre as filas das *threads*, das mais
+//   caras para as mais baratas; cada *thread* consome a sua fila pela
+//   frente e, quando ela esvazia, rouba tarefas do fim da fila das
+//   outras, até não sobrar nenhuma.
+//
+// O objetivo é a vazão (posições por segundo), não a latência de cada
+// posição: a ordem em que as buscas terminam não é a dos pedidos, mas
+// os resultados voltam na ordem dos pedidos.
+//
+// Cada *thread* tem sua própria tabela de transposição, que não é
+// esvaziada entre uma posição e outra (as entradas valem para a
+// posição inteira, então uma posição já vista por outra busca da mesma
+// *thread* apenas sai mais barata). Com afinidade (veja afinidade.h),
+// cada *thread* se fixa antes de criar a sua tabela, que assim fica na
+// memória do seu nó NUMA.
+//
+// Também é possível ter uma só tabela por nó NUMA, compartilhada sem
+// travas pelas *threads* do nó (veja transposicao.h) e criada por uma
+// *thread* fixada nele: as buscas de uma *thread* aproveitam as das
+// outras, mas os nós visitados (e, em empates, a jogada) passam a
+// depender da ordem em que as *threads* escrevem.
+//
+// No modo determinístico, os resultados (jogadas, ganhos e nós) saem
+// idênticos em toda execução com as mesmas posições e o mesmo número
+// de *threads*, em qualquer máquina: as tarefas são repartidas como
+// acima, mas cada *thread* busca só as da sua fila, na ordem, sem
+// roubar; as tabelas são sempre uma por *thread*; e o prazo de cada
+// pedido vira um limite de nós (*NOS_POR_MS* nós por ms, veja
+// lote.cpp). O preço é a vazão: sem roubo, o lote termina quando a
+// *thread* mais carregada termina (veja o README).
+
+#include <vector>
+
+#include "reversi.h"
+#include "afinidade.h"
+
+// Uma posição a buscar, com o aprofundamento iterativo até *nivel_max*,
+// até o prazo de *tempo_ms* e/ou até *nos_max* nós (como no *go* do
+// servidor: com prazo ou limite de nós, *nivel_max* pode ser 0). O
+// tabuleiro é do chamador e não é alterado.
+struct PedidoLote {
+  char jogador;
+  string **tabuleiro;
+  int nivel_max;
+  long tempo_ms;
+  unsigned long long nos_max;
+};
+
+struct OpcoesLote {
+  int threads;            // 0: um por núcleo
+  size_t tabela_mb;       // cada tabela (0: sem tabela)
+  bool compartilhada;     // uma tabela por nó em vez de uma por *thread*
+  Afinidade afinidade;
+  bool paginas_grandes;   // tabelas com páginas grandes
+  bool deterministica;    // sem roubo, sem prazo e sem tabela compartilhada
+
+  OpcoesLote()
+    : threads(0), tabela_mb(TAM_TABELA_PADRAO), compartilhada(false),
+      afinidade(AFINIDADE_NENHUMA), paginas_grandes(false),
+      deterministica(false) {}
+};
+
+struct EstatisticasLote {
+  size_t posicoes, tarefas, roubos;
+  int threads;
+  unsigned long long nos;
+  double segundos;
+  ContadoresTT tabela;    // consultas de todas as *threads* às tabelas
+
+  double posicoes_por_segundo() const {
+    return segundos > 0 ? posicoes / segundos : 0;
+  }
+};
+
+// Busca todas as posições e retorna um resultado por pedido, na mesma
+// ordem. Se *estatisticas* não for NULL, preenche-a com os totais do
+// lote.
+vector<Resultado> busca_lote(const vector<PedidoLote> &pedidos,
+                             const OpcoesLote &opcoes,
+                             EstatisticasLote *estatisticas);
+
+#endif /* _LOTE_H_ */
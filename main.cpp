@@ -0,0 +1,223 @@
+//// Programa principal do Reversi (em C++) ///////////////////////////////////
+
+// Sem argumentos, fazemos uma chamada padrão à função *joga()*, lendo o
+// tamanho do tabuleiro e o nível máximo do *minimax* de reversi.conf.
+// Com as opções abaixo, o motor fica no ar como servidor de análise
+// (veja o protocolo em servidor.h):
+//
+//     $ ./reversi -s              # comandos por stdin/stdout
+//     $ ./reversi -u /tmp/rev.s   # comandos por um socket Unix
+//
+// Com -h, uma pessoa joga contra o motor pelo terminal, com as peças
+// pretas (-h 0) ou brancas (-h 1); enquanto ela pensa, o motor pondera
+// a resposta prevista (padrão), todas as respostas ou nada, conforme a
+// opção -p (veja pondera.h):
+//
+//     $ ./reversi -h 0 -p todas > jogadas.txt
+//
+// A opção -c escolhe outro arquivo de configuração; -t e -d substituem
+// o tamanho do tabuleiro e o nível lidos dele. Para gerar partidas em
+// lote (veja gera.cpp), -m dá um prazo por jogada em ms e -a sorteia as
+// primeiras jogadas com a semente de -r:
+//
+//     $ ./reversi -t 10 -d 4 -m 50 -a 6 -r 42 > jogadas.txt
+//
+// Com -S N, a tabela de transposição (servidor e modo humano) junta as
+// posições simétricas nos nós com pelo menos N níveis restantes (veja
+// simetria.h).
+//
+// Com -P, a busca usa o corte provável com os parâmetros do arquivo
+// dado, calibrados pelo *calibra* (veja probcut.h); sem ela, a busca é
+// exata.
+//
+// Com -N, cada jogada é buscada até um limite de nós em vez de um
+// prazo: a partida fica determinística (a mesma semente dá sempre as
+// mesmas jogadas, em qualquer máquina). Com -L, a busca de cada
+// jogada é registrada no arquivo dado, até -l níveis abaixo da raiz
+// (padrão 2), e -R refaz as buscas de um registro, escrevendo o novo
+// registro na saída (veja registro.h):
+//
+//     $ ./reversi -t 8 -d 8 -N 200000 -a 4 -r 7 -L busca.log > jogadas.txt
+//     $ ./reversi -R busca.log | diff busca.log -
+//
+// Com -M, as jogadas buscadas (em qualquer modo) alimentam as métricas
+// de produção (histogramas de latência por tamanho e fase, nós por
+// segundo e acertos na tabela, veja metricas.h), exportadas no formato
+// do Prometheus para o arquivo dado, reescrito a cada -I segundos
+// (padrão 10), ou servidas em um *socket* Unix com "unix:caminho":
+//
+//     $ ./reversi -u /tmp/rev.s -M unix:/tmp/rev-metricas.s
+//     $ curl -s --unix-socket /tmp/rev-metricas.s http://x/metrics
+//
+// Compilado com o perfil ('make PERFIL=1', veja perfil.h), o programa
+// mostra em stderr, ao fim da partida (ou da sessão), o tempo de cada
+// fase da busca por *thread*; com -J, grava também o traço da -j-ésima
+// jogada buscada (padrão 1), para abrir no *chrome://tracing*:
+//
+//     $ make clean && make PERFIL=1
+//     $ ./reversi -t 8 -d 7 -J jogada.json -j 10 > jogadas.txt
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <unistd.h>
+
+#include "reversi.h"
+#include "servidor.h"
+#include "pondera.h"
+#include "probcut.h"
+#include "registro.h"
+#include "metricas.h"
+#include "perfil.h"
+
+static void uso(const char *comando) {
+  cerr << "Uso: " << comando << " [-c configuracao] [-t tam] [-d nivel]"
+       << " [-S nivel] [-P probcut] [-M arquivo|unix:socket [-I segundos]]"
+       << " [-s | -u socket | -h 0|1 [-p nao|prevista|todas] |"
+       << " [-m ms] [-N nos] [-a jogadas] [-r semente]"
+       << " [-L registro [-l niveis]] | -R registro]"
+       << " [-J traco [-j jogada]]\n";
+  exit(1);
+}
+
+int main(int argc, char *argv[]) {
+  string nome_conf = "reversi.conf", modo_ponder = "prevista";
+  const char *caminho_socket = NULL, *humano = NULL, *parametros = NULL;
+  const char *nome_registro = NULL, *nome_repete = NULL;
+  const char *destino_metricas = NULL, *arquivo_traco = NULL;
+  double intervalo_metricas = 10;
+  bool servidor = false;
+  int nivel = 0, tam_tabuleiro = 0, aleatorias = 0, niveis_registro = 2;
+  int jogada_traco = 1, opcao;
+  long tempo_ms = 0;
+  unsigned long long nos_max = 0;
+  unsigned semente = 0;
+
+  while ((opcao = getopt(argc, argv, "c:su:h:p:t:d:m:N:a:r:S:P:L:l:R:M:I:J:j:"))
+         != -1) {
+    switch (opcao) {
+    case 'c': nome_conf = optarg; break;
+    case 's': servidor = true; break;
+    case 'u': caminho_socket = optarg; break;
+    case 'h': humano = optarg; break;
+    case 'p': modo_ponder = optarg; break;
+    case 't': tam_tabuleiro = atoi(optarg); break;
+    case 'd': nivel = atoi(optarg); break;
+    case 'm': tempo_ms = atol(optarg); break;
+    case 'N': nos_max = strtoull(optarg, NULL, 10); break;
+    case 'a': aleatorias = atoi(optarg); break;
+    case 'r': semente = strtoul(optarg, NULL, 10); break;
+    case 'S': nivel_simetria = atoi(optarg); break;
+    case 'P': parametros = optarg; break;
+    case 'L': nome_registro = optarg; break;
+    case 'l': niveis_registro = atoi(optarg); break;
+    case 'R': nome_repete = optarg; break;
+    case 'M': destino_metricas = optarg; break;
+    case 'I': intervalo_metricas = atof(optarg); break;
+    case 'J': arquivo_traco = optarg; break;
+    case 'j': jogada_traco = atoi(optarg); break;
+    default: uso(argv[0]);
+    }
+  }
+  if (optind < argc ||
+      (humano != NULL && string(humano) != "0" && string(humano) != "1") ||
+      (modo_ponder != "nao" && modo_ponder != "prevista" &&
+       modo_ponder != "todas") || niveis_registro < 0 ||
+      intervalo_metricas <= 0 || jogada_traco < 1) {
+    uso(argv[0]);
+  }
+  if (arquivo_traco != NULL) {
+    if (!perfil_compilado()) {
+      cerr << "O traço precisa do perfil: compile com 'make clean && "
+           << "make PERFIL=1'" << endl;
+      return 1;
+    }
+    perfil_traca(arquivo_traco, jogada_traco);
+  }
+
+  ProbCut parametros_probcut;
+  if (parametros != NULL) {
+    string erro;
+    if (!parametros_probcut.carrega(parametros, &erro)) {
+      cerr << erro << endl;
+      return 1;
+    }
+    probcut = &parametros_probcut;
+  }
+
+  MetricasMotor metricas;
+  ExportadorMetricas exportador(metricas, destino_metricas != NULL ?
+                                destino_metricas : "", intervalo_metricas);
+  if (destino_metricas != NULL) {
+    string erro;
+    if (!exportador.inicia(&erro)) {
+      cerr << erro << endl;
+      return 1;
+    }
+    metricas_motor = &metricas;
+  }
+
+  if (nome_repete != NULL) {
+    ifstream entrada(nome_repete);
+    string erro;
+    if (!entrada) {
+      cerr << "Não foi possível abrir o registro: " << nome_repete << endl;
+      return 1;
+    }
+    if (!repete(entrada, cout, &erro)) {
+      cerr << erro << endl;
+      return 1;
+    }
+    perfil_relatorio(cerr);
+    return 0;
+  }
+  if (caminho_socket != NULL) {
+    return serve_unix(caminho_socket);
+  }
+  if (servidor) {
+    serve_sessao(0, 1);
+    perfil_relatorio(cerr);
+    return 0;
+  }
+
+  // Lemos o tamanho do tabuleiro e a quantidade máxima de níveis de um
+  // arquivo de configuração, a menos que ambos venham da linha de
+  // comando.
+  if (tam_tabuleiro == 0 || nivel == 0) {
+    ifstream conf_file(nome_conf.c_str());
+    int tam_conf, nivel_conf;
+    conf_file >> tam_conf;
+    conf_file >> nivel_conf;
+    if (conf_file.fail()) {
+      cerr << "Arquivo de configuração inválido: " << nome_conf << endl;
+      return 1;
+    }
+    tam_tabuleiro = tam_tabuleiro == 0 ? tam_conf : tam_tabuleiro;
+    nivel = nivel == 0 ? nivel_conf : nivel;
+  }
+  if (tam_tabuleiro < 4 || tam_tabuleiro % 2 != 0 || nivel < 1) {
+    cerr << "Tamanho ou nível inválido: " << tam_tabuleiro << " "
+         << nivel << endl;
+    return 1;
+  }
+
+  if (humano != NULL) {
+    joga_humano(nivel, tam_tabuleiro, humano[0], modo_ponder);
+  } else if (nome_registro != NULL) {
+    ofstream saida(nome_registro);
+    if (!saida) {
+      cerr << "Não foi possível criar o registro: " << nome_registro << endl;
+      return 1;
+    }
+    RegistroBusca registro(saida, niveis_registro);
+    registro.cabecalho();
+    registro_busca = &registro;
+    joga(nivel, tam_tabuleiro, tempo_ms, nos_max, semente, aleatorias);
+    registro_busca = NULL;
+  } else {
+    joga(nivel, tam_tabuleiro, tempo_ms, nos_max, semente, aleatorias);
+  }
+  perfil_relatorio(cerr);
+
+  return 0;
+}
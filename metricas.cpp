@@ -0,0 +1,373 @@
+//// Métricas de produção /////////////////////////////////////////////////////
+
+// Veja metricas.h.
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "metricas.h"
+
+MetricasMotor *metricas_motor = NULL;
+
+static const char *NOMES_FASES[QTD_FASES] = {"opening", "midgame", "endgame"};
+
+// Limites (em us) dos baldes exportados para o Prometheus, de 100 us a
+// um minuto. Os baldes do histograma são bem mais finos; só os
+// percentis usam todos.
+static const unsigned long long LIMITES_US[] = {
+  100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000,
+  500000, 1000000, 2500000, 5000000, 10000000, 30000000, 60000000
+};
+
+static const double QUANTIS[] = {0.5, 0.9, 0.99, 0.999};
+
+//// Histograma ///////////////////////////////////////////////////////////////
+
+HistogramaLatencia::HistogramaLatencia() : _total(0), _soma(0) {
+  int b;
+
+  for (b=0; b<BALDES; b++) {
+    _contagens[b] = 0;
+  }
+}
+
+unsigned long long HistogramaLatencia::limite(int b) {
+  int desloca;
+
+  if (b < (1 << SUB_BITS)) {
+    return b + 1;
+  }
+  desloca = b / SUB - 1;
+  return (unsigned long long) (b - desloca * SUB + 1) << desloca;
+}
+
+unsigned long long HistogramaLatencia::percentil(double q) const {
+  unsigned long long n = 0, alvo;
+  int b;
+
+  // As contagens são lidas sem parar os registros; o total é refeito
+  // com elas, para que o percentil seja o de um mesmo conjunto.
+  for (b=0; b<BALDES; b++) {
+    n += _contagens[b].load(memory_order_relaxed);
+  }
+  if (n == 0) {
+    return 0;
+  }
+  alvo = max(1ULL, (unsigned long long) (q * n + 0.5));
+  for (b=0, n=0; b<BALDES; b++) {
+    n += _contagens[b].load(memory_order_relaxed);
+    if (n >= alvo) {
+      break;
+    }
+  }
+  return limite(min(b, BALDES - 1)) - 1;
+}
+
+unsigned long long HistogramaLatencia::ate(unsigned long long us) const {
+  unsigned long long n = 0;
+  int b;
+
+  for (b=0; b<BALDES && limite(b) - 1 <= us; b++) {
+    n += _contagens[b].load(memory_order_relaxed);
+  }
+  return n;
+}
+
+//// Séries ///////////////////////////////////////////////////////////////////
+
+MetricasMotor::MetricasMotor() {
+  int t, f;
+
+  for (t=0; t<=TAM_MAX_METRICAS; t++) {
+    for (f=0; f<QTD_FASES; f++) {
+      _series[t][f] = NULL;
+    }
+  }
+}
+
+MetricasMotor::~MetricasMotor() {
+  int t, f;
+
+  for (t=0; t<=TAM_MAX_METRICAS; t++) {
+    for (f=0; f<QTD_FASES; f++) {
+      delete _series[t][f].load();
+    }
+  }
+}
+
+// A série é criada na primeira jogada do tamanho e da fase; se duas
+// *threads* a criarem juntas, a que perde descarta a sua.
+SerieMetricas *MetricasMotor::serie(int tam, Fase f) {
+  atomic<SerieMetricas *> &s = _series[tam > TAM_MAX_METRICAS ? 0 : tam][f];
+  SerieMetricas *atual = s.load(memory_order_acquire), *nova;
+
+  if (atual != NULL) {
+    return atual;
+  }
+  nova = new SerieMetricas;
+  if (s.compare_exchange_strong(atual, nova, memory_order_acq_rel)) {
+    return nova;
+  }
+  delete nova;
+  return atual;
+}
+
+void MetricasMotor::registra(string **tabuleiro, double segundos,
+                             unsigned long long nos,
+                             unsigned long long consultas,
+                             unsigned long long acertos) {
+  int tam = (*tabuleiro[0]).size() - 2, vazias = 0, i;
+  SerieMetricas *s;
+
+  for (i=1; i<=tam; i++) {
+    vazias += count(tabuleiro[i]->begin() + 1, tabuleiro[i]->end() - 1,
+                    VAZIO);
+  }
+  s = serie(tam, fase(vazias, tam * tam));
+  s->latencia.registra((unsigned long long) (segundos * 1e6));
+  s->nos.fetch_add(nos, memory_order_relaxed);
+  s->consultas.fetch_add(consultas, memory_order_relaxed);
+  s->acertos.fetch_add(acertos, memory_order_relaxed);
+}
+
+// Famílias de métricas com um valor por série, na ordem de exportação
+// (o formato pede as amostras de cada família juntas).
+enum { NOS, NOS_POR_SEGUNDO, CONSULTAS, ACERTOS, TAXA_ACERTOS, QTD_FAMILIAS };
+
+static const char *FAMILIAS[QTD_FAMILIAS][3] = {
+  {"reversi_nodes_total", "counter",
+   "Nós visitados nas jogadas buscadas."},
+  {"reversi_nodes_per_second", "gauge", "Nós por segundo de busca."},
+  {"reversi_tt_probes_total", "counter",
+   "Consultas à tabela de transposição."},
+  {"reversi_tt_hits_total", "counter", "Consultas que acharam a posição."},
+  {"reversi_tt_hit_ratio", "gauge",
+   "Fração das consultas que acharam a posição."}
+};
+
+string MetricasMotor::prometheus() const {
+  ostringstream s, latencia, quantis, familias[QTD_FAMILIAS];
+  const SerieMetricas *serie;
+  unsigned long long n, nos, consultas, acertos;
+  double segundos, valores[QTD_FAMILIAS];
+  string rotulos;
+  size_t k;
+  int t, f, i;
+
+  latencia << setprecision(9);
+  quantis << setprecision(9);
+  for (i=0; i<QTD_FAMILIAS; i++) {
+    familias[i] << setprecision(9) << "# HELP " << FAMILIAS[i][0] << " "
+                << FAMILIAS[i][2] << "\n# TYPE " << FAMILIAS[i][0] << " "
+                << FAMILIAS[i][1] << "\n";
+  }
+  latencia << "# HELP reversi_move_latency_seconds Duração de cada jogada "
+           << "buscada.\n# TYPE reversi_move_latency_seconds histogram\n";
+  quantis << "# HELP reversi_move_latency_quantile_seconds Percentis da "
+          << "duração das jogadas (erro de até 3%).\n"
+          << "# TYPE reversi_move_latency_quantile_seconds gauge\n";
+  for (t=1; t<=TAM_MAX_METRICAS + 1; t++) {
+    for (f=0; f<QTD_FASES; f++) {
+      serie = _series[t % (TAM_MAX_METRICAS + 1)][f].load();
+      if (serie == NULL) {
+        continue;
+      }
+      ostringstream r;
+      r << "size=\"";
+      if (t > TAM_MAX_METRICAS) {
+        r << "other";
+      } else {
+        r << t;
+      }
+      r << "\",phase=\"" << NOMES_FASES[f] << "\"";
+      rotulos = r.str();
+
+      const HistogramaLatencia &h = serie->latencia;
+      n = h.total();
+      segundos = h.soma() / 1e6;
+      for (k=0; k<sizeof(LIMITES_US)/sizeof(LIMITES_US[0]); k++) {
+        latencia << "reversi_move_latency_seconds_bucket{" << rotulos
+                 << ",le=\"" << LIMITES_US[k] / 1e6 << "\"} "
+                 << h.ate(LIMITES_US[k]) << "\n";
+      }
+      latencia << "reversi_move_latency_seconds_bucket{" << rotulos
+               << ",le=\"+Inf\"} " << n << "\n"
+               << "reversi_move_latency_seconds_sum{" << rotulos << "} "
+               << segundos << "\n"
+               << "reversi_move_latency_seconds_count{" << rotulos << "} "
+               << n << "\n";
+      for (k=0; k<sizeof(QUANTIS)/sizeof(QUANTIS[0]); k++) {
+        quantis << "reversi_move_latency_quantile_seconds{" << rotulos
+                << ",quantile=\"" << QUANTIS[k] << "\"} "
+                << h.percentil(QUANTIS[k]) / 1e6 << "\n";
+      }
+      quantis << "reversi_move_latency_quantile_seconds{" << rotulos
+              << ",quantile=\"1\"} " << h.percentil(1) / 1e6 << "\n";
+
+      nos = serie->nos.load();
+      consultas = serie->consultas.load();
+      acertos = serie->acertos.load();
+      valores[NOS] = nos;
+      valores[NOS_POR_SEGUNDO] = segundos > 0 ? nos / segundos : 0;
+      valores[CONSULTAS] = consultas;
+      valores[ACERTOS] = acertos;
+      valores[TAXA_ACERTOS] =
+        consultas > 0 ? (double) acertos / consultas : 0;
+      for (i=0; i<QTD_FAMILIAS; i++) {
+        familias[i] << FAMILIAS[i][0] << "{" << rotulos << "} "
+                    << valores[i] << "\n";
+      }
+    }
+  }
+  s << latencia.str() << quantis.str();
+  for (i=0; i<QTD_FAMILIAS; i++) {
+    s << familias[i].str();
+  }
+  return s.str();
+}
+
+//// Exportação ///////////////////////////////////////////////////////////////
+
+ExportadorMetricas::ExportadorMetricas(const MetricasMotor &metricas,
+                                       const string &destino,
+                                       double intervalo)
+  : _metricas(metricas), _destino(destino), _intervalo(intervalo),
+    _socket(-1), _parar(false)
+{
+}
+
+ExportadorMetricas::~ExportadorMetricas() {
+  para();
+}
+
+bool ExportadorMetricas::inicia(string *erro) {
+  struct sockaddr_un endereco;
+  string caminho;
+
+  if (_destino.compare(0, 5, "unix:") != 0) {
+    escreve_arquivo();
+    _thread = thread(&ExportadorMetricas::laco_arquivo, this);
+    return true;
+  }
+
+  caminho = _destino.substr(5);
+  memset(&endereco, 0, sizeof(endereco));
+  endereco.sun_family = AF_UNIX;
+  if (caminho.size() >= sizeof(endereco.sun_path)) {
+    *erro = "Caminho muito longo para o socket: " + caminho;
+    return false;
+  }
+  strcpy(endereco.sun_path, caminho.c_str());
+  _socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (_socket < 0) {
+    *erro = string("socket: ") + strerror(errno);
+    return false;
+  }
+  unlink(caminho.c_str());
+  if (bind(_socket, (struct sockaddr *) &endereco, sizeof(endereco)) < 0 ||
+      listen(_socket, 16) < 0) {
+    *erro = caminho + ": " + strerror(errno);
+    close(_socket);
+    _socket = -1;
+    return false;
+  }
+  _thread = thread(&ExportadorMetricas::atende_socket, this);
+  return true;
+}
+
+void ExportadorMetricas::para() {
+  if (!_thread.joinable()) {
+    return;
+  }
+  {
+    lock_guard<mutex> trava(_mutex);
+    _parar = true;
+  }
+  _cv.notify_all();
+  // O *shutdown* acorda o *accept* bloqueado.
+  if (_socket >= 0) {
+    shutdown(_socket, SHUT_RDWR);
+  }
+  _thread.join();
+  if (_socket >= 0) {
+    close(_socket);
+    unlink(_destino.substr(5).c_str());
+  } else {
+    escreve_arquivo();
+  }
+}
+
+// Escreve em um temporário e renomeia, para que o leitor nunca veja um
+// arquivo pela metade.
+void ExportadorMetricas::escreve_arquivo() {
+  string temporario = _destino + ".tmp";
+  ofstream saida(temporario.c_str());
+
+  saida << _metricas.prometheus();
+  saida.close();
+  if (saida.fail() || rename(temporario.c_str(), _destino.c_str()) != 0) {
+    unlink(temporario.c_str());
+  }
+}
+
+void ExportadorMetricas::laco_arquivo() {
+  unique_lock<mutex> trava(_mutex);
+
+  while (!_parar) {
+    _cv.wait_for(trava, chrono::duration<double>(_intervalo));
+    if (!_parar) {
+      trava.unlock();
+      escreve_arquivo();
+      trava.lock();
+    }
+  }
+}
+
+// Cada conexão recebe as métricas do momento e é fechada. Se o cliente
+// mandar um pedido HTTP, lemos só o começo dele (o resto é ignorado).
+void ExportadorMetricas::atende_socket() {
+  string texto, resposta;
+  char pedido[256];
+  ssize_t n, escrito;
+  size_t k;
+  int cliente;
+  struct timeval espera = {1, 0};
+
+  while (true) {
+    cliente = accept(_socket, NULL, NULL);
+    if (cliente < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    setsockopt(cliente, SOL_SOCKET, SO_RCVTIMEO, &espera, sizeof(espera));
+    n = recv(cliente, pedido, sizeof(pedido), MSG_PEEK);
+    texto = _metricas.prometheus();
+    if (n >= 3 && memcmp(pedido, "GET", 3) == 0) {
+      ostringstream s;
+      n = recv(cliente, pedido, sizeof(pedido), 0);
+      s << "HTTP/1.0 200 OK\r\n"
+        << "Content-Type: text/plain; version=0.0.4\r\n"
+        << "Content-Length: " << texto.size() << "\r\n\r\n" << texto;
+      resposta = s.str();
+    } else {
+      resposta = texto;
+    }
+    for (k=0; k<resposta.size(); k+=escrito) {
+      escrito = send(cliente, resposta.data() + k, resposta.size() - k,
+                     MSG_NOSIGNAL);
+      if (escrito <= 0) {
+        break;
+      }
+    }
+    close(cliente);
+  }
+}
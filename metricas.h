@@ -0,0 +1,183 @@
+#ifndef _METRICAS_H_
+#define _METRICAS_H_
+
+//// Métricas de produção /////////////////////////////////////////////////////
+
+// Em produção, o que importa é a cauda da latência de cada jogada do
+// motor, não a média. Com as métricas ligadas (*metricas_motor*), cada
+// jogada buscada (*planeja()*, *aprofunda()* e *busca_jogada()*) tem a
+// sua duração registrada em um histograma por tamanho de tabuleiro e
+// por fase da partida, junto com os nós visitados e as consultas à
+// tabela de transposição.
+//
+// Os histogramas são log-lineares, como os do HdrHistogram: cada
+// potência de 2 de microssegundos é dividida em 32 baldes iguais, o
+// que dá no máximo ~3% de erro em qualquer percentil, de 1 us a dias,
+// com memória fixa. Registrar uma jogada custa duas leituras do
+// relógio, uma contagem das casas vazias e alguns incrementos atômicos
+// (sem trava: várias *threads* podem registrar ao mesmo tempo), o que
+// some perto da busca (veja o caso "metricas:registra" do benchmark).
+//
+// A fase vem da fração de casas vazias: abertura acima de 70%, final
+// até 30% e meio-jogo entre as duas (no 8x8, abertura até a 15a jogada
+// e final nas últimas 19 casas).
+//
+// As métricas são exportadas no formato de texto do Prometheus (veja
+// *ExportadorMetricas*), com os nomes e rótulos em inglês, como o
+// protocolo do servidor:
+//
+//     reversi_move_latency_seconds_bucket{size="8",phase="midgame",le="0.01"} 123
+//     reversi_move_latency_quantile_seconds{size="8",phase="midgame",quantile="0.99"} 0.0421
+//     reversi_nodes_per_second{size="8",phase="midgame"} 812345
+//     reversi_tt_hit_ratio{size="8",phase="midgame"} 0.35
+//
+// além dos contadores (*_total*) de jogadas, nós, segundos de busca e
+// consultas e acertos na tabela, para que o Prometheus calcule as
+// taxas por intervalo.
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "reversi.h"
+
+enum Fase { FASE_ABERTURA, FASE_MEIO, FASE_FINAL, QTD_FASES };
+
+// Fase de uma posição com *vazias* casas vazias de *casas*.
+inline Fase fase(int vazias, int casas) {
+  if (vazias * 10 > casas * 7) {
+    return FASE_ABERTURA;
+  }
+  return vazias * 10 > casas * 3 ? FASE_MEIO : FASE_FINAL;
+}
+
+// Histograma log-linear de durações em microssegundos.
+class HistogramaLatencia {
+
+public:
+
+  static const int SUB_BITS = 6;                   // 2^6 = 64 valores exatos
+  static const int SUB = 1 << (SUB_BITS - 1);      // baldes por potência de 2
+  static const int BALDES = (40 - SUB_BITS + 2) * SUB;  // até 2^40 us
+
+  HistogramaLatencia();
+
+  void registra(unsigned long long us) {
+    _contagens[balde(us)].fetch_add(1, memory_order_relaxed);
+    _total.fetch_add(1, memory_order_relaxed);
+    _soma.fetch_add(us, memory_order_relaxed);
+  }
+
+  unsigned long long total() const { return _total.load(); }
+  unsigned long long soma() const { return _soma.load(); }
+
+  // Maior duração do balde em que cai a fração *q* das medidas (0 sem
+  // medidas).
+  unsigned long long percentil(double q) const;
+
+  // Medidas com duração até *us*, contando os baldes inteiros cujo
+  // limite superior não passa de *us*.
+  unsigned long long ate(unsigned long long us) const;
+
+  // Índice do balde de *us* e o seu limite superior (exclusivo).
+  static int balde(unsigned long long us) {
+    int e, desloca;
+
+    if (us < (1ULL << SUB_BITS)) {
+      return us;
+    }
+    if (us >= (1ULL << 40)) {
+      return BALDES - 1;
+    }
+    e = 63 - __builtin_clzll(us);
+    desloca = e - SUB_BITS + 1;
+    return desloca * SUB + (us >> desloca);
+  }
+  static unsigned long long limite(int b);
+
+private:
+
+  atomic<unsigned long long> _contagens[BALDES];
+  atomic<unsigned long long> _total, _soma;
+
+};
+
+// Tudo o que é registrado para um tamanho e uma fase.
+struct SerieMetricas {
+  HistogramaLatencia latencia;
+  atomic<unsigned long long> nos, consultas, acertos;
+
+  SerieMetricas() : nos(0), consultas(0), acertos(0) {}
+};
+
+// Maior tamanho com séries próprias; os maiores dividem a série de
+// tamanho 0 (rótulo "other").
+const int TAM_MAX_METRICAS = 1024;
+
+class MetricasMotor {
+
+  atomic<SerieMetricas *> _series[TAM_MAX_METRICAS + 1][QTD_FASES];
+
+public:
+
+  MetricasMotor();
+  ~MetricasMotor();
+
+  MetricasMotor(const MetricasMotor &) = delete;
+  MetricasMotor &operator=(const MetricasMotor &) = delete;
+
+  // Registra uma jogada buscada no *tabuleiro*.
+  void registra(string **tabuleiro, double segundos, unsigned long long nos,
+                unsigned long long consultas, unsigned long long acertos);
+
+  // Todas as séries no formato de texto do Prometheus.
+  string prometheus() const;
+
+private:
+
+  SerieMetricas *serie(int tam, Fase f);
+
+};
+
+// Métricas do processo (NULL: desligadas). Definidas antes de começar
+// qualquer busca.
+extern MetricasMotor *metricas_motor;
+
+// Exporta as métricas periodicamente para um arquivo (reescrito a cada
+// *intervalo* segundos, por meio de um temporário renomeado, como o
+// *textfile collector* do *node_exporter* espera) ou, com o destino
+// "unix:caminho", responde em um *socket* Unix a cada conexão, com um
+// cabeçalho HTTP se o pedido começar por "GET" (para o *curl
+// --unix-socket* ou um *proxy*). Ao parar, o arquivo é escrito uma
+// última vez.
+class ExportadorMetricas {
+
+  const MetricasMotor &_metricas;
+  string _destino;
+  double _intervalo;
+  int _socket;
+  bool _parar;
+  mutex _mutex;
+  condition_variable _cv;
+  thread _thread;
+
+  void escreve_arquivo();
+  void laco_arquivo();
+  void atende_socket();
+
+public:
+
+  ExportadorMetricas(const MetricasMotor &metricas, const string &destino,
+                     double intervalo);
+  ~ExportadorMetricas();
+
+  // Começa a exportar; retorna *false* (com a mensagem em *erro*) se o
+  // destino não puder ser usado.
+  bool inicia(string *erro);
+  void para();
+
+};
+
+#endif /* _METRICAS_H_ */
@@ -0,0 +1,172 @@
+//// Leitura de coleções de partidas //////////////////////////////////////////
+
+// Veja partidas.h.
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "partidas.h"
+#include "fragmentos.h"
+
+using namespace std;
+
+Textos::~Textos() {
+  size_t i;
+
+  for (i=0; i<_mapas.size(); i++) {
+    munmap(_mapas[i].first, _mapas[i].second);
+  }
+}
+
+bool Textos::mapeia(const string &caminho, size_t limite,
+                    const char **inicio, size_t *tamanho) {
+  struct stat st;
+  void *mapa;
+  int fd;
+
+  fd = open(caminho.c_str(), O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) < 0) {
+    if (fd >= 0) {
+      close(fd);
+    }
+    return false;
+  }
+  *inicio = "";
+  *tamanho = min((size_t) st.st_size, limite);
+  if (*tamanho > 0) {
+    mapa = mmap(NULL, *tamanho, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapa == MAP_FAILED) {
+      close(fd);
+      return false;
+    }
+    // As partidas são percorridas do começo ao fim.
+    madvise(mapa, *tamanho, MADV_SEQUENTIAL);
+    _mapas.push_back(make_pair(mapa, *tamanho));
+    *inicio = static_cast<const char *>(mapa);
+  }
+  close(fd);
+  return true;
+}
+
+// Fim da parte de jogo.txt coberta por jogo.idx: o que vier depois é
+// uma partida pela metade (veja fragmentos.h).
+static size_t fim_indexado(const string &idx) {
+  ifstream entrada(idx.c_str(), ios::binary);
+  EntradaIndice e;
+  size_t fim = 0;
+
+  while (entrada.read(reinterpret_cast<char *>(&e), sizeof(e))) {
+    if (e.inicio + e.tamanho > fim) {
+      fim = e.inicio + e.tamanho;
+    }
+  }
+  return fim;
+}
+
+// Divide o texto em partidas: cada linha 'game' começa uma nova; as
+// jogadas antes de qualquer cabeçalho formam uma partida sem número.
+static void divide(const char *texto, size_t tamanho, int tam_padrao,
+                   vector<Partida> *com_numero, vector<Partida> *sem_numero) {
+  const char *p = texto, *fim = p + tamanho, *linha;
+  Partida atual = { 0, tam_padrao, p, p };
+  bool tem_cabecalho = false, tem_jogadas = false;
+
+  while (p < fim) {
+    linha = p;
+    while (p < fim && *p != '\n') {
+      p++;
+    }
+    if (p < fim) {
+      p++;
+    }
+    if (p - linha >= 5 && strncmp(linha, "game ", 5) == 0) {
+      if (tem_cabecalho || tem_jogadas) {
+        (tem_cabecalho ? com_numero : sem_numero)->push_back(atual);
+      }
+      // O texto mapeado não termina em '\0': lemos uma cópia da linha.
+      string cabecalho(linha, p);
+      unsigned long long jogo = 0;
+      if (sscanf(cabecalho.c_str(), "game %llu size %d", &jogo,
+                 &atual.tam) != 2) {
+        atual.tam = tam_padrao;
+      }
+      atual.jogo = jogo;
+      atual.inicio = p;
+      tem_cabecalho = true;
+      tem_jogadas = false;
+    } else if (linha < p && (*linha == 'b' || *linha == 'w')) {
+      tem_jogadas = true;
+    }
+    atual.fim = p;
+  }
+  if (tem_cabecalho || tem_jogadas) {
+    (tem_cabecalho ? com_numero : sem_numero)->push_back(atual);
+  }
+}
+
+bool le_partidas(const vector<string> &entradas, int tam_padrao,
+                 Textos *textos, vector<Partida> *partidas, string *erro) {
+  vector<Partida> sem_numero;
+  uint64_t maior = 0;
+  size_t i;
+
+  for (i=0; i<entradas.size(); i++) {
+    const char *texto;
+    size_t tamanho;
+    DIR *dir = opendir(entradas[i].c_str());
+    if (dir != NULL) {
+      struct dirent *d;
+      while ((d = readdir(dir)) != NULL) {
+        string nome = d->d_name;
+        if (nome.compare(0, 6, "jogos-") == 0 && nome.size() > 10 &&
+            nome.compare(nome.size() - 4, 4, ".idx") == 0) {
+          string base = entradas[i] + "/" + nome.substr(0, nome.size() - 4);
+          if (!textos->mapeia(base + ".txt", fim_indexado(base + ".idx"),
+                              &texto, &tamanho)) {
+            *erro = base + ".txt: " + strerror(errno);
+            closedir(dir);
+            return false;
+          }
+          divide(texto, tamanho, tam_padrao, partidas, &sem_numero);
+        }
+      }
+      closedir(dir);
+    } else {
+      if (!textos->mapeia(entradas[i], (size_t) -1, &texto, &tamanho)) {
+        *erro = entradas[i] + ": " + strerror(errno);
+        return false;
+      }
+      divide(texto, tamanho, tam_padrao, partidas, &sem_numero);
+    }
+  }
+  for (i=0; i<partidas->size(); i++) {
+    maior = max(maior, (*partidas)[i].jogo + 1);
+  }
+  for (i=0; i<sem_numero.size(); i++) {
+    sem_numero[i].jogo = maior + i;
+    partidas->push_back(sem_numero[i]);
+  }
+  return true;
+}
+
+vector<JogadaArquivo> jogadas(const Partida &partida) {
+  vector<JogadaArquivo> v;
+  istringstream entrada(string(partida.inicio, partida.fim));
+  string cor;
+  JogadaArquivo j;
+
+  while (entrada >> cor >> j.linha >> j.coluna) {
+    j.preta = cor == "black";
+    v.push_back(j);
+  }
+  return v;
+}
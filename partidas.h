@@ -0,0 +1,65 @@
+#ifndef _PARTIDAS_H_
+#define _PARTIDAS_H_
+
+//// Leitura de coleções de partidas //////////////////////////////////////////
+
+// Ferramentas que trabalham sobre muitas partidas gravadas (o *indexa*
+// e o *calibra*) as leem daqui: diretórios do *gera* (só as partidas já
+// indexadas de cada fragmento, veja fragmentos.h) ou arquivos de
+// jogadas avulsos (o game.txt do motor ou um .txt de fragmento).
+//
+// As partidas dos fragmentos trazem número e tamanho no cabeçalho; as
+// de arquivos sem cabeçalho são numeradas depois de todas as outras,
+// na ordem das entradas, e têm o tamanho padrão.
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Uma partida: o trecho de texto com as suas jogadas.
+struct Partida {
+  uint64_t jogo;
+  int tam;
+  const char *inicio, *fim;
+};
+
+// Uma jogada como no arquivo de jogadas: linha 0 embaixo, coluna 0 à
+// esquerda (no motor, é a casa (tam - linha, coluna + 1)).
+struct JogadaArquivo {
+  bool preta;
+  int linha, coluna;
+};
+
+// Textos das entradas, mapeados na memória (só para leitura): o sistema
+// lê do disco as páginas conforme as partidas são percorridas e pode
+// descartá-las depois, então a coleção não precisa caber na memória.
+class Textos {
+
+  std::vector<std::pair<void *, size_t> > _mapas;
+
+public:
+
+  Textos() {}
+  ~Textos();
+
+  Textos(const Textos &) = delete;
+  Textos &operator=(const Textos &) = delete;
+
+  // Mapeia os primeiros *limite* bytes do arquivo (ou menos, se ele for
+  // menor), devolvendo o início e o tamanho do texto.
+  bool mapeia(const std::string &caminho, size_t limite,
+              const char **inicio, size_t *tamanho);
+
+};
+
+// Lê as partidas das entradas. Os textos ficam mapeados em *textos*, e
+// as partidas apontam para eles. Retorna *false* (com a mensagem em
+// *erro*) se alguma entrada não puder ser lida.
+bool le_partidas(const std::vector<std::string> &entradas, int tam_padrao,
+                 Textos *textos, std::vector<Partida> *partidas,
+                 std::string *erro);
+
+// Jogadas de uma partida.
+std::vector<JogadaArquivo> jogadas(const Partida &partida);
+
+#endif /* _PARTIDAS_H_ */
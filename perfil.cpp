@@ -0,0 +1,203 @@
+//// Perfil da busca //////////////////////////////////////////////////////////
+
+// Veja perfil.h.
+
+#include "perfil.h"
+
+#ifdef PERFIL
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+using namespace std;
+
+typedef chrono::steady_clock RelogioPerfil;
+
+static const char *NOMES_FASES_PERFIL[QTD_FASES_PERFIL] = {
+  "jogada", "busca", "geracao", "execucao", "avaliacao", "tabela",
+  "simetria", "estabilidade", "saida"
+};
+
+thread_local PerfilThread *perfil_thread = NULL;
+
+// As *threads* que já mediram algo. Os totais ficam aqui mesmo depois
+// que a *thread* termina (as do lote, por exemplo), até o relatório.
+static mutex mutex_perfil;
+static vector<unique_ptr<PerfilThread> > threads_perfil;
+
+// Calibração dos tiques: o instante em que o primeiro escopo foi aberto,
+// nos dois relógios.
+static unsigned long long tique_inicial;
+static RelogioPerfil::time_point instante_inicial;
+
+// Traço pedido: o arquivo e a jogada (contando as jogadas buscadas por
+// todas as *threads*).
+static string arquivo_traco;
+static int jogada_traco = 0;
+static atomic<int> jogadas_perfil(0);
+
+// Instante do início da jogada traçada, para calibrar os tiques dela.
+static unsigned long long tique_traco;
+static RelogioPerfil::time_point instante_traco;
+
+bool perfil_compilado() {
+  return true;
+}
+
+PerfilThread *registra_thread_perfil() {
+  lock_guard<mutex> trava(mutex_perfil);
+  PerfilThread *p = new PerfilThread();
+
+  if (threads_perfil.empty()) {
+    tique_inicial = tique_perfil();
+    instante_inicial = RelogioPerfil::now();
+  }
+  p->id = threads_perfil.size();
+  p->atual = NULL;
+  p->tracando = false;
+  p->descartados = 0;
+  threads_perfil.push_back(unique_ptr<PerfilThread>(p));
+  perfil_thread = p;
+  return p;
+}
+
+void perfil_traca(const string &arquivo, int jogada) {
+  lock_guard<mutex> trava(mutex_perfil);
+
+  arquivo_traco = arquivo;
+  jogada_traco = jogada;
+}
+
+void abre_jogada_perfil(PerfilThread *p) {
+  if (jogadas_perfil.fetch_add(1) + 1 != jogada_traco) {
+    return;
+  }
+  p->eventos.clear();
+  p->eventos.reserve(MAX_EVENTOS_PERFIL / 16);
+  p->descartados = 0;
+  p->tracando = true;
+  tique_traco = tique_perfil();
+  instante_traco = RelogioPerfil::now();
+}
+
+// Os eventos vão no formato "X" (duração completa), com tempos em us
+// desde o início da jogada. Os escopos de uma *thread* são aninhados,
+// então o visualizador monta a árvore pela própria ordem dos tempos.
+void fecha_jogada_perfil(PerfilThread *p) {
+  double ns_por_tique =
+    chrono::duration<double, nano>(RelogioPerfil::now() -
+                                   instante_traco).count() /
+    max(1ULL, tique_perfil() - tique_traco);
+  ofstream saida(arquivo_traco.c_str());
+  size_t i;
+
+  p->tracando = false;
+  saida << fixed << setprecision(3) << "{\"traceEvents\":[\n";
+  for (i=0; i<p->eventos.size(); i++) {
+    const EventoPerfil &e = p->eventos[i];
+    saida << (i > 0 ? ",\n" : "") << "{\"name\":\""
+          << NOMES_FASES_PERFIL[e.fase] << "\",\"cat\":\"reversi\","
+          << "\"ph\":\"X\",\"pid\":1,\"tid\":" << p->id << ",\"ts\":"
+          << (e.inicio - tique_traco) * ns_por_tique / 1000 << ",\"dur\":"
+          << e.duracao * ns_por_tique / 1000 << "}";
+  }
+  saida << "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"jogada\":"
+        << jogada_traco << ",\"descartados\":" << p->descartados << "}}\n";
+  if (!saida) {
+    cerr << "Não foi possível gravar o traço: " << arquivo_traco << endl;
+  }
+  p->eventos.clear();
+  p->eventos.shrink_to_fit();
+}
+
+// Uma linha do relatório: chamadas, inclusivo e exclusivo em ms e a
+// porcentagem de cada um sobre o total medido.
+static void linha_perfil(ostream &saida, const char *nome,
+                         unsigned long long chamadas, double inclusivo,
+                         double exclusivo, double total) {
+  saida << setw(14) << left << nome << right << setw(12) << chamadas
+        << setw(13) << inclusivo << setw(9) << (total > 0 ?
+                                                100 * inclusivo / total : 0)
+        << setw(13) << exclusivo << setw(9) << (total > 0 ?
+                                                100 * exclusivo / total : 0)
+        << setw(14) << (chamadas > 0 ? exclusivo * 1e6 / chamadas : 0)
+        << "\n";
+}
+
+static void perfil_plano(ostream &saida, const string &titulo,
+                         const unsigned long long chamadas[],
+                         const unsigned long long inclusivo[],
+                         const unsigned long long exclusivo[],
+                         double ms_por_tique) {
+  double total = 0;
+  int f;
+
+  for (f=0; f<QTD_FASES_PERFIL; f++) {
+    total += exclusivo[f] * ms_por_tique;
+  }
+  saida << titulo << " (" << total << " ms medidos)\n"
+        << "fase              chamadas  inclus.(ms)        %  exclus.(ms)"
+        << "        %    ns/chamada\n";
+  for (f=0; f<QTD_FASES_PERFIL; f++) {
+    if (chamadas[f] > 0) {
+      linha_perfil(saida, NOMES_FASES_PERFIL[f], chamadas[f],
+                   inclusivo[f] * ms_por_tique, exclusivo[f] * ms_por_tique,
+                   total);
+    }
+  }
+}
+
+void perfil_relatorio(ostream &saida) {
+  lock_guard<mutex> trava(mutex_perfil);
+  unsigned long long chamadas[QTD_FASES_PERFIL] = {0};
+  unsigned long long inclusivo[QTD_FASES_PERFIL] = {0};
+  unsigned long long exclusivo[QTD_FASES_PERFIL] = {0};
+  double ms_por_tique;
+  size_t t;
+  int f;
+
+  if (threads_perfil.empty()) {
+    return;
+  }
+  ms_por_tique =
+    chrono::duration<double, milli>(RelogioPerfil::now() -
+                                    instante_inicial).count() /
+    max(1ULL, tique_perfil() - tique_inicial);
+  saida << fixed << setprecision(3);
+  for (t=0; t<threads_perfil.size(); t++) {
+    const PerfilThread &p = *threads_perfil[t];
+    ostringstream titulo;
+
+    titulo << "perfil da thread " << p.id;
+    perfil_plano(saida, titulo.str(), p.chamadas, p.inclusivo, p.exclusivo,
+                 ms_por_tique);
+    for (f=0; f<QTD_FASES_PERFIL; f++) {
+      chamadas[f] += p.chamadas[f];
+      inclusivo[f] += p.inclusivo[f];
+      exclusivo[f] += p.exclusivo[f];
+    }
+  }
+  if (threads_perfil.size() > 1) {
+    perfil_plano(saida, "perfil de todas as threads", chamadas, inclusivo,
+                 exclusivo, ms_por_tique);
+  }
+}
+
+#else
+
+bool perfil_compilado() {
+  return false;
+}
+
+void perfil_relatorio(std::ostream &) {
+}
+
+void perfil_traca(const std::string &, int) {
+}
+
+#endif /* PERFIL */
@@ -0,0 +1,160 @@
+#ifndef _PERFIL_H_
+#define _PERFIL_H_
+
+//// Perfil da busca //////////////////////////////////////////////////////////
+
+// Quando uma partida fica lenta, o perfil mostra para onde foi o tempo:
+// geração de jogadas (*pos_jogaveis()*, *tem_jogada()*), execução e
+// desfazimento (*executa()*, *inverte()*, *desfaz()*), avaliação
+// (*pontos()*), tabela de transposição, chaves canônicas, peças
+// estáveis, o resto do próprio *minimax()* ("busca") e a saída
+// (*mostra()*). Cada trecho medido abre um escopo (*PERFIL_ESCOPO*) que
+// lê o contador de ciclos (rdtsc; fora do x86, o *steady_clock*) na
+// entrada e na saída.
+//
+// Por *thread* e por fase, somamos o tempo exclusivo (descontados os
+// escopos abertos dentro dele, de qualquer fase) e o inclusivo (com
+// eles; na recursão, só o escopo mais externo da fase conta, para o
+// tempo não ser somado duas vezes). Cada jogada buscada (*planeja()*,
+// *aprofunda()*, *busca_jogada()*) é um escopo "jogada", de forma que o
+// exclusivo de todas as fases soma o tempo das jogadas mais o da saída.
+// *perfil_relatorio()* mostra esse perfil plano ao fim da partida.
+//
+// Para ver uma só jogada em detalhe, *perfil_traca()* grava todos os
+// escopos da jogada escolhida (a *n*-ésima buscada pelo processo) em um
+// arquivo JSON de eventos no formato do Chrome (*chrome://tracing*,
+// Perfetto), com um evento por nó da busca.
+//
+// Medir custa dezenas de ns por escopo e infla bastante as fases
+// baratas; por isso o perfil só existe quando compilado com -DPERFIL
+// ('make PERFIL=1'). Sem ele, os escopos não geram código nenhum.
+
+#include <iostream>
+#include <string>
+
+enum FasePerfil {
+  PERFIL_JOGADA, PERFIL_BUSCA, PERFIL_GERACAO, PERFIL_EXECUCAO,
+  PERFIL_AVALIACAO, PERFIL_TABELA, PERFIL_SIMETRIA, PERFIL_ESTABILIDADE,
+  PERFIL_SAIDA, QTD_FASES_PERFIL
+};
+
+// Se o programa foi compilado com o perfil.
+bool perfil_compilado();
+
+// Mostra o perfil plano de cada *thread* que abriu algum escopo (e o
+// total, se houver mais de uma).
+void perfil_relatorio(std::ostream &saida);
+
+// Grava os eventos da *jogada*-ésima jogada buscada em *arquivo*.
+void perfil_traca(const std::string &arquivo, int jogada);
+
+#ifdef PERFIL
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+inline unsigned long long tique_perfil() { return __rdtsc(); }
+#else
+#include <chrono>
+inline unsigned long long tique_perfil() {
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+#endif
+
+#include <vector>
+
+// Eventos guardados de uma jogada traçada, no máximo (os demais são
+// descartados e contados).
+const size_t MAX_EVENTOS_PERFIL = 1 << 21;
+
+// Um escopo fechado, guardado enquanto uma jogada é traçada.
+struct EventoPerfil {
+  FasePerfil fase;
+  unsigned long long inicio, duracao;
+};
+
+class EscopoPerfil;
+
+// Totais de uma *thread*, em tiques.
+struct PerfilThread {
+  int id;
+  unsigned long long inclusivo[QTD_FASES_PERFIL];
+  unsigned long long exclusivo[QTD_FASES_PERFIL];
+  unsigned long long chamadas[QTD_FASES_PERFIL];
+  int abertos[QTD_FASES_PERFIL];  // escopos abertos por fase (recursão)
+  EscopoPerfil *atual;            // escopo mais interno aberto
+  bool tracando;
+  std::vector<EventoPerfil> eventos;
+  unsigned long long descartados;
+};
+
+extern thread_local PerfilThread *perfil_thread;
+
+// Caminhos lentos, fora de linha: a primeira medida da *thread* e o
+// início e o fim de uma jogada (que podem ligar e desligar o traço).
+PerfilThread *registra_thread_perfil();
+void abre_jogada_perfil(PerfilThread *p);
+void fecha_jogada_perfil(PerfilThread *p);
+
+class EscopoPerfil {
+
+  FasePerfil _fase;
+  EscopoPerfil *_pai;
+  PerfilThread *_perfil;
+  unsigned long long _inicio;
+
+public:
+
+  unsigned long long filhos;  // tiques dos escopos abertos dentro deste
+
+  explicit EscopoPerfil(FasePerfil fase) : _fase(fase), filhos(0) {
+    _perfil = perfil_thread != NULL ? perfil_thread :
+      registra_thread_perfil();
+    if (fase == PERFIL_JOGADA && _perfil->abertos[fase] == 0) {
+      abre_jogada_perfil(_perfil);
+    }
+    _pai = _perfil->atual;
+    _perfil->atual = this;
+    _perfil->abertos[fase]++;
+    _inicio = tique_perfil();
+  }
+
+  ~EscopoPerfil() {
+    unsigned long long total = tique_perfil() - _inicio;
+    PerfilThread *p = _perfil;
+
+    p->exclusivo[_fase] += total - filhos;
+    p->chamadas[_fase]++;
+    if (--p->abertos[_fase] == 0) {
+      p->inclusivo[_fase] += total;
+    }
+    if (_pai != NULL) {
+      _pai->filhos += total;
+    }
+    p->atual = _pai;
+    if (p->tracando) {
+      EventoPerfil e = {_fase, _inicio, total};
+      if (p->eventos.size() < MAX_EVENTOS_PERFIL) {
+        p->eventos.push_back(e);
+      } else {
+        p->descartados++;
+      }
+      if (_fase == PERFIL_JOGADA && p->abertos[_fase] == 0) {
+        fecha_jogada_perfil(p);
+      }
+    }
+  }
+
+  EscopoPerfil(const EscopoPerfil &) = delete;
+  EscopoPerfil &operator=(const EscopoPerfil &) = delete;
+
+};
+
+#define PERFIL_ESCOPO(fase) EscopoPerfil _escopo_perfil(fase)
+
+#else
+
+#define PERFIL_ESCOPO(fase)
+
+#endif /* PERFIL */
+
+#endif /* _PERFIL_H_ */
@@ -0,0 +1,379 @@
+//// Perft: contagem de folhas da árvore de jogadas //////////////////////////
+
+// O *perft* conta as folhas da árvore de jogadas até a profundidade N
+// a partir de uma posição qualquer. Ele serve a dois propósitos:
+//
+// * medir a vazão bruta da geração de jogadas (folhas/segundo), sem
+//   a avaliação nem o *minimax* no meio;
+// * conferir se geradores diferentes (e futuros geradores otimizados)
+//   concordam com a referência.
+//
+// Regras da contagem: passar a vez conta como uma jogada (um nível da
+// árvore) e uma posição de fim de jogo é uma folha, qualquer que seja
+// a profundidade restante. No último nível apenas contamos as jogadas
+// (*bulk counting*), sem executá-las. Opcionalmente, as contagens dos
+// níveis intermediários são guardadas em uma tabela *hash*.
+//
+// Uso:
+//
+//     $ ./perft [-r motor|board|todos] [-d prof] [-t tam] [-p posicao]
+//               [-h MB] [-D]
+//
+// * -r: representação do tabuleiro (padrão: todos, conferindo uma com
+//   a outra);
+// * -d: profundidade máxima (padrão 6), contando de 1 até ela;
+// * -t: tamanho do tabuleiro inicial (padrão 8);
+// * -p: posição inicial no formato de *le_posicao()*;
+// * -h: tamanho da tabela *hash*, em MB (padrão 0, sem tabela);
+// * -D: mostra as contagens por jogada da raiz (*divide*).
+//
+// Para acrescentar uma nova representação, basta escrever uma classe
+// com os mesmos métodos de *PerftMotor* e chamá-la em *main()*.
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <unistd.h>
+
+#include "reversi.h"
+#include "board.h"
+
+typedef unsigned long long Contagem;
+
+//// Tabela hash //////////////////////////////////////////////////////////////
+
+// Cada entrada guarda a contagem de uma posição (chave inclui o
+// jogador da vez) a uma determinada profundidade. Substituímos sempre.
+struct EntradaPerft {
+  unsigned long long chave;
+  int prof;
+  Contagem folhas;
+};
+
+class TabelaPerft {
+  vector<EntradaPerft> _entradas;
+
+public:
+
+  TabelaPerft(int megabytes)
+    : _entradas((size_t) megabytes * 1024 * 1024 / sizeof(EntradaPerft))
+  {
+  }
+
+  bool vazia() const {
+    return _entradas.empty();
+  }
+
+  bool busca(unsigned long long chave, int prof, Contagem *folhas) const {
+    const EntradaPerft &e = _entradas[chave % _entradas.size()];
+    if (e.chave == chave && e.prof == prof) {
+      *folhas = e.folhas;
+      return true;
+    }
+    return false;
+  }
+
+  void guarda(unsigned long long chave, int prof, Contagem folhas) {
+    EntradaPerft &e = _entradas[chave % _entradas.size()];
+    e.chave = chave;
+    e.prof = prof;
+    e.folhas = folhas;
+  }
+};
+
+// *Hash* FNV-1a de 64 bits, usado pelas representações para gerar a
+// chave da posição.
+static unsigned long long fnv(unsigned long long h, unsigned char c) {
+  return (h ^ c) * 1099511628211ULL;
+}
+
+static const unsigned long long FNV_INICIO = 14695981039346656037ULL;
+
+//// Representações ///////////////////////////////////////////////////////////
+
+// Todas as representações trabalham com os jogadores do motor (PRETO e
+// BRANCO) e descrevem as jogadas nas coordenadas do verificador (linha
+// 0 embaixo), para que o *divide* seja comparável entre elas.
+
+// O motor *string ***, de reversi.cpp.
+class PerftMotor {
+  string **_tabuleiro;
+
+public:
+
+  PerftMotor(string **tabuleiro)
+    : _tabuleiro(tabuleiro)
+  {
+  }
+
+  int conta(char jogador) const {
+    return pos_jogaveis(jogador, _tabuleiro).size();
+  }
+
+  template <class F>
+  void para_cada_filho(char jogador, F f) const {
+    vector<Posicao> jogaveis = pos_jogaveis(jogador, _tabuleiro);
+    int tam = (*_tabuleiro[0]).size() - 2;
+    vector<Posicao>::size_type i;
+    Desfazer desfazer;
+
+    // Executamos e desfazemos cada jogada no próprio tabuleiro.
+    for (i=0; i<jogaveis.size(); i++) {
+      PerftMotor filho(executa(&jogaveis[i], jogador, _tabuleiro,
+                               &desfazer));
+      f(filho, tam - jogaveis[i].linha, jogaveis[i].coluna - 1);
+      desfaz(&desfazer, _tabuleiro);
+    }
+  }
+
+  unsigned long long chave(char jogador) const {
+    int tam = (*_tabuleiro[0]).size();
+    unsigned long long h = fnv(FNV_INICIO, jogador);
+    int i, j;
+
+    for (i=1; i<tam-1; i++) {
+      for (j=1; j<tam-1; j++) {
+        h = fnv(h, (*_tabuleiro[i])[j]);
+      }
+    }
+    return h;
+  }
+};
+
+// O *Board* do verificador, em test/board.cpp.
+class PerftBoard {
+  Board _board;
+
+  static Cell_state estado(char jogador) {
+    return jogador == PRETO ? black : white;
+  }
+
+public:
+
+  PerftBoard(Board const &board)
+    : _board(board)
+  {
+  }
+
+  int conta(char jogador) {
+    int r, c, n = 0;
+
+    for (r=0; r<_board.size(); r++) {
+      for (c=0; c<_board.size(); c++) {
+        if (_board.is_valid(Move(estado(jogador), Cell(r, c)))) {
+          n++;
+        }
+      }
+    }
+    return n;
+  }
+
+  template <class F>
+  void para_cada_filho(char jogador, F f) {
+    int r, c;
+
+    for (r=_board.size()-1; r>=0; r--) {
+      for (c=0; c<_board.size(); c++) {
+        Move m(estado(jogador), Cell(r, c));
+        if (_board.is_valid(m)) {
+          PerftBoard filho(_board);
+          filho._board.play(m);
+          f(filho, r, c);
+        }
+      }
+    }
+  }
+
+  unsigned long long chave(char jogador) const {
+    unsigned long long h = fnv(FNV_INICIO, jogador);
+    int r, c;
+
+    for (r=_board.size()-1; r>=0; r--) {
+      for (c=0; c<_board.size(); c++) {
+        h = fnv(h, "-01"[_board[Cell(r, c)]]);
+      }
+    }
+    return h;
+  }
+};
+
+// Monta um *Board* a partir do tabuleiro do motor.
+static Board para_board(string **tabuleiro) {
+  int tam = (*tabuleiro[0]).size() - 2;
+  Board board(tam);
+  int i, j;
+
+  for (i=1; i<=tam; i++) {
+    for (j=1; j<=tam; j++) {
+      char c = (*tabuleiro[i])[j];
+      board[Cell(tam - i, j - 1)] =
+        c == PRETO ? black : (c == BRANCO ? white : ::empty);
+    }
+  }
+  return board;
+}
+
+//// Contagem /////////////////////////////////////////////////////////////////
+
+template <class R>
+Contagem perft(R &r, char jogador, int prof, TabelaPerft &tabela) {
+  char oponente = jogador == PRETO ? BRANCO : PRETO;
+  unsigned long long chave = 0;
+  Contagem folhas = 0;
+  int n;
+
+  if (prof == 0) {
+    return 1;
+  }
+
+  // No último nível, basta contar as jogadas. Sem jogadas, a posição
+  // gera uma única folha: a passada de vez ou o fim do jogo.
+  if (prof == 1) {
+    n = r.conta(jogador);
+    return n > 0 ? n : 1;
+  }
+
+  if (!tabela.vazia()) {
+    chave = r.chave(jogador);
+    if (tabela.busca(chave, prof, &folhas)) {
+      return folhas;
+    }
+  }
+
+  r.para_cada_filho(jogador, [&](R &filho, int, int) {
+      folhas += perft(filho, oponente, prof - 1, tabela);
+    });
+
+  if (folhas == 0) {
+    // Sem jogadas: o jogo acabou ou o jogador passa a vez.
+    if (r.conta(oponente) == 0) {
+      folhas = 1;
+    } else {
+      folhas = perft(r, oponente, prof - 1, tabela);
+    }
+  }
+
+  if (!tabela.vazia()) {
+    tabela.guarda(chave, prof, folhas);
+  }
+  return folhas;
+}
+
+// Mostra a contagem de cada jogada da raiz.
+template <class R>
+void divide(R &r, char jogador, int prof, TabelaPerft &tabela) {
+  char oponente = jogador == PRETO ? BRANCO : PRETO;
+
+  r.para_cada_filho(jogador, [&](R &filho, int linha, int coluna) {
+      cout << "  " << linha << " " << coluna << ": "
+           << perft(filho, oponente, prof - 1, tabela) << endl;
+    });
+}
+
+//// Programa principal ///////////////////////////////////////////////////////
+
+typedef chrono::steady_clock Relogio;
+
+// Executa o perft de 1 até *prof_max* em uma representação, mostrando
+// folhas, tempo e folhas/segundo, e guarda as contagens em *folhas*.
+template <class R>
+void executa_perft(const string &nome, R r, char jogador, int prof_max,
+                   int megabytes, bool com_divide, vector<Contagem> *folhas) {
+  int prof;
+
+  for (prof=1; prof<=prof_max; prof++) {
+    TabelaPerft tabela(megabytes);
+    Relogio::time_point inicio = Relogio::now();
+    Contagem n = perft(r, jogador, prof, tabela);
+    double s = chrono::duration<double>(Relogio::now() - inicio).count();
+
+    cout << left << setw(8) << nome << right << setw(5) << prof
+         << setw(16) << n << fixed << setprecision(3) << setw(11) << s
+         << setprecision(0) << setw(14) << (s > 0 ? n / s : 0) << endl;
+    folhas->push_back(n);
+  }
+  if (com_divide) {
+    TabelaPerft tabela(megabytes);
+    divide(r, jogador, prof_max, tabela);
+  }
+}
+
+static void uso(const char *comando) {
+  cerr << "Uso: " << comando << " [-r motor|board|todos] [-d prof]"
+       << " [-t tam] [-p posicao] [-h MB] [-D]\n";
+  exit(1);
+}
+
+int main(int argc, char *argv[]) {
+  string representacao = "todos", posicao;
+  int prof = 6, tam = 8, megabytes = 0, opcao;
+  bool com_divide = false, diverge = false;
+  vector<Contagem> motor, board;
+  string **tabuleiro;
+  char jogador = PRETO;
+  vector<Contagem>::size_type i;
+
+  while ((opcao = getopt(argc, argv, "r:d:t:p:h:D")) != -1) {
+    switch (opcao) {
+    case 'r': representacao = optarg; break;
+    case 'd': prof = atoi(optarg); break;
+    case 't': tam = atoi(optarg); break;
+    case 'p': posicao = optarg; break;
+    case 'h': megabytes = atoi(optarg); break;
+    case 'D': com_divide = true; break;
+    default: uso(argv[0]);
+    }
+  }
+  if (representacao != "motor" && representacao != "board" &&
+      representacao != "todos") {
+    uso(argv[0]);
+  }
+
+  if (posicao.empty()) {
+    if (tam < 4 || tam % 2 != 0) {
+      cerr << "Tamanho de tabuleiro inválido: " << tam << endl;
+      exit(1);
+    }
+    tabuleiro = novo_tabuleiro(tam);
+  } else {
+    tabuleiro = le_posicao(posicao, &jogador);
+    if (tabuleiro == NULL) {
+      cerr << "Posição inválida: " << posicao << endl;
+      exit(1);
+    }
+  }
+
+  cout << "Posição: " << escreve_posicao(jogador, tabuleiro) << endl
+       << left << setw(8) << "repr" << right << setw(5) << "prof"
+       << setw(16) << "folhas" << setw(11) << "tempo(s)"
+       << setw(14) << "folhas/s" << endl;
+
+  if (representacao != "board") {
+    executa_perft("motor", PerftMotor(tabuleiro), jogador, prof,
+                  megabytes, com_divide, &motor);
+  }
+  if (representacao != "motor") {
+    executa_perft("board", PerftBoard(para_board(tabuleiro)), jogador,
+                  prof, megabytes, com_divide, &board);
+  }
+
+  // Conferimos as representações entre si.
+  if (representacao == "todos") {
+    for (i=0; i<motor.size(); i++) {
+      if (motor[i] != board[i]) {
+        cout << "DIVERGÊNCIA na profundidade " << i+1 << ": motor "
+             << motor[i] << ", board " << board[i] << endl;
+        diverge = true;
+      }
+    }
+    if (!diverge) {
+      cout << "Todas as representações concordam." << endl;
+    }
+  }
+
+  libera_tabuleiro(tabuleiro);
+  return diverge ? 1 : 0;
+}
@@ -0,0 +1,201 @@
+//// Ponderação (busca durante a vez do oponente) /////////////////////////////
+
+// Veja pondera.h.
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+#include "pondera.h"
+
+Ponderador::Ponderador(TabelaTransposicao *tabela)
+  : _tabela(tabela), _tabuleiro(NULL), _motor(PRETO), _prevista(POS_NULA),
+    _nivel(0), _ativo(false)
+{
+  _controle.parar = false;
+  _controle.com_prazo = false;
+}
+
+Ponderador::~Ponderador() {
+  para();
+  if (_tabuleiro != NULL) {
+    libera_tabuleiro(_tabuleiro);
+  }
+}
+
+// Corpo da *thread* de fundo.
+void Ponderador::pondera() {
+  char oponente = '0' + (_motor + 1) % 2;
+  vector<Posicao> respostas;
+  vector<Posicao>::size_type i;
+  Desfazer desfazer;
+  int nivel;
+
+  tabela_busca = _tabela;
+
+  if (_prevista.linha != -1) {
+    // A resposta prevista já está no tabuleiro: é uma busca normal,
+    // que só para no nível pedido ou quando o oponente errar a
+    // previsão.
+    _resultado = aprofunda(_motor, _tabuleiro, _nivel, &_controle, nullptr);
+  } else {
+    // Todas as respostas, um nível de cada vez, para que todas estejam
+    // igualmente adiantadas quando o oponente jogar.
+    respostas = pos_jogaveis(oponente, _tabuleiro);
+    for (nivel=1; nivel<=_nivel && !_controle.parar.load(); nivel++) {
+      for (i=0; i<respostas.size() && !_controle.parar.load(); i++) {
+        executa(&respostas[i], oponente, _tabuleiro, &desfazer);
+        arena_busca.reinicia();
+        controle_busca = &_controle;
+        minimax(_motor, _tabuleiro, nivel);
+        controle_busca = NULL;
+        desfaz(&desfazer, _tabuleiro);
+      }
+    }
+    arena_busca.reinicia();
+  }
+
+  tabela_busca = NULL;
+}
+
+void Ponderador::inicia(char motor, string **tabuleiro, int nivel,
+                        bool todas) {
+  char oponente = '0' + (motor + 1) % 2;
+  int tam = (*tabuleiro[0]).size() - 2;
+  EntradaTT entrada;
+
+  para();
+  if (_tabuleiro != NULL) {
+    libera_tabuleiro(_tabuleiro);
+  }
+  _tabuleiro = copia_tabuleiro(tabuleiro);
+  _motor = motor;
+  _nivel = nivel;
+  _prevista = POS_NULA;
+
+  // A resposta prevista é a melhor jogada do oponente encontrada pela
+  // busca que acabou de escolher a jogada do motor. Uma colisão de
+  // chaves (ou uma entrada canônica antiga) pode dar uma jogada que não
+  // vale nesta posição; nesse caso, não há previsão.
+  if (!todas && busca_tabela(_tabela, oponente, tabuleiro, &entrada) &&
+      entrada.linha != -1) {
+    _prevista.linha = entrada.linha;
+    _prevista.coluna = entrada.coluna;
+    if (_prevista.linha < 1 || _prevista.linha > tam ||
+        _prevista.coluna < 1 || _prevista.coluna > tam ||
+        !pos_valida(&_prevista, oponente, _tabuleiro)) {
+      _prevista = POS_NULA;
+    } else {
+      executa(&_prevista, oponente, _tabuleiro);
+    }
+  }
+
+  _controle.parar = false;
+  _controle.com_prazo = false;
+  _ativo = true;
+  _thread = thread(&Ponderador::pondera, this);
+}
+
+bool Ponderador::resposta(const Posicao &jogada, Resultado *r) {
+  if (!_ativo) {
+    return false;
+  }
+  if (_prevista.linha == -1 || _prevista.linha != jogada.linha ||
+      _prevista.coluna != jogada.coluna) {
+    para();
+    return false;
+  }
+  _thread.join();
+  _ativo = false;
+  *r = _resultado;
+  return true;
+}
+
+void Ponderador::para() {
+  if (!_ativo) {
+    return;
+  }
+  _controle.parar = true;
+  _thread.join();
+  _ativo = false;
+}
+
+//// Partida contra uma pessoa ////////////////////////////////////////////////
+
+// Lê uma jogada válida do humano, nas coordenadas do arquivo de
+// jogadas ("linha coluna", linha 0 embaixo). Retorna *false* no fim da
+// entrada.
+static bool le_jogada(char humano, string **tabuleiro, Posicao *jogada) {
+  int tam = (*tabuleiro[0]).size() - 2;
+  string linha;
+  int r, c;
+
+  while (true) {
+    cerr << "Sua jogada (linha coluna): " << flush;
+    if (!getline(cin, linha)) {
+      return false;
+    }
+    istringstream s(linha);
+    if (!(s >> r >> c) || r < 0 || r >= tam || c < 0 || c >= tam) {
+      cerr << "Jogada inválida: " << linha << endl;
+      continue;
+    }
+    jogada->linha = tam - r;
+    jogada->coluna = c + 1;
+    if (!pos_valida(jogada, humano, tabuleiro)) {
+      cerr << "Jogada não permitida: " << linha << endl;
+      continue;
+    }
+    return true;
+  }
+}
+
+void joga_humano(int nivel, int tam_tabuleiro, char humano,
+                 const string &modo) {
+  string **tabuleiro = novo_tabuleiro(tam_tabuleiro);
+  TabelaTransposicao tabela(TAM_TABELA_PADRAO);
+  Ponderador ponderador(&tabela);
+  char motor = '0' + (humano + 1) % 2;
+  char jogador = PRETO;
+  int qtd_jogadas = 0;
+  bool acertou = false;
+  Relogio::time_point inicio;
+  Resultado pronto;
+  Posicao jogada;
+
+  tabela_busca = &tabela;
+  while (true) {
+    if (jogador == humano) {
+      if (!le_jogada(humano, tabuleiro, &jogada)) {
+        break;
+      }
+      acertou = ponderador.resposta(jogada, &pronto);
+      executa(&jogada, humano, tabuleiro);
+      mostra(humano, &jogada, qtd_jogadas, tabuleiro);
+    } else {
+      // Num acerto, a jogada já foi buscada durante a vez do humano.
+      inicio = Relogio::now();
+      jogada = acertou ? pronto.pos : *planeja(motor, tabuleiro, nivel);
+      cerr << "Motor pensou " << fixed << setprecision(3)
+           << chrono::duration<double>(Relogio::now() - inicio).count()
+           << " s" << (acertou ? " (jogada prevista)" : "") << endl;
+      acertou = false;
+      if (jogada.linha != -1) {
+        executa(&jogada, motor, tabuleiro);
+        mostra(motor, &jogada, qtd_jogadas, tabuleiro);
+      }
+      if (modo != "nao" && tem_jogada(humano, tabuleiro)) {
+        ponderador.inicia(motor, tabuleiro, nivel, modo == "todas");
+      }
+    }
+    jogador = proximo(jogador, tabuleiro);
+    if (jogador == '9') {
+      break;
+    }
+    qtd_jogadas++;
+  }
+
+  ponderador.para();
+  tabela_busca = NULL;
+  libera_tabuleiro(tabuleiro);
+}
@@ -0,0 +1,70 @@
+#ifndef _PONDERA_H_
+#define _PONDERA_H_
+
+//// Ponderação (busca durante a vez do oponente) /////////////////////////////
+
+// Enquanto o oponente pensa, o motor não precisa ficar parado. Depois
+// de jogar, ele continua buscando em uma *thread* de fundo:
+//
+// * no modo *prevista*, busca a posição que resulta da resposta que
+//   ele mesmo previu para o oponente (a melhor resposta guardada na
+//   tabela de transposição). Se o oponente jogar a prevista (*ponder
+//   hit*), a busca de fundo continua até o nível pedido e seu
+//   resultado é a próxima jogada, sem recomeçar nada;
+// * no modo *todas*, busca a posição após cada resposta possível,
+//   aprofundando todas juntas, um nível por vez.
+//
+// Quando o oponente joga outra coisa (*ponder miss*), a busca de fundo
+// é interrompida, mas tudo o que ela completou continua na tabela de
+// transposição, de onde a busca normal reaproveita o que puder.
+
+#include <thread>
+
+#include "reversi.h"
+
+class Ponderador {
+
+  TabelaTransposicao *_tabela;
+  thread _thread;
+  Controle _controle;
+  string **_tabuleiro;  // cópia da posição ponderada
+  char _motor;
+  Posicao _prevista;    // linha -1: todas as respostas
+  int _nivel;
+  Resultado _resultado;
+  bool _ativo;
+
+  void pondera();
+
+  // Não copiamos ponderadores.
+  Ponderador(Ponderador const &);
+  Ponderador &operator= (Ponderador const &);
+
+public:
+
+  Ponderador(TabelaTransposicao *tabela);
+  ~Ponderador();
+
+  // Começa a ponderar. *tabuleiro* é a posição logo após a jogada do
+  // *motor*, com o oponente a jogar; *nivel* é o nível das buscas do
+  // motor. Sem resposta prevista na tabela, pondera todas.
+  void inicia(char motor, string **tabuleiro, int nivel, bool todas);
+
+  // Informa a resposta do oponente. Se for a prevista, espera a busca
+  // de fundo terminar, coloca seu resultado em *r* e retorna *true*;
+  // caso contrário, interrompe a ponderação e retorna *false*.
+  bool resposta(const Posicao &jogada, Resultado *r);
+
+  // Interrompe a ponderação, se houver uma.
+  void para();
+
+};
+
+// Partida entre uma pessoa (que joga com as peças *humano*, lendo as
+// jogadas da entrada padrão) e o motor. As jogadas dos dois lados
+// saem no formato do arquivo de jogadas; os avisos vão para a saída de
+// erros. *modo* é "nao", "prevista" ou "todas" (veja acima).
+void joga_humano(int nivel, int tam_tabuleiro, char humano,
+                 const string &modo);
+
+#endif /* _PONDERA_H_ */
@@ -0,0 +1,130 @@
+//// Corte provável (ProbCut) /////////////////////////////////////////////////
+
+// Veja probcut.h.
+
+#include <fstream>
+#include <sstream>
+#include <cmath>
+
+#include "reversi.h"
+#include "probcut.h"
+
+ProbCut *probcut = NULL;
+
+void ProbCut::acrescenta(const CorteProb &c) {
+  vector<CorteProb> *lista;
+  vector<CorteProb>::iterator i;
+
+  if ((int) _cortes.size() <= c.tam) {
+    _cortes.resize(c.tam + 1);
+  }
+  if ((int) _cortes[c.tam].size() <= c.nivel) {
+    _cortes[c.tam].resize(c.nivel + 1);
+  }
+  lista = &_cortes[c.tam][c.nivel];
+  for (i=lista->begin(); i!=lista->end() && i->nivel_raso < c.nivel_raso; ++i);
+  lista->insert(i, c);
+}
+
+bool ProbCut::carrega(const string &caminho, string *erro) {
+  ifstream entrada(caminho.c_str());
+  string linha;
+  int n = 0;
+
+  if (!entrada) {
+    *erro = caminho + ": não foi possível abrir";
+    return false;
+  }
+  while (getline(entrada, linha)) {
+    istringstream campos(linha);
+    string primeiro;
+    CorteProb c;
+
+    n++;
+    if (!(campos >> primeiro) || primeiro[0] == '#') {
+      continue;
+    }
+    if (primeiro == "limiar") {
+      if (campos >> limiar) {
+        continue;
+      }
+    } else {
+      istringstream(primeiro) >> c.tam;
+      if (campos >> c.nivel >> c.nivel_raso >> c.a >> c.b >> c.sigma &&
+          c.tam >= 4 && c.nivel_raso >= 1 && c.nivel_raso < c.nivel &&
+          c.a > 0 && c.sigma >= 0) {
+        acrescenta(c);
+        continue;
+      }
+    }
+    ostringstream s;
+    s << caminho << ":" << n << ": linha inválida";
+    *erro = s.str();
+    return false;
+  }
+  return true;
+}
+
+bool ProbCut::grava(const string &caminho) const {
+  ofstream saida(caminho.c_str());
+  size_t t, n, k;
+
+  saida << "# tam nivel nivel_raso a b sigma\n"
+        << "limiar " << limiar << "\n";
+  for (t=0; t<_cortes.size(); t++) {
+    for (n=0; n<_cortes[t].size(); n++) {
+      for (k=0; k<_cortes[t][n].size(); k++) {
+        const CorteProb &c = _cortes[t][n][k];
+        saida << c.tam << " " << c.nivel << " " << c.nivel_raso << " "
+              << c.a << " " << c.b << " " << c.sigma << "\n";
+      }
+    }
+  }
+  saida.close();
+  return !saida.fail();
+}
+
+// Para cada par calibrado, a busca rasa decide com janela mínima se
+// a * v' + b fica pelo menos *limiar* desvios acima de beta (ou abaixo
+// de alfa). Janelas abertas (±INFINITO) e limites de fim de jogo não
+// são cortados: ali a previsão não vale.
+bool corte_provavel(char jogador, string **tabuleiro, int nivel,
+                    unsigned long long chave, float alfa, float beta,
+                    float *ganho) {
+  const vector<CorteProb> *cortes =
+    probcut->cortes((*tabuleiro[0]).size() - 2, nivel);
+  Arena::Marca marca;
+  float limite, v;
+  size_t k;
+
+  if (cortes == NULL) {
+    return false;
+  }
+  for (k=0; k<cortes->size(); k++) {
+    const CorteProb &c = (*cortes)[k];
+
+    if (fabs(beta) < 999999) {
+      limite = ceil((beta + probcut->limiar * c.sigma - c.b) / c.a);
+      marca = arena_busca.marca();
+      v = minimax(jogador, tabuleiro, c.nivel_raso, chave,
+                  limite - 1, limite).ganho;
+      arena_busca.volta(marca);
+      if (v >= limite) {
+        *ganho = beta;
+        return true;
+      }
+    }
+    if (fabs(alfa) < 999999) {
+      limite = floor((alfa - probcut->limiar * c.sigma - c.b) / c.a);
+      marca = arena_busca.marca();
+      v = minimax(jogador, tabuleiro, c.nivel_raso, chave,
+                  limite, limite + 1).ganho;
+      arena_busca.volta(marca);
+      if (v <= limite) {
+        *ganho = alfa;
+        return true;
+      }
+    }
+  }
+  return false;
+}
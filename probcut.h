@@ -0,0 +1,77 @@
+#ifndef _PROBCUT_H_
+#define _PROBCUT_H_
+
+//// Corte provável (ProbCut) /////////////////////////////////////////////////
+
+// O ganho de uma busca profunda costuma ser bem previsto pelo ganho de
+// uma busca rasa da mesma posição: v ≈ a * v' + b, com um erro de
+// desvio padrão *sigma*. O *ProbCut* aproveita isso para podar nós sem
+// examiná-los a fundo: antes de expandir um nó de nível *d* com janela
+// (alfa, beta), buscamos a posição no nível raso *d'*, com janela
+// mínima, só para saber se a previsão fica acima de beta (ou abaixo de
+// alfa) com folga de *limiar* desvios. Se ficar, o nó é cortado como
+// se a busca profunda tivesse saído da janela.
+//
+// Podemos ter vários pares (d, d') para o mesmo nível (*Multi-ProbCut*):
+// tentamos do mais raso (mais barato) ao mais fundo.
+//
+// Os parâmetros dependem do tamanho do tabuleiro e são calibrados pelo
+// *calibra* (veja calibra.cpp) a partir de partidas gravadas, em um
+// arquivo de texto com uma linha por par:
+//
+//     # tam nivel nivel_raso a b sigma
+//     8 6 2 1.01 -0.12 4.73
+//
+// e, opcionalmente, uma linha "limiar <t>" (padrão 1.5).
+
+#include <string>
+#include <vector>
+
+struct CorteProb {
+  int tam, nivel, nivel_raso;
+  float a, b, sigma;
+};
+
+class ProbCut {
+
+  // Cortes por tamanho e nível, do nível raso menor para o maior.
+  std::vector<std::vector<std::vector<CorteProb> > > _cortes;
+
+public:
+
+  // Quantos desvios a previsão precisa ter de folga para cortar:
+  // maior poda menos e erra menos.
+  float limiar;
+
+  ProbCut() : limiar(1.5) {}
+
+  void acrescenta(const CorteProb &c);
+
+  // Lê os parâmetros de um arquivo; retorna *false* (com a mensagem em
+  // *erro*) se ele não existir ou tiver uma linha inválida.
+  bool carrega(const std::string &caminho, std::string *erro);
+
+  // Grava os parâmetros no formato de *carrega()*.
+  bool grava(const std::string &caminho) const;
+
+  // Cortes de um nó de *nivel* em um tabuleiro *tam* x *tam*.
+  const std::vector<CorteProb> *cortes(int tam, int nivel) const {
+    if (tam < (int) _cortes.size() && nivel < (int) _cortes[tam].size()) {
+      return &_cortes[tam][nivel];
+    }
+    return NULL;
+  }
+
+};
+
+// Parâmetros em uso pela busca (NULL: sem corte provável). São só
+// lidos durante a busca, então todas as *threads* podem compartilhá-los.
+extern ProbCut *probcut;
+
+// Tenta o corte provável em um nó do *minimax()*. Se cortar, retorna
+// *true*, com o limite da janela que o nó deve retornar em *ganho*.
+bool corte_provavel(char jogador, std::string **tabuleiro, int nivel,
+                    unsigned long long chave, float alfa, float beta,
+                    float *ganho);
+
+#endif /* _PROBCUT_H_ */
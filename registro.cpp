@@ -0,0 +1,146 @@
+//// Registro da árvore de busca //////////////////////////////////////////////
+
+// Veja registro.h.
+
+#include <sstream>
+
+#include "registro.h"
+
+thread_local RegistroBusca *registro_busca = NULL;
+
+RegistroBusca::RegistroBusca(ostream &saida, int niveis)
+  : _saida(saida), _niveis(niveis), _tam(0)
+{
+  // A busca não aloca: o caminho nunca passa da profundidade máxima.
+  _caminho.reserve(256);
+}
+
+void RegistroBusca::cabecalho() {
+  _saida << "# registro niveis " << _niveis << "\n";
+}
+
+void RegistroBusca::numero_jogada(int k) {
+  _saida << "# jogada " << k << "\n";
+}
+
+void RegistroBusca::jogada(char jogador, string **tabuleiro, int nivel,
+                           long tempo_ms, unsigned long long nos_max) {
+  _tam = (*tabuleiro[0]).size() - 2;
+  _caminho.clear();
+  _saida << "position " << escreve_posicao(jogador, tabuleiro) << "\n"
+         << "go depth " << nivel;
+  if (tempo_ms > 0) {
+    _saida << " movetime " << tempo_ms;
+  }
+  if (nos_max > 0) {
+    _saida << " nodes " << nos_max;
+  }
+  _saida << "\n";
+}
+
+void RegistroBusca::iteracao(int nivel) {
+  _saida << "# iteracao " << nivel << "\n";
+}
+
+void RegistroBusca::escreve_jogada(const Posicao &p) {
+  if (p.linha == -1) {
+    _saida << "pass";
+  } else {
+    _saida << _tam - p.linha << ":" << p.coluna - 1;
+  }
+}
+
+void RegistroBusca::escreve_no(const char *motivo, int nivel, float alfa,
+                               float beta, float ganho,
+                               const Posicao &jogada) {
+  size_t i;
+
+  _saida << "# no ";
+  if (_caminho.empty()) {
+    _saida << "raiz";
+  }
+  for (i=0; i<_caminho.size(); i++) {
+    if (i > 0) {
+      _saida << "/";
+    }
+    escreve_jogada(_caminho[i]);
+  }
+  // Somar zero troca -0 por 0, que o registro não distingue.
+  _saida << " nivel " << nivel << " janela " << alfa + 0.0f << " "
+         << beta + 0.0f << " ganho " << ganho + 0.0f << " jogada ";
+  escreve_jogada(jogada);
+  _saida << " nos " << nos_visitados << " " << motivo << "\n";
+}
+
+void RegistroBusca::resultado(const Resultado &r) {
+  _saida << "# bestmove ";
+  escreve_jogada(r.pos);
+  _saida << " score " << r.ganho << " depth " << r.nivel << " nodes "
+         << r.nos << "\n";
+}
+
+bool repete(istream &entrada, ostream &saida, string *erro) {
+  RegistroBusca *registro = NULL;
+  string linha, comando, posicao, nome;
+  string **tabuleiro = NULL;
+  int niveis, nivel, n = 0;
+  long tempo_ms;
+  unsigned long long nos_max;
+  char jogador = PRETO;
+  bool ok = true;
+
+  while (ok && getline(entrada, linha)) {
+    istringstream campos(linha);
+
+    n++;
+    if (linha.compare(0, 18, "# registro niveis ") == 0) {
+      campos >> comando >> comando >> comando >> niveis;
+      if (campos.fail() || registro != NULL) {
+        ok = false;
+        break;
+      }
+      registro = new RegistroBusca(saida, niveis);
+      registro->cabecalho();
+    } else if (linha.compare(0, 9, "# jogada ") == 0) {
+      saida << linha << "\n";
+    } else if (linha.compare(0, 9, "position ") == 0) {
+      if (tabuleiro != NULL) {
+        libera_tabuleiro(tabuleiro);
+      }
+      tabuleiro = le_posicao(linha.substr(9), &jogador);
+      ok = tabuleiro != NULL;
+    } else if (linha.compare(0, 3, "go ") == 0) {
+      campos >> comando;
+      nivel = 0;
+      tempo_ms = 0;
+      nos_max = 0;
+      while (ok && campos >> nome) {
+        if (nome == "depth") {
+          ok = !!(campos >> nivel);
+        } else if (nome == "movetime") {
+          ok = !!(campos >> tempo_ms);
+        } else if (nome == "nodes") {
+          ok = !!(campos >> nos_max);
+        } else {
+          ok = false;
+        }
+      }
+      ok = ok && registro != NULL && tabuleiro != NULL && nivel > 0;
+      if (ok) {
+        registro_busca = registro;
+        busca_jogada(jogador, tabuleiro, nivel, tempo_ms, nos_max);
+        registro_busca = NULL;
+      }
+    }
+  }
+  if (!ok) {
+    ostringstream s;
+    s << "registro inválido na linha " << n;
+    *erro = s.str();
+  }
+  if (tabuleiro != NULL) {
+    libera_tabuleiro(tabuleiro);
+  }
+  delete registro;
+  return ok;
+}
@@ -0,0 +1,93 @@
+#ifndef _REGISTRO_H_
+#define _REGISTRO_H_
+
+//// Registro da árvore de busca //////////////////////////////////////////////
+
+// Para investigar uma jogada ruim depois do fato, o motor pode
+// registrar a busca de cada jogada: a posição e os limites (em linhas
+// *position* e *go*, como os comandos do servidor), o topo da árvore
+// de busca e a resposta. Cada nó até *niveis* jogadas abaixo da raiz
+// vira uma linha, escrita quando a busca do nó termina (os filhos
+// antes do pai):
+//
+//     # no <caminho> nivel <n> janela <alfa> <beta> ganho <g> jogada <j> nos <n> <motivo>
+//
+// onde *caminho* são as jogadas desde a raiz, separadas por '/' (ou
+// "raiz"), cada uma como "linha:coluna" nas coordenadas do arquivo de
+// jogadas ou "pass"; *nos* é o total de nós da busca quando o nó
+// terminou; e *motivo* é como o nó foi resolvido: "busca" (expandido),
+// "folha", "fim" (fim de jogo), "tabela", "estavel" ou "probcut"
+// (cortes antes de expandir). Com o corte provável, as buscas rasas do
+// corte aparecem também, com o mesmo caminho do nó que as fez. Os nós
+// da iteração que o prazo ou o limite de nós interrompeu também são
+// registrados, mas os seus valores não significam nada (a iteração é
+// descartada).
+//
+// Com a busca determinística (limite de nós em vez de prazo, veja
+// *Controle* em reversi.h), o registro pode ser repetido: *repete()*
+// refaz as buscas de um registro e escreve um novo, que sai idêntico
+// ao original se o motor não mudou (e, se mudou, o *diff* mostra o
+// primeiro nó em que as buscas divergem). Buscas com prazo não se
+// repetem.
+
+#include <iostream>
+#include <vector>
+
+#include "reversi.h"
+
+class RegistroBusca {
+
+  ostream &_saida;
+  int _niveis, _tam;
+  vector<Posicao> _caminho;
+
+public:
+
+  RegistroBusca(ostream &saida, int niveis);
+
+  // Cabeçalho do registro (com a quantidade de níveis registrados).
+  void cabecalho();
+
+  // Número da jogada na partida (só informativo: *repete()* copia).
+  void numero_jogada(int k);
+
+  // Início da busca de uma jogada, com os limites no formato do *go*
+  // (zero: sem aquele limite).
+  void jogada(char jogador, string **tabuleiro, int nivel, long tempo_ms,
+              unsigned long long nos_max);
+
+  // Início de uma profundidade do aprofundamento iterativo.
+  void iteracao(int nivel);
+
+  // Caminho até o nó em busca: *entra()* antes de buscar o filho pela
+  // jogada *p*, *sai()* depois.
+  void entra(const Posicao &p) { _caminho.push_back(p); }
+  void sai() { _caminho.pop_back(); }
+
+  // Um nó resolvido (ignorado abaixo dos níveis registrados).
+  void no(const char *motivo, int nivel, float alfa, float beta,
+          float ganho, const Posicao &jogada) {
+    if ((int) _caminho.size() <= _niveis) {
+      escreve_no(motivo, nivel, alfa, beta, ganho, jogada);
+    }
+  }
+
+  // A resposta da jogada.
+  void resultado(const Resultado &r);
+
+private:
+
+  void escreve_no(const char *motivo, int nivel, float alfa, float beta,
+                  float ganho, const Posicao &jogada);
+  void escreve_jogada(const Posicao &p);
+
+};
+
+// Registro da busca da *thread* atual (NULL: sem registro).
+extern thread_local RegistroBusca *registro_busca;
+
+// Refaz as buscas do registro em *entrada*, escrevendo o novo registro
+// em *saida*. Retorna *false* se o registro for inválido.
+bool repete(istream &entrada, ostream &saida, string *erro);
+
+#endif /* _REGISTRO_H_ */
@@ -18,19 +18,32 @@
 // Portanto, para realizar um jogo, basta executar, em linha de
 // comando, a seguinte chamada:
 //
-//     $ g++ -o reversi reversi.cpp
+//     $ make
 //     $ ./reversi > jogadas.txt
 //
 // Todas as jogadas estarão no arquivo jogadas.txt
+//
+// As declarações ficam em *reversi.h* e a função *main()* em
+// *main.cpp*; assim, outros programas (como o *benchmark* em bench/)
+// podem usar o motor sem carregar o programa principal junto.
 
 //// Bibliotecas necessárias //////////////////////////////////////////////////
 
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <vector>
-#include <fstream>
-
-using namespace std;
+#include <random>
+
+#include "reversi.h"
+#include "simetria.h"
+#include "probcut.h"
+#include "estabilidade.h"
+#include "tabelas.h"
+#include "registro.h"
+#include "metricas.h"
+#include "perfil.h"
+#include "fronteira.h"
 
 //// Constantes e estruturas //////////////////////////////////////////////////
 
@@ -71,71 +84,63 @@ int DIRS[][2] = {{-1, -1}, {-1, 0}, {-1, 1},
                  { 0, -1},          { 0, 1},
                  { 1, -1}, { 1, 0}, { 1, 1}};
 
-// Definimos uma estrutura para facilitar armazenar as posições no
-// tabuleiro.
-struct Posicao {
-  int linha;
-  int coluna;
-};
-
-// Essa estrutura é utilizada pela função *planeja()* e *minimax()*,
-// pois estas retornam (recursivamente, no caso de *minimax()*) o
-// ganho da jogada e sua posição no tabuleiro.
-struct GanhoPos {
-  float ganho;
-  Posicao *pos;
-};
-
-//// Assinaturas das funções utilizadas ///////////////////////////////////////
-
-// Poderia ter incluído em um header, mas preferi deixar todo o código
-// em um só arquivo.
-void joga(int nivel, int tam_tabuleiro);
-void mostra(char jogador, Posicao *jda, int qtd_jogadas, string **tabuleiro);
-Posicao *planeja(char jogador, string **tabuleiro, int nivel);
-GanhoPos minimax(char jogador, string **tabuleiro, int nivel);
-int pontos(char jogador, string **tabuleiro);
-vector<Posicao *> pos_validas(string **tabuleiro);
-vector<Posicao *> pos_jogaveis(char jogador, string **tabuleiro);
-bool pos_valida(Posicao *pos, char jogador, string **tabuleiro);
-Posicao *pos_jogavel(Posicao *pos, char jogador, string **tabuleiro, int d[]);
-string **executa(Posicao *pos, char jogador, string **tabuleiro);
-void inverte(Posicao *pos, char jogador, string **tabuleiro, int d[]);
-char proximo(char jogador, string **tabuleiro);
+// Posição nula, retornada pelo *minimax()* quando não há jogada a
+// fazer (passada de vez ou fim de jogo).
+Posicao POS_NULA = {-1, -1};
+
+// Contador de nós visitados pelo *minimax()*.
+thread_local unsigned long long nos_visitados = 0;
+
+// Controle da busca interrompível em andamento (veja *aprofunda()*).
+thread_local Controle *controle_busca = NULL;
+
+// Arena da busca, uma por *thread* (veja arena.h).
+thread_local Arena arena_busca;
+
+// Tabela de transposição da busca, uma por *thread* (veja
+// transposicao.h).
+thread_local TabelaTransposicao *tabela_busca = NULL;
+
+// Nível a partir do qual a tabela usa chaves canônicas (0: nunca).
+int nivel_simetria = 0;
+
+// Nível mínimo dos nós que consultam a tabela para cada filho antes de
+// expandi-los (veja *minimax()*): mais perto das folhas, buscar o
+// filho custa pouco mais que executar a jogada para consultá-lo.
+static const int NIVEL_ETC = 3;
+
+// Nível mínimo dos nós que tentam o corte pelas peças estáveis: no
+// nível 1, expandir o nó custa quase o mesmo que contá-las.
+static const int NIVEL_ESTAVEL = 2;
 
 //// Função principal /////////////////////////////////////////////////////////
 
 // Função principal que executa todos os turnos de um jogo, terminando
 // quando não há mais possibilidade de movimento para os jogadores.
 void joga(int nivel, int tam_tabuleiro) {
+  joga(nivel, tam_tabuleiro, 0, 0, 0, 0);
+}
+
+// Versão com as opções usadas na geração de partidas em lote (veja
+// gera.cpp): com *tempo_ms* > 0 e/ou *nos_max* > 0, cada jogada é
+// buscada por aprofundamento iterativo até *nivel* ou até o prazo ou
+// o limite de nós (veja *busca_jogada()*); as primeiras *aleatorias*
+// jogadas são sorteadas com a *semente* dada, para que cada partida
+// gerada seja diferente. Sem prazo, a mesma semente dá sempre a mesma
+// partida. Com *registro_busca*, a busca de cada jogada é registrada
+// (veja registro.h).
+void joga(int nivel, int tam_tabuleiro, long tempo_ms,
+          unsigned long long nos_max, unsigned semente, int aleatorias) {
   // Iniciamos um novo tabuleiro de qualquer tamanho.
-  string **tabuleiro = new string*[tam_tabuleiro+2];
-  int i, j, qtd_jogadas;
+  string **tabuleiro = novo_tabuleiro(tam_tabuleiro);
+  EscopoFronteira fronteira(tabuleiro);
+  int qtd_jogadas;
   char jogador;
   Posicao *jogada;
+  Posicao escolhida;
+  mt19937 sorteio(semente);
+  vector<Posicao> jogaveis;
 
-  for (i=0; i<tam_tabuleiro+2; i++) {
-    tabuleiro[i] = new string[tam_tabuleiro+2];
-    string foo (tam_tabuleiro+2, VAZIO);
-    *tabuleiro[i] = foo;
-  }
-
-  (*tabuleiro[tam_tabuleiro/2])[tam_tabuleiro/2] = BRANCO;
-  (*tabuleiro[tam_tabuleiro/2+1])[tam_tabuleiro/2+1] = BRANCO;
-  (*tabuleiro[tam_tabuleiro/2+1])[tam_tabuleiro/2] = PRETO;
-  (*tabuleiro[tam_tabuleiro/2])[tam_tabuleiro/2+1] = PRETO;
-
-  for (i=0; i<tam_tabuleiro+2; i++) {
-    for (j=0; j<tam_tabuleiro+2; j++) {
-      if ((i==0) || (i==tam_tabuleiro+1)) {
-        (*tabuleiro[i])[j] = BORDA;
-      }
-      if ((j==0) || (j==tam_tabuleiro+1)) {
-        (*tabuleiro[i])[j] = BORDA;
-      }
-    }
-  }
-  
   // Contamos as jogadas nesta variável.
   qtd_jogadas = 0;
   // O Reversi começa sempre pelas peças pretas.
@@ -146,8 +151,20 @@ void joga(int nivel, int tam_tabuleiro) {
   // principal deste *script*.
   while (true) {
     // Planeja uma jogada (aqui será chamado o procedimento
-    // *minimax*).
-    jogada = planeja(jogador, tabuleiro, nivel);
+    // *minimax*), ou sorteia uma, no início de uma partida aleatória.
+    if (qtd_jogadas < aleatorias) {
+      jogaveis = pos_jogaveis(jogador, tabuleiro);
+      escolhida = jogaveis.empty() ? POS_NULA :
+        jogaveis[sorteio() % jogaveis.size()];
+      jogada = &escolhida;
+    } else {
+      if (registro_busca != NULL) {
+        registro_busca->numero_jogada(qtd_jogadas + 1);
+      }
+      escolhida = busca_jogada(jogador, tabuleiro, nivel, tempo_ms,
+                               nos_max).pos;
+      jogada = &escolhida;
+    }
 
     if ((jogada->linha != -1) && (jogada->coluna != -1)) {
       // Executa a jogada.    
@@ -178,6 +195,7 @@ void joga(int nivel, int tam_tabuleiro) {
     qtd_jogadas++;
   }
 
+  libera_tabuleiro(tabuleiro);
 }
 
 //// Planejamento /////////////////////////////////////////////////////////////
@@ -208,27 +226,134 @@ void joga(int nivel, int tam_tabuleiro) {
 // pseudo-código](http://en.wikipedia.org/wiki/Minimax) disponível na
 // Wikipedia.
 
+// Registra a jogada buscada nas métricas de produção, se ligadas (veja
+// metricas.h), com os nós e as consultas à tabela desde *tt*.
+static void registra_metricas(string **tabuleiro, Relogio::time_point inicio,
+                              unsigned long long nos, const ContadoresTT &tt) {
+  if (metricas_motor != NULL) {
+    metricas_motor->registra(
+      tabuleiro, chrono::duration<double>(Relogio::now() - inicio).count(),
+      nos, contadores_tt.consultas - tt.consultas,
+      contadores_tt.acertos - tt.acertos);
+  }
+}
+
 // Função auxiliar, que chama a função recursiva *minimax()*.
+//
+// Toda a memória temporária da busca vem da arena da *thread*, que é
+// reiniciada a cada jogada planejada. Por isso copiamos a jogada
+// escolhida antes de retornar.
 Posicao *planeja(char jogador, string **tabuleiro, int nivel) {
-  static GanhoPos aux;
-
+  static thread_local Posicao escolhida;
+  Relogio::time_point inicio = Relogio::now();
+  unsigned long long nos = nos_visitados;
+  ContadoresTT tt = contadores_tt;
+  GanhoPos aux;
+  PERFIL_ESCOPO(PERFIL_JOGADA);
+  EscopoFronteira fronteira(tabuleiro);
+
+  arena_busca.reinicia();
+  if (tabela_busca != NULL) {
+    tabela_busca->nova_geracao();
+  }
+  if (registro_busca != NULL) {
+    registro_busca->iteracao(nivel);
+  }
   aux = minimax(jogador, tabuleiro, nivel);
-  return aux.pos;
+  escolhida = *aux.pos;
+  arena_busca.reinicia();
+  registra_metricas(tabuleiro, inicio, nos_visitados - nos, tt);
+  return &escolhida;
 }
 
 // Planeja a próxima jogada de determinado jogador através do
-// algoritmo *minimax*.
+// algoritmo *minimax*, a partir da chave calculada do zero e com a
+// janela inteira (veja a versão abaixo).
 GanhoPos minimax(char jogador, string **tabuleiro, int nivel) {
-  vector<Posicao *> jogaveis;
-  vector<GanhoPos> ganhos;
-  int i, j, ganho;
+  return minimax(jogador, tabuleiro, nivel, chave_zobrist(jogador, tabuleiro),
+                 -INFINITO, INFINITO);
+}
+
+// Registra o nó resolvido, se houver registro da busca (veja
+// registro.h), e retorna o próprio resultado.
+static inline GanhoPos anota(const GanhoPos &resultado, const char *motivo,
+                             int nivel, float alfa, float beta) {
+  if (registro_busca != NULL) {
+    registro_busca->no(motivo, nivel, alfa, beta, resultado.ganho,
+                       *resultado.pos);
+  }
+  return resultado;
+}
+
+// Versão recursiva do *minimax()*, que recebe a chave de *Zobrist* da
+// posição já calculada e a janela (*alfa*, *beta*) da poda alfa-beta:
+// só interessa saber o ganho exato se ele estiver dentro da janela. Se
+// o ganho for no máximo *alfa*, o retorno é apenas um limite superior
+// (o oponente já tem alternativa melhor para ele mais acima na árvore);
+// se for pelo menos *beta*, é um limite inferior, e as jogadas
+// restantes nem são examinadas (corte beta). Com a janela inteira, o
+// ganho é exato e a jogada é a mesma do *minimax* sem poda: examinamos
+// as jogadas da última para a primeira e só trocamos de jogada por um
+// ganho estritamente maior, de forma que o empate fica com a de maior
+// índice, como antes.
+//
+// Em vez de copiar o tabuleiro para cada jogada avaliada, executamos a
+// jogada no próprio tabuleiro e a desfazemos logo após a chamada
+// recursiva. A lista de jogadas vem da arena; cada chamada recursiva
+// libera, ao retornar, tudo o que o filho alocou. Dessa forma a busca
+// não faz nenhuma chamada ao alocador global depois que a arena está
+// aquecida.
+//
+// Se houver uma tabela de transposição (*tabela_busca*), consultamos
+// a posição antes de expandi-la: uma entrada buscada com pelo menos o
+// nível pedido é usada diretamente se for exata ou se o seu limite já
+// decidir a janela. Ao final guardamos o resultado com o tipo do
+// limite, exceto quando a busca foi interrompida (o valor não seria
+// exato). Perto da raiz (veja *nivel_simetria*), a entrada é a da
+// imagem canônica da posição, e a jogada guardada é a da imagem.
+// Assim que a chave de um filho é conhecida, o seu balde na tabela já
+// é pedido ao cache (veja *antecipa()* em transposicao.h).
+//
+// Antes de expandir um nó, vemos se as peças estáveis já limitam o seu
+// ganho para fora da janela (veja estabilidade.h). Com a tabela, os
+// nós com pelo menos *NIVEL_ETC* níveis também consultam cada filho
+// antes de buscar qualquer um (*enhanced transposition cutoff*): se um
+// deles já tem guardado um limite que dá corte beta, nenhum filho
+// precisa ser buscado.
+//
+// Com *probcut* ligado, os nós com parâmetros calibrados para o seu
+// nível tentam antes um corte provável (veja probcut.h).
+//
+// Com *registro_busca*, cada nó resolvido perto da raiz é registrado
+// com a janela recebida e o motivo da resposta (veja *anota()*).
+GanhoPos minimax(char jogador, string **tabuleiro, int nivel,
+                 unsigned long long chave, float alfa, float beta) {
+  Posicao *jogaveis;
+  int i, qtd, ganho;
+  float valor, alfa_original = alfa;
   GanhoPos aux, maior;
-  Posicao *posNula = new Posicao;
   int oponente = (jogador + 1) % 2;
-  bool fim;
-  vector<Posicao *> validas;
   int tam_tabuleiro = (*tabuleiro[0]).size();
-  string **copia_tabuleiro = new string*[tam_tabuleiro];
+  Desfazer desfazer;
+  Arena::Marca marca;
+  TabelaTransposicao *tabela = tabela_busca;
+  EntradaTT entrada;
+  unsigned long long chave_tt = chave;
+  int transformacao = 0, transformacao_filho, linha, coluna;
+  unsigned long long chave_filho;
+  bool etc = false;
+  char tipo;
+  PERFIL_ESCOPO(PERFIL_BUSCA);
+
+  nos_visitados++;
+
+  // Se a busca foi interrompida, retornamos logo: o valor não importa,
+  // pois quem iniciou a busca descarta a iteração incompleta.
+  aux.pos = &POS_NULA;
+  if (controle_busca != NULL && busca_interrompida()) {
+    aux.ganho = 0;
+    return aux;
+  }
 
   // Critério de parada: se o nível for zero, retorna a diferença de
   // peças que o jogador possui com o oponente no tabuleiro.  Note
@@ -236,96 +361,322 @@ GanhoPos minimax(char jogador, string **tabuleiro, int nivel) {
   // em si (sua posição no tabuleiro).
   if (nivel == 0) {
     aux.ganho = pontos(jogador, tabuleiro);
-    posNula->linha = -1;
-    posNula->coluna = -1;
-    aux.pos = posNula;
-    return aux;
+    return anota(aux, "folha", nivel, alfa, beta);
+  }
+
+  // Posição já buscada (a jogada, se houver, vai para a arena, como as
+  // demais listas do nó).
+  if (tabela != NULL && nivel_simetria > 0 && nivel >= nivel_simetria) {
+    chave_tt = chave_canonica(jogador, tabuleiro, &transformacao) ^
+               CHAVE_CANONICA;
+  }
+  if (tabela != NULL && tabela->busca(chave_tt, &entrada) &&
+      entrada.nivel >= nivel &&
+      (entrada.tipo == TT_EXATO ||
+       (entrada.tipo == TT_INFERIOR && entrada.ganho >= beta) ||
+       (entrada.tipo == TT_SUPERIOR && entrada.ganho <= alfa))) {
+    aux.ganho = entrada.ganho;
+    if (entrada.linha != -1) {
+      aux.pos = arena_busca.aloca<Posicao>(1);
+      aux.pos->linha = entrada.linha;
+      aux.pos->coluna = entrada.coluna;
+      destransforma(transformacao, tam_tabuleiro - 2,
+                    &aux.pos->linha, &aux.pos->coluna);
+    }
+    return anota(aux, "tabela", nivel, alfa, beta);
+  }
+
+  // Corte pelas peças estáveis: o ganho não pode entrar na janela.
+  if (nivel >= NIVEL_ESTAVEL &&
+      corte_estavel(jogador, tabuleiro, nivel, alfa, beta, &aux.ganho)) {
+    return anota(aux, "estavel", nivel, alfa, beta);
+  }
+
+  // Corte provável: uma busca rasa prevê que esta sairia da janela.
+  if (probcut != NULL &&
+      corte_provavel(jogador, tabuleiro, nivel, chave, alfa, beta,
+                     &aux.ganho)) {
+    return anota(aux, "probcut", nivel, alfa, beta);
   }
 
   // Vamos executar e analisar todas as jogadas possíveis desse
   // nível. Portanto, encontramos todas as posições possíveis de
   // jogada.
-  jogaveis = pos_jogaveis(jogador, tabuleiro);
+  jogaveis = arena_busca.aloca<Posicao>(max_jogaveis(tabuleiro));
+  qtd = pos_jogaveis(jogador, tabuleiro, jogaveis);
 
   // Se não existem jogadas possíveis ou o jogo terminou ou passamos
   // a vez (chamamos minimax para o oponente)
-  if (jogaveis.size() == 0) {
-    fim = false;
-    
-    for (i=0; i<validas.size(); i++) {
-      if (pos_valida(validas.at(i), '0' + oponente, tabuleiro)) {
-        fim = true;
-      }
-    }
-    // Não existem mais posições válidas, o jogo terminou,
-    // então o ganho será o máximo ou o mínimo possível para o
-    // jogador (forçamos isso com um valor muito grande), ou 0
-    // caso não há diferença nos pontos.
-    if (fim) {
+  if (qtd == 0) {
+    // Se o oponente também não pode jogar, o jogo terminou, então o
+    // ganho será o máximo ou o mínimo possível para o jogador
+    // (forçamos isso com um valor muito grande), ou 0 caso não há
+    // diferença nos pontos.
+    if (!tem_jogada('0' + oponente, tabuleiro)) {
       ganho = pontos(jogador, tabuleiro);
       if (ganho < 0) {
         aux.ganho = -999999;
-        posNula->linha = -1;
-        posNula->coluna = -1;
-        aux.pos = posNula;
-        return aux;
       } else if (ganho > 0) {
         aux.ganho = 999999;
-        posNula->linha = -1;
-        posNula->coluna = -1;
-        aux.pos = posNula;
-        return aux;
       } else {
         aux.ganho = ganho;
-        posNula->linha = -1;
-        posNula->coluna = -1;
-        aux.pos = posNula;
-        return aux;
       }
+      return anota(aux, "fim", nivel, alfa, beta);
     }
 
     // Caso contrário, passamos a vez para o oponente, chamando
     // minimax para ele.
-    aux.ganho = -minimax('0' + oponente, tabuleiro, nivel-1).ganho;
-    posNula->linha = -1;
-    posNula->coluna = -1;
-    aux.pos = posNula;
-    return aux;
+    marca = arena_busca.marca();
+    if (registro_busca != NULL) {
+      registro_busca->entra(POS_NULA);
+    }
+    aux.ganho = -minimax('0' + oponente, tabuleiro, nivel-1,
+                         chave ^ CHAVE_VEZ, -beta, -alfa).ganho;
+    if (registro_busca != NULL) {
+      registro_busca->sai();
+    }
+    arena_busca.volta(marca);
+    maior = aux;
+  } else {
+    // Escolhemos o melhor valor possível das jogadas, ou seja, o
+    // melhor para o jogador é o menor ganho do oponente, como
+    // discutido acima. É aqui que é feita a chamada recursiva,
+    // sempre invertendo os sinais dos valores dos tabuleiros, o
+    // jogador e a janela.
+    maior.ganho = -INFINITO;
+    maior.pos = &POS_NULA;
+
+    // Corte de transposição: um filho com limite superior guardado de
+    // no máximo -beta já garante o corte beta.
+    if (tabela != NULL && nivel >= NIVEL_ETC && beta < INFINITO) {
+      for (i=qtd-1; i>=0 && !etc; i--) {
+        executa(&jogaveis[i], jogador, tabuleiro, &desfazer);
+        chave_filho = chave ^ desfazer.chave ^ CHAVE_VEZ;
+        if (nivel_simetria > 0 && nivel - 1 >= nivel_simetria) {
+          chave_filho = chave_canonica('0' + oponente, tabuleiro,
+                                       &transformacao_filho) ^
+                        CHAVE_CANONICA;
+        }
+        if (tabela->busca(chave_filho, &entrada) &&
+            entrada.nivel >= nivel - 1 && entrada.tipo != TT_INFERIOR &&
+            -entrada.ganho >= beta) {
+          maior.ganho = -entrada.ganho;
+          maior.pos = &jogaveis[i];
+          etc = true;
+        }
+        desfaz(&desfazer, tabuleiro);
+      }
+    }
+
+    for (i=qtd-1; i>=0 && !etc; i--) {
+      marca = arena_busca.marca();
+      executa(&jogaveis[i], jogador, tabuleiro, &desfazer);
+      chave_filho = chave ^ desfazer.chave ^ CHAVE_VEZ;
+      if (tabela != NULL &&
+          (nivel_simetria == 0 || nivel - 1 < nivel_simetria)) {
+        tabela->antecipa(chave_filho);
+      }
+      if (registro_busca != NULL) {
+        registro_busca->entra(jogaveis[i]);
+      }
+      valor = -minimax('0' + oponente, tabuleiro, nivel-1, chave_filho,
+                       -beta, -alfa).ganho;
+      if (registro_busca != NULL) {
+        registro_busca->sai();
+      }
+      desfaz(&desfazer, tabuleiro);
+      arena_busca.volta(marca);
+
+      if (valor > maior.ganho) {
+        maior.ganho = valor;
+        maior.pos = &jogaveis[i];
+        if (valor > alfa) {
+          alfa = valor;
+        }
+        if (alfa >= beta) {
+          break;
+        }
+      }
+    }
   }
 
-  // Escolhemos o melhor valor possível das jogadas, ou seja, o
-  // melhor para o jogador é o menor ganho do oponente, como
-  // discutido acima. É aqui que é feita a chamada recursiva, sempre
-  // invertendo os sinais dos valores dos tabuleiros e o jogador.
-  for (i=0; i<jogaveis.size(); i++) {
-    for (j=0; j<tam_tabuleiro; j++) {
-      copia_tabuleiro[j] = new string[tam_tabuleiro];
-      *copia_tabuleiro[j] = *tabuleiro[j];
+  if (tabela != NULL &&
+      (controle_busca == NULL || !controle_busca->parar.load())) {
+    linha = maior.pos->linha;
+    coluna = maior.pos->coluna;
+    if (linha != -1) {
+      transforma(transformacao, tam_tabuleiro - 2, &linha, &coluna);
+    }
+    if (maior.ganho <= alfa_original) {
+      tipo = TT_SUPERIOR;
+    } else if (maior.ganho >= beta) {
+      tipo = TT_INFERIOR;
+    } else {
+      tipo = TT_EXATO;
     }
+    tabela->guarda(chave_tt, nivel, maior.ganho, tipo, linha, coluna);
+  }
+
+  // Retornamos o melhor valor possível de todas as jogadas do nível
+  // atual até 0.
+
+  return anota(maior, "busca", nivel, alfa_original, beta);
+}
+
+// Consulta a posição na tabela fora da busca, sob a chave simples ou,
+// se não estiver lá, sob a canônica (trazendo a jogada de volta da
+// imagem canônica).
+bool busca_tabela(TabelaTransposicao *tabela, char jogador,
+                  string **tabuleiro, EntradaTT *entrada) {
+  int tam = (*tabuleiro[0]).size() - 2, linha, coluna, t;
 
-    ganho = -minimax('0' + oponente,
-                     executa(jogaveis.at(i), jogador, copia_tabuleiro),
-                     nivel-1).ganho;
-    aux.ganho = ganho;
-    aux.pos = jogaveis.at(i);
+  if (tabela->busca(chave_zobrist(jogador, tabuleiro), entrada)) {
+    return true;
+  }
+  if (nivel_simetria == 0 ||
+      !tabela->busca(chave_canonica(jogador, tabuleiro, &t) ^ CHAVE_CANONICA,
+                     entrada)) {
+    return false;
+  }
+  if (entrada->linha != -1) {
+    linha = entrada->linha;
+    coluna = entrada->coluna;
+    destransforma(t, tam, &linha, &coluna);
+    entrada->linha = linha;
+    entrada->coluna = coluna;
+  }
+  return true;
+}
+
+// Testa se a busca em andamento deve parar. O relógio só é consultado
+// a cada 1024 nós, para não pesar na busca; o limite de nós, que é só
+// uma comparação, em todo nó, para que a busca pare sempre no mesmo.
+bool busca_interrompida() {
+  Controle *controle = controle_busca;
+
+  if (controle->parar.load(memory_order_relaxed)) {
+    return true;
+  }
+  if (controle->nos_max > 0 && nos_visitados >= controle->nos_max) {
+    controle->parar.store(true);
+    return true;
+  }
+  if (controle->com_prazo && (nos_visitados & 1023) == 0 &&
+      Relogio::now() >= controle->prazo) {
+    controle->parar.store(true);
+    return true;
+  }
+  return false;
+}
 
-    ganhos.push_back(aux);
+// Busca por aprofundamento iterativo: chama o *minimax()* com nível 1,
+// 2, ... até *nivel_max* ou até o controle mandar parar, e retorna o
+// resultado da última profundidade completada. A primeira
+// profundidade nunca é interrompida, para que sempre haja uma
+// jogada. Depois de cada profundidade completada, chamamos
+// *a_cada_nivel* (se houver).
+Resultado aprofunda(char jogador, string **tabuleiro, int nivel_max,
+                    Controle *controle,
+                    function<void (const Resultado &)> a_cada_nivel) {
+  Relogio::time_point inicio = Relogio::now();
+  ContadoresTT tt = contadores_tt;
+  Resultado resultado;
+  GanhoPos aux;
+  int nivel;
+  PERFIL_ESCOPO(PERFIL_JOGADA);
+  EscopoFronteira fronteira(tabuleiro);
+
+  resultado.pos = POS_NULA;
+  resultado.ganho = 0;
+  resultado.nivel = 0;
+  nos_visitados = 0;
+  if (tabela_busca != NULL) {
+    tabela_busca->nova_geracao();
   }
 
-  // Encontramos o maior (máximo).
+  for (nivel=1; nivel<=nivel_max; nivel++) {
+    arena_busca.reinicia();
+    controle_busca = nivel > 1 ? controle : NULL;
+    if (registro_busca != NULL) {
+      registro_busca->iteracao(nivel);
+    }
+    aux = minimax(jogador, tabuleiro, nivel);
+    controle_busca = NULL;
+    if (nivel > 1 && controle != NULL && controle->parar.load()) {
+      break;
+    }
 
-  maior.ganho = -9999999;
-  for (i=ganhos.size()-1; i>=0; i--) {
-    if (ganhos.at(i).ganho > maior.ganho) {
-      maior.ganho = ganhos.at(i).ganho;
-      maior.pos = ganhos.at(i).pos;
+    resultado.pos = *aux.pos;
+    resultado.ganho = aux.ganho;
+    resultado.nivel = nivel;
+    resultado.nos = nos_visitados;
+    resultado.segundos =
+      chrono::duration<double>(Relogio::now() - inicio).count();
+    if (a_cada_nivel) {
+      a_cada_nivel(resultado);
+    }
+    // Sem jogada (passada de vez ou fim de jogo), não há o que
+    // aprofundar.
+    if (resultado.pos.linha == -1) {
+      break;
     }
   }
 
-  // Retornamos o melhor valor possível de todas as jogadas do nível
-  // atual até 0.
+  arena_busca.reinicia();
+  resultado.nos = nos_visitados;
+  resultado.segundos =
+    chrono::duration<double>(Relogio::now() - inicio).count();
+  registra_metricas(tabuleiro, inicio, resultado.nos, tt);
+  return resultado;
+}
 
-  return maior;
+// Busca a jogada de uma partida com os limites dados (zero: sem aquele
+// limite): com prazo ou limite de nós, por aprofundamento iterativo
+// até *nivel*; sem nenhum dos dois, direto no *nivel*, como
+// *planeja()*. Com *registro_busca*, a busca é registrada.
+Resultado busca_jogada(char jogador, string **tabuleiro, int nivel,
+                       long tempo_ms, unsigned long long nos_max) {
+  Relogio::time_point inicio = Relogio::now();
+  ContadoresTT tt = contadores_tt;
+  Controle controle;
+  Resultado resultado;
+  GanhoPos aux;
+
+  if (registro_busca != NULL) {
+    registro_busca->jogada(jogador, tabuleiro, nivel, tempo_ms, nos_max);
+  }
+  if (tempo_ms > 0 || nos_max > 0) {
+    if (tempo_ms > 0) {
+      controle.prazo = Relogio::now() + chrono::milliseconds(tempo_ms);
+      controle.com_prazo = true;
+    }
+    controle.nos_max = nos_max;
+    resultado = aprofunda(jogador, tabuleiro, nivel, &controle, nullptr);
+  } else {
+    PERFIL_ESCOPO(PERFIL_JOGADA);
+    EscopoFronteira fronteira(tabuleiro);
+    nos_visitados = 0;
+    arena_busca.reinicia();
+    if (tabela_busca != NULL) {
+      tabela_busca->nova_geracao();
+    }
+    if (registro_busca != NULL) {
+      registro_busca->iteracao(nivel);
+    }
+    aux = minimax(jogador, tabuleiro, nivel);
+    resultado.pos = *aux.pos;
+    resultado.ganho = aux.ganho;
+    arena_busca.reinicia();
+    resultado.nivel = nivel;
+    resultado.nos = nos_visitados;
+    resultado.segundos =
+      chrono::duration<double>(Relogio::now() - inicio).count();
+    registra_metricas(tabuleiro, inicio, resultado.nos, tt);
+  }
+  if (registro_busca != NULL) {
+    registro_busca->resultado(resultado);
+  }
+  return resultado;
 }
 
 // Calcula a pontuação do jogador baseando-se em seu total de peças
@@ -335,24 +686,29 @@ int pontos(char jogador, string **tabuleiro) {
   // armazenando nessas variáveis.
   int pontos_jogador = 0;
   int pontos_oponente = 0;
-  vector<Posicao *> validas;
   int oponente = (jogador + 1) % 2;
-  int i;
-  Posicao *pos;
+  int tam = (*tabuleiro[0]).size();
+  int i, j;
   char peca;
+  Fronteira *f = fronteira(tabuleiro);
+  PERFIL_ESCOPO(PERFIL_AVALIACAO);
 
-  validas = pos_validas(tabuleiro);
+  // Com a fronteira, as peças já estão contadas.
+  if (f != NULL) {
+    return f->pecas(jogador) - f->pecas('0' + oponente);
+  }
 
-  // Percorremos todas as posições válidas do tabuleiro e somamos 1
-  // quando encontramos uma peça do jogador ou do oponente (0 ou 1).
-  for (i=0; i<validas.size(); i++) {
-    pos = validas.at(i);
-    peca = (*tabuleiro[pos->linha])[pos->coluna];
+  // Percorremos todas as casas do tabuleiro (sem as bordas) e somamos
+  // 1 quando encontramos uma peça do jogador ou do oponente (0 ou 1).
+  for (i=1; i<tam-1; i++) {
+    for (j=1; j<tam-1; j++) {
+      peca = (*tabuleiro[i])[j];
 
-    if (peca == jogador) {
-      pontos_jogador++;
-    } else if (peca == '0' + oponente) {
-      pontos_oponente++;
+      if (peca == jogador) {
+        pontos_jogador++;
+      } else if (peca == '0' + oponente) {
+        pontos_oponente++;
+      }
     }
   }
 
@@ -368,22 +724,22 @@ int pontos(char jogador, string **tabuleiro) {
 // jogo*.
 
 // Retorna as casas válidas do tabuleiro (sem as bordas).
-vector<Posicao *> pos_validas(string **tabuleiro) {
-  vector<Posicao *> v;
+vector<Posicao> pos_validas(string **tabuleiro) {
+  vector<Posicao> v;
+  int tam = (*tabuleiro[0]).size();
   int i, j;
-  Posicao *pos;
+  Posicao pos;
 
   // Percorremos todo o tabuleiro e consideramos apenas as posições
   // que tenham peças ou que sejam vazias. Desconsideramos assim as
   // bordas.
-  for (i=0; i<(*tabuleiro[0]).length(); i++) {
-    for (j=0; j<(*tabuleiro[0]).length(); j++) {
+  for (i=0; i<tam; i++) {
+    for (j=0; j<tam; j++) {
       if (((*tabuleiro[i])[j] == VAZIO) || 
           ((*tabuleiro[i])[j] == PRETO) || 
           ((*tabuleiro[i])[j] == BRANCO)) {
-        pos = new Posicao;
-        pos->linha = i;
-        pos->coluna = j;
+        pos.linha = i;
+        pos.coluna = j;
         v.push_back(pos);
       }
     }
@@ -392,61 +748,98 @@ vector<Posicao *> pos_validas(string **tabuleiro) {
   return v;
 }
 
-// Retorna as posições 'jogáveis'.
-vector<Posicao *> pos_jogaveis(char jogador, string **tabuleiro) {
-  vector<Posicao *> v;
-  vector<Posicao *> validas;
-  int i;
-  Posicao *pos;
+// Preenche *v* com as posições 'jogáveis' e retorna quantas são. O
+// vetor deve ter espaço para todas as casas do tabuleiro. É esta a
+// versão usada pela busca, com *v* alocado na arena.
+int pos_jogaveis(char jogador, string **tabuleiro, Posicao *v) {
+  int tam = (*tabuleiro[0]).size();
+  int i, j, qtd = 0;
+  Posicao pos;
+  Fronteira *f = fronteira(tabuleiro);
+  PERFIL_ESCOPO(PERFIL_GERACAO);
+
+  // Nos tabuleiros grandes, só as casas da fronteira podem ser
+  // jogáveis (veja fronteira.h).
+  if (f != NULL) {
+    return f->jogaveis(jogador, v);
+  }
 
   // Para uma posição ser válida, ela precisa não ser borda e
   // corresponder a uma posição onde podemos fazer um
-  // 'traçado'. Portanto, percorremos todas as posições válidas
-  // (selecionadas pela função acima descrita) e procuraremos a
-  // partir de cada uma dessas posições, uma posição em que possamos
-  // jogar uma peça.
+  // 'traçado'. Portanto, percorremos todas as casas (sem as bordas) e
+  // procuramos, a partir de cada uma delas, uma posição em que
+  // possamos jogar uma peça.
+  for (i=1; i<tam-1; i++) {
+    for (j=1; j<tam-1; j++) {
+      pos.linha = i;
+      pos.coluna = j;
+      if (pos_valida(&pos, jogador, tabuleiro)) {
+        v[qtd++] = pos;
+      }
+    }
+  }
 
-  validas = pos_validas(tabuleiro);
-  
-  for (i=0; i<validas.size(); i++) {
-    pos = validas.at(i);
-    pos_valida(pos, jogador, tabuleiro);
+  return qtd;
+}
 
-    if (pos_valida(pos, jogador, tabuleiro)) {
-      v.push_back(pos);
+// Retorna as posições 'jogáveis' em um vetor.
+vector<Posicao> pos_jogaveis(char jogador, string **tabuleiro) {
+  vector<Posicao> v(max(max_jogaveis(tabuleiro), 1));
+
+  v.resize(pos_jogaveis(jogador, tabuleiro, &v[0]));
+  return v;
+}
+
+// Testa se o jogador tem alguma jogada, parando na primeira
+// encontrada.
+bool tem_jogada(char jogador, string **tabuleiro) {
+  int tam = (*tabuleiro[0]).size();
+  int i, j;
+  Posicao pos;
+  Fronteira *f = fronteira(tabuleiro);
+  PERFIL_ESCOPO(PERFIL_GERACAO);
+
+  if (f != NULL) {
+    return f->tem_jogada(jogador);
+  }
+  for (i=1; i<tam-1; i++) {
+    for (j=1; j<tam-1; j++) {
+      pos.linha = i;
+      pos.coluna = j;
+      if (pos_valida(&pos, jogador, tabuleiro)) {
+        return true;
+      }
     }
   }
-  
-  return v;
+  return false;
 }
 
 // Testa se a posição é válida ou não. O jogador só pode jogar em uma
 // posição que forme um traçado válido!
 bool pos_valida(Posicao *pos, char jogador, string **tabuleiro) {
   int i;
-  Posicao *pos_v;
+  Posicao pos_v;
+
+  // Somente podemos jogar nessa posição se ela estiver vazia.
+  if ((*tabuleiro[pos->linha])[pos->coluna] != VAZIO) {
+    return false;
+  }
 
   // Para cada direção a partir da posição atual, procuramos uma
-  // posição para jogar que forme um 'traçado'. Somente podemos jogar
-  // nessa posição se ela estiver vazia, portanto, também fazemos
-  // essa checagem.
+  // posição para jogar que forme um 'traçado'.
   for (i=0; i<8; i++) {
-    pos_v = pos_jogavel(pos, jogador, tabuleiro, DIRS[i]);
-    
-    if ((*tabuleiro[pos->linha])[pos->coluna] == VAZIO) {
-      if (pos_v->linha != 42) {
-        return true;
-      }
+    if (pos_jogavel(pos, jogador, tabuleiro, DIRS[i], &pos_v)) {
+      return true;
     }
   }
   
   return false;
 }
 
-// Retorna uma posição onde podemos jogar a peça (há um traçado até
-// ela) ou *None* caso contrário.
-Posicao *pos_jogavel(Posicao *pos, char jogador, string **tabuleiro, int d[]) {
-  Posicao *jogavel = new Posicao;
+// Procura uma posição onde podemos jogar a peça (há um traçado até
+// ela). Se existir, ela é guardada em *jogavel* e retornamos *true*.
+bool pos_jogavel(Posicao *pos, char jogador, string **tabuleiro, int d[],
+                 Posicao *jogavel) {
   int oponente = (jogador + 1) % 2;
 
   // Começamos pelo vizinho do canto superior esquerdo.
@@ -456,12 +849,8 @@ Posicao *pos_jogavel(Posicao *pos, char jogador, string **tabuleiro, int d[]) {
   // Se a próxima posição a partir da atual é uma de nossas peças,
   // ela não é uma posição válida para jogarmos. Apenas posições
   // vizinhas que tenham uma peça oponente nos interessam.
-  //cout << jogavel->linha << "," << jogavel->coluna << endl;
   if ((*tabuleiro[jogavel->linha])[jogavel->coluna] == jogador) {
-    // Usamos 42 como marcador ;-)
-    jogavel->linha = 42;
-    jogavel->coluna = 42;
-    return jogavel;
+    return false;
   }
 
   // Vamos seguindo as posições onde há oponentes, a última delas é a
@@ -475,12 +864,9 @@ Posicao *pos_jogavel(Posicao *pos, char jogador, string **tabuleiro, int d[]) {
   // posição for uma borda, não poderemos jogar.
   if (((*tabuleiro[jogavel->linha])[jogavel->coluna] == BORDA) ||
       ((*tabuleiro[jogavel->linha])[jogavel->coluna] == VAZIO)) {
-    jogavel->linha = 42;
-    jogavel->coluna = 42;
-    return jogavel;
-  } else {
-    return jogavel;
+    return false;
   }
+  return true;
 }
 
 //// Execução de jogadas //////////////////////////////////////////////////////
@@ -488,60 +874,111 @@ Posicao *pos_jogavel(Posicao *pos, char jogador, string **tabuleiro, int d[]) {
 // Cada vez que o jogador executa uma jogada, devemos atualizar o
 // tabuleiro considerando essa nova jogada e ao mesmo tempo, inverter
 // todas as peças adversárias que fazem parte do 'traçado'. Nessa seção
-// descrevemos as duas funções responsáveis por isso: *executa()* e
-// *inverte()*.
+// descrevemos as funções responsáveis por isso: *executa()* e
+// *inverte()*, e também *desfaz()*, que volta o tabuleiro ao estado
+// anterior à jogada.
 
 // Executa a jogada na posição especificada.
 string **executa(Posicao *pos, char jogador, string **tabuleiro) {
-  int i;
+  Desfazer desfazer;
+
+  return executa(pos, jogador, tabuleiro, &desfazer);
+}
+
+// Executa a jogada, guardando em *desfazer* o necessário para
+// desfazê-la: a posição e quantas peças foram invertidas em cada
+// direção.
+string **executa(Posicao *pos, char jogador, string **tabuleiro,
+                 Desfazer *desfazer) {
+  int lado = (*tabuleiro[0]).size(), i, k, linha, coluna, viradas = 0;
+  const TabelasTamanho *t = tabelas(lado - 2);
+  Fronteira *f = fronteira(tabuleiro);
+  unsigned long long chave;
+  PERFIL_ESCOPO(PERFIL_EXECUCAO);
 
   // Colocamos a peça da jogada atual no tabuleiro.
   (*tabuleiro[pos->linha])[pos->coluna] = jogador;
+  desfazer->pos = *pos;
+  chave = t != NULL ?
+    t->chaves[jogador - '0'][pos->linha * lado + pos->coluna] :
+    chave_casa(pos->linha, pos->coluna, jogador);
 
   // Atualizamos todas as direções possíveis a partir dessa peça,
-  // virando as peças adversárias.
+  // virando as peças adversárias. Cada peça virada troca de cor
+  // também na chave.
   for (i=0; i<8; i++) {
-    inverte(pos, jogador, tabuleiro, DIRS[i]);
+    desfazer->invertidas[i] = inverte(pos, jogador, tabuleiro, DIRS[i]);
+    linha = pos->linha;
+    coluna = pos->coluna;
+    for (k=0; k<desfazer->invertidas[i]; k++) {
+      linha += DIRS[i][0];
+      coluna += DIRS[i][1];
+      chave ^= t != NULL ? t->viradas[linha * lado + coluna] :
+               chave_casa(linha, coluna, PRETO) ^
+               chave_casa(linha, coluna, BRANCO);
+    }
+    viradas += desfazer->invertidas[i];
+  }
+  desfazer->chave = chave;
+  if (f != NULL) {
+    f->ocupa(*pos, jogador, viradas);
   }
 
-  // Retornamos o tabuleiro atualizado (é importante notar que
-  // nenhuma das funções -- a não ser a *inverte()*, que é uma função
-  // apenas chamada por *executa* -- têm *side-effects*, ou seja, os
-  // estados passados por parâmetro não são alterados. Pensamos assim
-  // para facilitar paralelismo em seguida (talvez aplicando dividir
-  // para conquistar?).
+  // Retornamos o tabuleiro atualizado.
   return tabuleiro;
 }
 
-// Inverte todas as peças adversárias em um determinada direção.
-void inverte(Posicao *pos, char jogador, string **tabuleiro, int d[]) {
-  Posicao *pos_tracado = new Posicao;
+// Inverte todas as peças adversárias em um determinada direção,
+// retornando quantas foram invertidas.
+int inverte(Posicao *pos, char jogador, string **tabuleiro, int d[]) {
+  Posicao pos_tracado, pos_final;
+  int qtd = 0;
 
   // Usamos a mesma função que utilizamos anteriormente para
   // encontrar uma posição jogável, mas agora a usamos para encontrar
-  // o final do 'traçado'.
-  Posicao *pos_final = pos_jogavel(pos, jogador, tabuleiro, d);
-
-  // Se não existe uma posição, simplesmente retornamos sem fazer
-  // nada. Importante notar que usamos o número 42 para marcar uma
-  // posição nula, visto que C++ não permite tipagem dinâmica.
-  if (pos_final->linha == 42) {
-    return;
+  // o final do 'traçado'. Se não existe uma posição, simplesmente
+  // retornamos sem fazer nada.
+  if (!pos_jogavel(pos, jogador, tabuleiro, d, &pos_final)) {
+    return 0;
   }
 
   // Vamos percorrer todas as peças do traçado, tornando-as todas
   // nossas.
-  pos_tracado->linha = pos->linha + d[0];
-  pos_tracado->coluna = pos->coluna + d[1];
-
-  while ((pos_tracado->linha != pos_final->linha) ||
-         (pos_tracado->coluna != pos_final->coluna)) {
-    (*tabuleiro[pos_tracado->linha])[pos_tracado->coluna] = jogador;
-    pos_tracado->linha += d[0];
-    pos_tracado->coluna += d[1];
+  pos_tracado.linha = pos->linha + d[0];
+  pos_tracado.coluna = pos->coluna + d[1];
+
+  while ((pos_tracado.linha != pos_final.linha) ||
+         (pos_tracado.coluna != pos_final.coluna)) {
+    (*tabuleiro[pos_tracado.linha])[pos_tracado.coluna] = jogador;
+    pos_tracado.linha += d[0];
+    pos_tracado.coluna += d[1];
+    qtd++;
   }
+  return qtd;
 }
 
+// Desfaz a jogada registrada por *executa()*: esvazia a casa jogada e
+// devolve ao oponente as peças invertidas em cada direção.
+void desfaz(Desfazer *desfazer, string **tabuleiro) {
+  Posicao *pos = &desfazer->pos;
+  char jogador = (*tabuleiro[pos->linha])[pos->coluna];
+  char oponente = '0' + (jogador + 1) % 2;
+  int i, k, viradas = 0;
+  Fronteira *f = fronteira(tabuleiro);
+  PERFIL_ESCOPO(PERFIL_EXECUCAO);
+
+  for (i=0; i<8; i++) {
+    for (k=1; k<=desfazer->invertidas[i]; k++) {
+      (*tabuleiro[pos->linha + k*DIRS[i][0]])[pos->coluna + k*DIRS[i][1]] =
+        oponente;
+    }
+    viradas += desfazer->invertidas[i];
+  }
+  (*tabuleiro[pos->linha])[pos->coluna] = VAZIO;
+  if (f != NULL) {
+    f->esvazia(*pos, jogador, viradas);
+  }
+}
 
 //// Critério de parada ///////////////////////////////////////////////////////
 
@@ -551,18 +988,18 @@ void inverte(Posicao *pos, char jogador, string **tabuleiro, int d[]) {
 // terminou.
 char proximo(char jogador, string **tabuleiro) {
   int oponente = (jogador + 1) % 2;
-  vector<Posicao *> validas = pos_validas(tabuleiro);
-  int i;
 
-  for (i=0; i<validas.size(); i++) {
-    if (pos_valida(validas.at(i), oponente, tabuleiro)) {
-      // Se o oponente pode se mover, ele joga.
-      return '0' + oponente;
-    } else if (pos_valida(validas.at(i), jogador, tabuleiro)) {
-      // Senão, o jogador atual joga (o oponente passou a vez pois
-      // está 'preso').
-      return jogador;
-    }
+  // Note que o oponente deve ser passado como caractere ('0' ou '1')
+  // e que ele tem prioridade: só passamos a vez de volta ao jogador
+  // atual se o oponente não tiver jogada em *nenhuma* casa.
+  if (tem_jogada('0' + oponente, tabuleiro)) {
+    // Se o oponente pode se mover, ele joga.
+    return '0' + oponente;
+  }
+  if (tem_jogada(jogador, tabuleiro)) {
+    // Senão, o jogador atual joga (o oponente passou a vez pois
+    // está 'preso').
+    return jogador;
   }
   // Caso contrário, todos os jogadores estarão 'presos' e o jogo
   // então termina. Sinalizamos, como já comentado, através do
@@ -578,11 +1015,7 @@ void mostra(char jogador, Posicao *jda, int qtd_jogadas, string **tabuleiro) {
   string s = "";
   string cor = "black";
   int tam_tabuleiro = (*tabuleiro[0]).size();
-  int i;
-
-  for (i=1; i<tam_tabuleiro-1; i++) {
-    s += (*tabuleiro[i]).substr(1, tam_tabuleiro-2) + "\n";
-  }
+  PERFIL_ESCOPO(PERFIL_SAIDA);
 
   if (jogador == '1')
     cor = "white";
@@ -593,21 +1026,128 @@ void mostra(char jogador, Posicao *jda, int qtd_jogadas, string **tabuleiro) {
     " " << 
     jda->coluna-1 << endl; 
 
-  // Descomente essas linhas para mostrar também o tabuleiro
+  // Descomente essas linhas para mostrar também o tabuleiro (montar o
+  // desenho percorre todas as casas, o que pesa nos tabuleiros
+  // enormes, então ele só é montado aqui)
+  // for (int i=1; i<tam_tabuleiro-1; i++) {
+  //   s += (*tabuleiro[i]).substr(1, tam_tabuleiro-2) + "\n";
+  // }
   // cout << "#" << qtd_jogadas << " Jogador: " << cor << ". Jogada:\n\n" << s;
   // cout << endl;
 }
 
-// Fazemos uma chamada padrão à função joga, como exemplo. 
-int main() {
-  // Lemos o tamanho do tabuleiro e a quantidade máxima de níveis de um
-  // arquivo de configuração.
-  ifstream conf_file("reversi.conf");
-  int nivel, tam_tabuleiro;
-  conf_file >> tam_tabuleiro;
-  conf_file >> nivel;
+//// Criação e descrição de tabuleiros ////////////////////////////////////////
 
-  joga(nivel, tam_tabuleiro);
+// Cria o tabuleiro inicial, com as bordas e as quatro primeiras peças
+// no centro.
+string **novo_tabuleiro(int tam_tabuleiro) {
+  string **tabuleiro = new string*[tam_tabuleiro+2];
+  int i, j;
+
+  for (i=0; i<tam_tabuleiro+2; i++) {
+    tabuleiro[i] = new string(tam_tabuleiro+2, VAZIO);
+  }
+
+  (*tabuleiro[tam_tabuleiro/2])[tam_tabuleiro/2] = BRANCO;
+  (*tabuleiro[tam_tabuleiro/2+1])[tam_tabuleiro/2+1] = BRANCO;
+  (*tabuleiro[tam_tabuleiro/2+1])[tam_tabuleiro/2] = PRETO;
+  (*tabuleiro[tam_tabuleiro/2])[tam_tabuleiro/2+1] = PRETO;
+
+  for (i=0; i<tam_tabuleiro+2; i++) {
+    for (j=0; j<tam_tabuleiro+2; j++) {
+      if ((i==0) || (i==tam_tabuleiro+1)) {
+        (*tabuleiro[i])[j] = BORDA;
+      }
+      if ((j==0) || (j==tam_tabuleiro+1)) {
+        (*tabuleiro[i])[j] = BORDA;
+      }
+    }
+  }
+
+  return tabuleiro;
+}
+
+// Cria uma cópia independente do tabuleiro.
+string **copia_tabuleiro(string **tabuleiro) {
+  int tam = (*tabuleiro[0]).size();
+  string **copia = new string*[tam];
+  int i;
 
-  return 0;
+  for (i=0; i<tam; i++) {
+    copia[i] = new string(*tabuleiro[i]);
+  }
+  return copia;
+}
+
+// Libera um tabuleiro criado por *novo_tabuleiro()*,
+// *copia_tabuleiro()* ou *le_posicao()*.
+void libera_tabuleiro(string **tabuleiro) {
+  int tam = (*tabuleiro[0]).size();
+  int i;
+
+  for (i=0; i<tam; i++) {
+    delete tabuleiro[i];
+  }
+  delete [] tabuleiro;
+}
+
+// Lê uma posição no formato descrito em *reversi.h*. Devolve NULL se
+// a descrição não for válida.
+string **le_posicao(const string &descricao, char *jogador) {
+  istringstream entrada(descricao);
+  string jog, linhas, linha;
+  vector<string> v;
+  string **tabuleiro;
+  int tam, i, j;
+
+  entrada >> jog >> linhas;
+  if (entrada.fail() || (jog != "0" && jog != "1")) {
+    return NULL;
+  }
+
+  istringstream partes(linhas);
+  while (getline(partes, linha, '/')) {
+    v.push_back(linha);
+  }
+
+  // O tabuleiro deve ser quadrado, de lado par e com apenas peças ou
+  // casas vazias.
+  tam = v.size();
+  if (tam < 4 || tam % 2 != 0) {
+    return NULL;
+  }
+  for (i=0; i<tam; i++) {
+    if ((int) v[i].size() != tam) {
+      return NULL;
+    }
+    for (j=0; j<tam; j++) {
+      if (v[i][j] != VAZIO && v[i][j] != PRETO && v[i][j] != BRANCO) {
+        return NULL;
+      }
+    }
+  }
+
+  tabuleiro = novo_tabuleiro(tam);
+  for (i=0; i<tam; i++) {
+    (*tabuleiro[i+1]).replace(1, tam, v[i]);
+  }
+  *jogador = jog[0];
+  return tabuleiro;
+}
+
+// Descreve a posição em uma linha de texto (o inverso de
+// *le_posicao()*).
+string escreve_posicao(char jogador, string **tabuleiro) {
+  int tam = (*tabuleiro[0]).size() - 2;
+  string s(1, jogador);
+  int i;
+
+  s += " ";
+  for (i=1; i<=tam; i++) {
+    if (i > 1) {
+      s += "/";
+    }
+    s += (*tabuleiro[i]).substr(1, tam);
+  }
+  return s;
 }
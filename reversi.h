@@ -0,0 +1,185 @@
+//// Universidade de São Paulo
+//// Instituto de Física de São Carlos
+//// *Programação Paralela*
+//// Prof. Gonzalo Travieso
+//// Aluno Vilson Vieira
+
+//// Declarações do motor Reversi (em C++) ////////////////////////////////////
+
+// Durante muito tempo todo o código ficou em um só arquivo. Agora que
+// outros programas (o *benchmark*, por exemplo) também usam o motor,
+// as constantes, estruturas e assinaturas ficam neste *header* e a
+// implementação continua em *reversi.cpp*.
+
+#ifndef _REVERSI_H_
+#define _REVERSI_H_
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+#include "arena.h"
+#include "transposicao.h"
+
+using namespace std;
+
+//// Constantes e estruturas //////////////////////////////////////////////////
+
+// Caracteres usados na representação do tabuleiro (veja *reversi.cpp*).
+extern char PRETO;
+extern char BRANCO;
+extern char VAZIO;
+extern char BORDA;
+
+// As 8 direções possíveis de um 'traçado'.
+extern int DIRS[][2];
+
+// Definimos uma estrutura para facilitar armazenar as posições no
+// tabuleiro.
+struct Posicao {
+  int linha;
+  int coluna;
+};
+
+// Essa estrutura é utilizada pela função *planeja()* e *minimax()*,
+// pois estas retornam (recursivamente, no caso de *minimax()*) o
+// ganho da jogada e sua posição no tabuleiro.
+struct GanhoPos {
+  float ganho;
+  Posicao *pos;
+};
+
+// Registro de uma jogada executada, com o necessário para desfazê-la:
+// a posição jogada e quantas peças foram invertidas em cada uma das 8
+// direções de *DIRS*. Guarda também o XOR que a jogada aplica à chave
+// de *Zobrist* da posição (sem a troca de jogador, veja
+// transposicao.h).
+struct Desfazer {
+  Posicao pos;
+  int invertidas[8];
+  unsigned long long chave;
+};
+
+// Limite das janelas da poda alfa-beta: maior que qualquer ganho (o
+// fim de jogo vale ±999999).
+const float INFINITO = 9999999;
+
+// Posição nula (-1, -1), usada quando não há jogada.
+extern Posicao POS_NULA;
+
+// Quantidade de nós visitados por *minimax()* (na *thread* atual)
+// desde a última vez que o contador foi zerado. Útil para medir
+// desempenho (nós/segundo).
+extern thread_local unsigned long long nos_visitados;
+
+// Arena de onde a busca tira sua memória temporária, uma por *thread*.
+// É reiniciada a cada chamada de *planeja()*.
+extern thread_local Arena arena_busca;
+
+// Tabela de transposição usada pela busca na *thread* atual (NULL
+// para buscar sem tabela).
+extern thread_local TabelaTransposicao *tabela_busca;
+
+// Nos nós com pelo menos este nível restante, a tabela de transposição
+// usa a chave canônica da posição (veja simetria.h), de forma que
+// posições simétricas compartilham a entrada; 0 desliga. Perto da raiz
+// os nós são poucos e caros, então o custo de canonizar é desprezível.
+extern int nivel_simetria;
+
+typedef chrono::steady_clock Relogio;
+
+// Controle de uma busca que pode ser interrompida, seja por outra
+// *thread* (ligando *parar*), por um prazo ou por um limite de nós.
+// Outra *thread* também pode dar um prazo a uma busca em andamento
+// (como no *ponderhit* do servidor): basta escrever *prazo* antes de
+// ligar *com_prazo*.
+//
+// O limite de nós (*nos_max*, 0 sem limite) torna a busca
+// determinística: ao contrário do prazo, ele para a busca sempre no
+// mesmo nó, qualquer que seja a máquina ou a carga, e a mesma posição
+// dá sempre a mesma jogada (veja também registro.h).
+struct Controle {
+  atomic<bool> parar;
+  atomic<bool> com_prazo;
+  Relogio::time_point prazo;
+  unsigned long long nos_max;
+
+  Controle() : parar(false), com_prazo(false), nos_max(0) {}
+};
+
+// Controle da busca em andamento na *thread* atual (NULL se a busca não
+// pode ser interrompida).
+extern thread_local Controle *controle_busca;
+
+// Resultado de uma busca por aprofundamento iterativo: a jogada e o
+// ganho da última profundidade completada, com nós e tempo gastos até
+// ali.
+struct Resultado {
+  Posicao pos;
+  float ganho;
+  int nivel;
+  unsigned long long nos;
+  double segundos;
+};
+
+//// Assinaturas das funções utilizadas ///////////////////////////////////////
+
+void joga(int nivel, int tam_tabuleiro);
+void joga(int nivel, int tam_tabuleiro, long tempo_ms,
+          unsigned long long nos_max, unsigned semente, int aleatorias);
+Resultado busca_jogada(char jogador, string **tabuleiro, int nivel,
+                       long tempo_ms, unsigned long long nos_max);
+void mostra(char jogador, Posicao *jda, int qtd_jogadas, string **tabuleiro);
+Posicao *planeja(char jogador, string **tabuleiro, int nivel);
+GanhoPos minimax(char jogador, string **tabuleiro, int nivel);
+GanhoPos minimax(char jogador, string **tabuleiro, int nivel,
+                 unsigned long long chave, float alfa, float beta);
+bool busca_tabela(TabelaTransposicao *tabela, char jogador,
+                  string **tabuleiro, EntradaTT *entrada);
+bool busca_interrompida();
+Resultado aprofunda(char jogador, string **tabuleiro, int nivel_max,
+                    Controle *controle,
+                    function<void (const Resultado &)> a_cada_nivel);
+int pontos(char jogador, string **tabuleiro);
+vector<Posicao> pos_validas(string **tabuleiro);
+int pos_jogaveis(char jogador, string **tabuleiro, Posicao *v);
+vector<Posicao> pos_jogaveis(char jogador, string **tabuleiro);
+bool tem_jogada(char jogador, string **tabuleiro);
+bool pos_valida(Posicao *pos, char jogador, string **tabuleiro);
+bool pos_jogavel(Posicao *pos, char jogador, string **tabuleiro, int d[],
+                 Posicao *jogavel);
+string **executa(Posicao *pos, char jogador, string **tabuleiro);
+string **executa(Posicao *pos, char jogador, string **tabuleiro,
+                 Desfazer *desfazer);
+int inverte(Posicao *pos, char jogador, string **tabuleiro, int d[]);
+void desfaz(Desfazer *desfazer, string **tabuleiro);
+char proximo(char jogador, string **tabuleiro);
+
+//// Criação e descrição de tabuleiros ////////////////////////////////////////
+
+// Cria o tabuleiro inicial (com bordas) de *tam_tabuleiro* casas de
+// lado.
+string **novo_tabuleiro(int tam_tabuleiro);
+// Cria uma cópia independente do tabuleiro.
+string **copia_tabuleiro(string **tabuleiro);
+// Libera a memória de um tabuleiro criado pelas funções acima.
+void libera_tabuleiro(string **tabuleiro);
+
+// Uma posição pode ser descrita em uma linha de texto, no formato
+//
+//     <jogador> <linha 1>/<linha 2>/.../<linha n>
+//
+// onde *jogador* é 0 ou 1 (quem joga a seguir) e cada linha usa os
+// mesmos caracteres do tabuleiro (sem as bordas), da linha de cima
+// para a de baixo. Por exemplo, a posição inicial 4x4 é
+//
+//     0 ----/-10-/-01-/----
+//
+// *le_posicao()* devolve o tabuleiro (ou NULL se a descrição for
+// inválida) e preenche o jogador da vez.
+string **le_posicao(const string &descricao, char *jogador);
+string escreve_posicao(char jogador, string **tabuleiro);
+
+#endif /* _REVERSI_H_ */
@@ -437,6 +437,30 @@ def mostra(jogador, jogada, qtd_jogadas, tabuleiro):
     # Descomente essa linha para mostrar também o tabuleiro
     # print s
 
+### Motor em C++
+
+# Se o módulo *_reversi* estiver compilado (veja reversimodule.cpp e
+# setup.py), *planeja()* e *pos_jogaveis()* passam a usar o motor em
+# C++, que aceita este mesmo tabuleiro de listas e devolve os mesmos
+# resultados (inclusive no desempate entre jogadas de mesmo ganho).
+try:
+    import _reversi
+except ImportError:
+    _reversi = None
+
+if _reversi is not None:
+    def planeja(jogador, tabuleiro, nivel):
+        """
+        Planeja a jogada com o motor em C++.
+        """
+        return _reversi.planeja(jogador, tabuleiro, nivel)
+
+    def pos_jogaveis(jogador, tabuleiro):
+        """
+        Retorna as posições 'jogáveis', calculadas pelo motor em C++.
+        """
+        return _reversi.pos_jogaveis(jogador, tabuleiro)
+
 if __name__ == "__main__":
     # Lemos o arquivo de configuração
     conf = open('reversi.conf')
@@ -0,0 +1,742 @@
+//// Módulo Python do motor Reversi (em C++) //////////////////////////////////
+
+// O *reversi.py* é bem mais lento que o motor em C++ (veja o README),
+// principalmente por copiar o tabuleiro inteiro a cada jogada avaliada
+// pelo *minimax()*. Este módulo, *_reversi*, expõe ao Python a geração
+// de jogadas, a execução e o desfazer de jogadas, a avaliação e a
+// busca do motor em C++. Para compilar:
+//
+//     $ python setup.py build_ext --inplace
+//
+// Quando o módulo está disponível, o *reversi.py* passa a usá-lo no
+// lugar das suas próprias *planeja()* e *pos_jogaveis()*.
+//
+// Os tabuleiros podem ser passados de duas formas:
+//
+// * qualquer objeto com o protocolo de *buffer* (bytearray, bytes,
+//   memoryview, um array do numpy de uint8...) com (n+2)*(n+2)
+//   caracteres, linha por linha e com as bordas, exatamente como no
+//   motor (veja *novo_tabuleiro()* abaixo). O módulo o lê sem criar
+//   objetos Python, por meio de uma cópia por chamada (veja abaixo), e
+//   *executa()* e *desfaz()* escrevem de volta só as casas mudadas;
+// * a lista de listas de caracteres do *reversi.py* (ou uma lista de
+//   strings, só para leitura), convertida casa a casa.
+//
+// O motor trabalha sobre um *string ***, então o tabuleiro é copiado
+// uma vez por chamada para um tabuleiro de trabalho da *thread* (sem
+// alocar, se o tamanho não mudou). Durante a busca o GIL é liberado:
+// como todo o estado da busca é por *thread* (arena, contadores,
+// controle), várias *threads* Python podem buscar em paralelo.
+//
+// Os jogadores são '0' e '1' (ou 0 e 1) e as posições são tuplas
+// (linha, coluna) nas coordenadas do tabuleiro com bordas, como em
+// *reversi.py*.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <cstring>
+
+#include "reversi.h"
+#include "lote.h"
+#include "variacoes.h"
+
+#if PY_MAJOR_VERSION >= 3
+#define caractere_py(c) PyUnicode_FromStringAndSize(&(c), 1)
+#define inteiro_py PyLong_FromLong
+#else
+#define caractere_py(c) PyString_FromStringAndSize(&(c), 1)
+#define inteiro_py PyInt_FromLong
+#endif
+
+//// Tabuleiro de trabalho ////////////////////////////////////////////////////
+
+// Tabuleiro de trabalho da *thread*, reaproveitado enquanto o tamanho
+// não muda.
+class TabuleiroThread {
+
+  string **_tabuleiro;
+
+public:
+
+  TabuleiroThread()
+    : _tabuleiro(NULL)
+  {
+  }
+
+  ~TabuleiroThread() {
+    if (_tabuleiro != NULL) {
+      libera_tabuleiro(_tabuleiro);
+    }
+  }
+
+  // Tabuleiro com *m* casas de lado, bordas incluídas.
+  string **pega(int m) {
+    if (_tabuleiro != NULL && (int) (*_tabuleiro[0]).size() == m) {
+      return _tabuleiro;
+    }
+    if (_tabuleiro != NULL) {
+      libera_tabuleiro(_tabuleiro);
+    }
+    _tabuleiro = novo_tabuleiro(m - 2);
+    return _tabuleiro;
+  }
+
+};
+
+static thread_local TabuleiroThread trabalho;
+
+// Lê um caractere de uma string de tamanho 1 (ou de um inteiro 0/1,
+// para os jogadores).
+static bool le_caractere(PyObject *obj, char *c) {
+  const char *s;
+  Py_ssize_t n;
+  long v;
+
+  if (PyBytes_Check(obj)) {
+    s = PyBytes_AS_STRING(obj);
+    n = PyBytes_GET_SIZE(obj);
+#if PY_MAJOR_VERSION >= 3
+  } else if (PyUnicode_Check(obj)) {
+    s = PyUnicode_AsUTF8AndSize(obj, &n);
+    if (s == NULL) {
+      return false;
+    }
+#endif
+  } else if (PyNumber_Check(obj)) {
+    v = PyLong_AsLong(obj);
+    if (v == -1 && PyErr_Occurred()) {
+      return false;
+    }
+    *c = '0' + v;
+    return true;
+  } else {
+    PyErr_SetString(PyExc_TypeError, "esperado um caractere");
+    return false;
+  }
+  if (n != 1) {
+    PyErr_SetString(PyExc_ValueError, "esperado um único caractere");
+    return false;
+  }
+  *c = s[0];
+  return true;
+}
+
+static bool le_jogador(PyObject *obj, char *jogador) {
+  if (!le_caractere(obj, jogador)) {
+    return false;
+  }
+  if (*jogador != PRETO && *jogador != BRANCO) {
+    PyErr_SetString(PyExc_ValueError, "jogador deve ser '0' ou '1'");
+    return false;
+  }
+  return true;
+}
+
+// Confere se o tabuleiro de trabalho está completo: bordas em volta e
+// apenas peças ou casas vazias dentro. O motor depende das bordas para
+// não sair do tabuleiro.
+static bool confere(string **tabuleiro) {
+  int m = (*tabuleiro[0]).size();
+  int i, j;
+  char c;
+
+  for (i=0; i<m; i++) {
+    for (j=0; j<m; j++) {
+      c = (*tabuleiro[i])[j];
+      if (i == 0 || j == 0 || i == m-1 || j == m-1 ? c != BORDA :
+          c != VAZIO && c != PRETO && c != BRANCO) {
+        PyErr_Format(PyExc_ValueError, "casa (%d, %d) inválida: '%c'",
+                     i, j, c);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Copia o tabuleiro do Python para o tabuleiro de trabalho.
+static string **le_tabuleiro(PyObject *obj) {
+  string **tabuleiro;
+  Py_buffer view;
+  PyObject *linhas, *linha, *casas;
+  Py_ssize_t m, i, j;
+  const char *dados;
+  char c;
+
+  // Objeto com *buffer*: copiamos linha por linha.
+  if (!PyList_Check(obj) && !PyTuple_Check(obj) &&
+      PyObject_CheckBuffer(obj)) {
+    if (PyObject_GetBuffer(obj, &view, PyBUF_SIMPLE) < 0) {
+      return NULL;
+    }
+    for (m=0; m*m < view.len; m++) {
+    }
+    if (m*m != view.len || m < 6) {
+      PyBuffer_Release(&view);
+      PyErr_SetString(PyExc_ValueError,
+                      "o buffer deve ter (n+2)*(n+2) caracteres, n >= 4");
+      return NULL;
+    }
+    tabuleiro = trabalho.pega(m);
+    dados = static_cast<const char *>(view.buf);
+    for (i=0; i<m; i++) {
+      (*tabuleiro[i]).replace(0, m, dados + i*m, m);
+    }
+    PyBuffer_Release(&view);
+    return confere(tabuleiro) ? tabuleiro : NULL;
+  }
+
+  // Sequência de linhas.
+  linhas = PySequence_Fast(obj, "o tabuleiro deve ser um buffer ou uma "
+                           "sequência de linhas");
+  if (linhas == NULL) {
+    return NULL;
+  }
+  m = PySequence_Fast_GET_SIZE(linhas);
+  if (m < 6) {
+    Py_DECREF(linhas);
+    PyErr_SetString(PyExc_ValueError, "tabuleiro muito pequeno");
+    return NULL;
+  }
+  tabuleiro = trabalho.pega(m);
+  for (i=0; i<m; i++) {
+    linha = PySequence_Fast_GET_ITEM(linhas, i);
+    if (PyBytes_Check(linha) || PyUnicode_Check(linha)) {
+      casas = PySequence_List(linha);
+    } else {
+      casas = PySequence_Fast(linha, "cada linha deve ser uma sequência");
+    }
+    if (casas == NULL) {
+      Py_DECREF(linhas);
+      return NULL;
+    }
+    if (PySequence_Fast_GET_SIZE(casas) != m) {
+      Py_DECREF(casas);
+      Py_DECREF(linhas);
+      PyErr_SetString(PyExc_ValueError, "o tabuleiro deve ser quadrado");
+      return NULL;
+    }
+    for (j=0; j<m; j++) {
+      if (!le_caractere(PySequence_Fast_GET_ITEM(casas, j), &c)) {
+        Py_DECREF(casas);
+        Py_DECREF(linhas);
+        return NULL;
+      }
+      (*tabuleiro[i])[j] = c;
+    }
+    Py_DECREF(casas);
+  }
+  Py_DECREF(linhas);
+  return confere(tabuleiro) ? tabuleiro : NULL;
+}
+
+// Escreve de volta no objeto Python as casas alteradas por uma jogada
+// (a casa jogada e as peças invertidas). O objeto deve ser um *buffer*
+// gravável ou uma lista de listas.
+static bool escreve_jogada(PyObject *obj, string **tabuleiro,
+                           const Desfazer &desfazer) {
+  int m = (*tabuleiro[0]).size();
+  Py_buffer view;
+  PyObject *linha;
+  char *dados = NULL;
+  bool lista, ok = true;
+  int i, k;
+
+  lista = PyList_Check(obj) || PyTuple_Check(obj) ||
+          !PyObject_CheckBuffer(obj);
+  if (!lista) {
+    if (PyObject_GetBuffer(obj, &view, PyBUF_WRITABLE) < 0) {
+      return false;
+    }
+    dados = static_cast<char *>(view.buf);
+  } else {
+    // Conferimos tudo antes de mudar qualquer casa.
+    ok = PyList_Check(obj) && PyList_GET_SIZE(obj) == m;
+    for (i=0; ok && i<m; i++) {
+      linha = PyList_GET_ITEM(obj, i);
+      ok = PyList_Check(linha) && PyList_GET_SIZE(linha) == m;
+    }
+    if (!ok) {
+      PyErr_SetString(PyExc_TypeError, "o tabuleiro deve ser um buffer "
+                      "gravável ou uma lista de listas");
+      return false;
+    }
+  }
+
+  auto copia = [&](int l, int c) {
+    PyObject *casa;
+
+    if (!lista) {
+      dados[l*m + c] = (*tabuleiro[l])[c];
+      return;
+    }
+    casa = caractere_py((*tabuleiro[l])[c]);
+    if (casa == NULL) {
+      ok = false;
+      return;
+    }
+    PyList_SetItem(PyList_GET_ITEM(obj, l), c, casa);
+  };
+
+  copia(desfazer.pos.linha, desfazer.pos.coluna);
+  for (i=0; i<8; i++) {
+    for (k=1; k<=desfazer.invertidas[i]; k++) {
+      copia(desfazer.pos.linha + k * DIRS[i][0],
+            desfazer.pos.coluna + k * DIRS[i][1]);
+    }
+  }
+
+  if (!lista) {
+    PyBuffer_Release(&view);
+  }
+  return ok;
+}
+
+// Posição (linha, coluna) do Python.
+static bool le_posicao_py(PyObject *obj, string **tabuleiro, Posicao *pos) {
+  int m = (*tabuleiro[0]).size();
+  PyObject *tupla = PySequence_Tuple(obj);
+  bool ok;
+
+  if (tupla == NULL) {
+    return false;
+  }
+  ok = PyArg_ParseTuple(tupla, "ii;a posição deve ser (linha, coluna)",
+                        &pos->linha, &pos->coluna);
+  Py_DECREF(tupla);
+  if (!ok) {
+    return false;
+  }
+  if (pos->linha < 1 || pos->linha > m-2 ||
+      pos->coluna < 1 || pos->coluna > m-2) {
+    PyErr_SetString(PyExc_ValueError, "posição fora do tabuleiro");
+    return false;
+  }
+  return true;
+}
+
+static PyObject *posicao_py(const Posicao &pos) {
+  return Py_BuildValue("(ii)", pos.linha, pos.coluna);
+}
+
+//// Funções do módulo ////////////////////////////////////////////////////////
+
+PyDoc_STRVAR(doc_novo_tabuleiro,
+"novo_tabuleiro(tam) -> bytearray\n\n"
+"Tabuleiro inicial de tam x tam casas, com as bordas, como buffer.");
+
+static PyObject *py_novo_tabuleiro(PyObject *, PyObject *args) {
+  string **tabuleiro;
+  PyObject *resultado;
+  int tam, i;
+
+  if (!PyArg_ParseTuple(args, "i:novo_tabuleiro", &tam)) {
+    return NULL;
+  }
+  if (tam < 4 || tam % 2 != 0) {
+    PyErr_SetString(PyExc_ValueError, "tamanho de tabuleiro inválido");
+    return NULL;
+  }
+  tabuleiro = novo_tabuleiro(tam);
+  resultado = PyByteArray_FromStringAndSize(NULL, (tam+2) * (tam+2));
+  if (resultado != NULL) {
+    for (i=0; i<tam+2; i++) {
+      memcpy(PyByteArray_AS_STRING(resultado) + i*(tam+2),
+             (*tabuleiro[i]).data(), tam+2);
+    }
+  }
+  libera_tabuleiro(tabuleiro);
+  return resultado;
+}
+
+PyDoc_STRVAR(doc_pos_jogaveis,
+"pos_jogaveis(jogador, tabuleiro) -> [(linha, coluna), ...]\n\n"
+"Posições onde o jogador pode jogar, em ordem de linha e coluna.");
+
+static PyObject *py_pos_jogaveis(PyObject *, PyObject *args) {
+  PyObject *obj_jogador, *obj_tabuleiro, *lista, *pos;
+  string **tabuleiro;
+  Posicao *jogaveis;
+  char jogador;
+  int m, qtd, i;
+
+  if (!PyArg_ParseTuple(args, "OO:pos_jogaveis", &obj_jogador,
+                        &obj_tabuleiro) ||
+      !le_jogador(obj_jogador, &jogador) ||
+      (tabuleiro = le_tabuleiro(obj_tabuleiro)) == NULL) {
+    return NULL;
+  }
+  m = (*tabuleiro[0]).size();
+  arena_busca.reinicia();
+  jogaveis = arena_busca.aloca<Posicao>((m-2) * (m-2));
+  qtd = pos_jogaveis(jogador, tabuleiro, jogaveis);
+
+  lista = PyList_New(qtd);
+  for (i=0; lista != NULL && i<qtd; i++) {
+    pos = posicao_py(jogaveis[i]);
+    if (pos == NULL) {
+      Py_CLEAR(lista);
+      break;
+    }
+    PyList_SET_ITEM(lista, i, pos);
+  }
+  arena_busca.reinicia();
+  return lista;
+}
+
+PyDoc_STRVAR(doc_pontos,
+"pontos(jogador, tabuleiro) -> int\n\n"
+"Peças do jogador menos as do oponente.");
+
+static PyObject *py_pontos(PyObject *, PyObject *args) {
+  PyObject *obj_jogador, *obj_tabuleiro;
+  string **tabuleiro;
+  char jogador;
+
+  if (!PyArg_ParseTuple(args, "OO:pontos", &obj_jogador, &obj_tabuleiro) ||
+      !le_jogador(obj_jogador, &jogador) ||
+      (tabuleiro = le_tabuleiro(obj_tabuleiro)) == NULL) {
+    return NULL;
+  }
+  return inteiro_py(pontos(jogador, tabuleiro));
+}
+
+PyDoc_STRVAR(doc_executa,
+"executa(pos, jogador, tabuleiro) -> desfazer\n\n"
+"Executa a jogada no próprio tabuleiro e retorna o registro para\n"
+"desfazê-la com desfaz().");
+
+static PyObject *py_executa(PyObject *, PyObject *args) {
+  PyObject *obj_pos, *obj_jogador, *obj_tabuleiro;
+  string **tabuleiro;
+  Desfazer desfazer;
+  Posicao pos;
+  char jogador;
+  int *n;
+
+  if (!PyArg_ParseTuple(args, "OOO:executa", &obj_pos, &obj_jogador,
+                        &obj_tabuleiro) ||
+      !le_jogador(obj_jogador, &jogador) ||
+      (tabuleiro = le_tabuleiro(obj_tabuleiro)) == NULL ||
+      !le_posicao_py(obj_pos, tabuleiro, &pos)) {
+    return NULL;
+  }
+  if (!pos_valida(&pos, jogador, tabuleiro)) {
+    PyErr_SetString(PyExc_ValueError, "jogada não permitida");
+    return NULL;
+  }
+  executa(&pos, jogador, tabuleiro, &desfazer);
+  if (!escreve_jogada(obj_tabuleiro, tabuleiro, desfazer)) {
+    return NULL;
+  }
+  n = desfazer.invertidas;
+  return Py_BuildValue("((ii)(iiiiiiii))", pos.linha, pos.coluna,
+                       n[0], n[1], n[2], n[3], n[4], n[5], n[6], n[7]);
+}
+
+PyDoc_STRVAR(doc_desfaz,
+"desfaz(desfazer, tabuleiro)\n\n"
+"Desfaz a jogada registrada por executa().");
+
+static PyObject *py_desfaz(PyObject *, PyObject *args) {
+  PyObject *obj_tabuleiro;
+  string **tabuleiro;
+  Desfazer desfazer;
+  int *n = desfazer.invertidas;
+  int m, i, k;
+
+  if (!PyArg_ParseTuple(args, "((ii)(iiiiiiii))O:desfaz",
+                        &desfazer.pos.linha, &desfazer.pos.coluna,
+                        &n[0], &n[1], &n[2], &n[3], &n[4], &n[5], &n[6],
+                        &n[7], &obj_tabuleiro) ||
+      (tabuleiro = le_tabuleiro(obj_tabuleiro)) == NULL) {
+    return NULL;
+  }
+
+  // O registro precisa corresponder ao tabuleiro: a casa jogada tem
+  // uma peça e cada invertida é dela.
+  m = (*tabuleiro[0]).size();
+  if (desfazer.pos.linha < 1 || desfazer.pos.linha > m-2 ||
+      desfazer.pos.coluna < 1 || desfazer.pos.coluna > m-2 ||
+      (*tabuleiro[desfazer.pos.linha])[desfazer.pos.coluna] == VAZIO) {
+    PyErr_SetString(PyExc_ValueError, "registro não corresponde ao "
+                    "tabuleiro");
+    return NULL;
+  }
+  for (i=0; i<8; i++) {
+    for (k=1; k<=n[i]; k++) {
+      if ((*tabuleiro[desfazer.pos.linha + k * DIRS[i][0]])
+          [desfazer.pos.coluna + k * DIRS[i][1]] !=
+          (*tabuleiro[desfazer.pos.linha])[desfazer.pos.coluna]) {
+        PyErr_SetString(PyExc_ValueError, "registro não corresponde ao "
+                        "tabuleiro");
+        return NULL;
+      }
+    }
+  }
+
+  desfaz(&desfazer, tabuleiro);
+  if (!escreve_jogada(obj_tabuleiro, tabuleiro, desfazer)) {
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(doc_planeja,
+"planeja(jogador, tabuleiro, nivel) -> (ganho, (linha, coluna))\n\n"
+"Melhor jogada pelo minimax até o nível dado, como planeja() do\n"
+"reversi.py; (-1, -1) quando não há jogada. O GIL é liberado durante\n"
+"a busca.");
+
+static PyObject *py_planeja(PyObject *, PyObject *args) {
+  PyObject *obj_jogador, *obj_tabuleiro;
+  string **tabuleiro;
+  GanhoPos aux;
+  Posicao pos;
+  char jogador;
+  int nivel;
+
+  if (!PyArg_ParseTuple(args, "OOi:planeja", &obj_jogador, &obj_tabuleiro,
+                        &nivel) ||
+      !le_jogador(obj_jogador, &jogador) ||
+      (tabuleiro = le_tabuleiro(obj_tabuleiro)) == NULL) {
+    return NULL;
+  }
+  if (nivel < 1) {
+    PyErr_SetString(PyExc_ValueError, "o nível deve ser positivo");
+    return NULL;
+  }
+
+  Py_BEGIN_ALLOW_THREADS
+  arena_busca.reinicia();
+  aux = minimax(jogador, tabuleiro, nivel);
+  pos = *aux.pos;
+  arena_busca.reinicia();
+  Py_END_ALLOW_THREADS
+
+  return Py_BuildValue("(l(ii))", (long) aux.ganho, pos.linha, pos.coluna);
+}
+
+PyDoc_STRVAR(doc_aprofunda,
+"aprofunda(jogador, tabuleiro, nivel_max, tempo_ms=0, nos_max=0)\n"
+"    -> (ganho, (linha, coluna), nivel, nos)\n\n"
+"Aprofundamento iterativo até nivel_max, até o prazo (em ms, 0 sem\n"
+"prazo) ou até nos_max nós (0 sem limite; sem prazo, o resultado é\n"
+"determinístico). O GIL é liberado durante a busca.");
+
+static PyObject *py_aprofunda(PyObject *, PyObject *args) {
+  PyObject *obj_jogador, *obj_tabuleiro;
+  string **tabuleiro;
+  Controle controle;
+  Resultado r;
+  char jogador;
+  int nivel_max;
+  long tempo_ms = 0;
+  unsigned long long nos_max = 0;
+
+  if (!PyArg_ParseTuple(args, "OOi|lK:aprofunda", &obj_jogador,
+                        &obj_tabuleiro, &nivel_max, &tempo_ms, &nos_max) ||
+      !le_jogador(obj_jogador, &jogador) ||
+      (tabuleiro = le_tabuleiro(obj_tabuleiro)) == NULL) {
+    return NULL;
+  }
+  if (nivel_max < 1) {
+    PyErr_SetString(PyExc_ValueError, "o nível deve ser positivo");
+    return NULL;
+  }
+
+  Py_BEGIN_ALLOW_THREADS
+  controle.parar = false;
+  controle.prazo = Relogio::now() + chrono::milliseconds(tempo_ms);
+  controle.com_prazo = tempo_ms > 0;
+  controle.nos_max = nos_max;
+  r = aprofunda(jogador, tabuleiro, nivel_max, &controle, nullptr);
+  Py_END_ALLOW_THREADS
+
+  return Py_BuildValue("(l(ii)iK)", (long) r.ganho, r.pos.linha,
+                       r.pos.coluna, r.nivel, r.nos);
+}
+
+PyDoc_STRVAR(doc_aprofunda_lote,
+"aprofunda_lote(pedidos, threads=0, deterministica=False)\n"
+"    -> [(ganho, (linha, coluna), nivel, nos), ...]\n\n"
+"Busca em lote (veja lote.h): cada pedido é uma tupla (jogador,\n"
+"tabuleiro, nivel_max[, tempo_ms[, nos_max]]), como em aprofunda().\n"
+"As buscas são repartidas entre as threads (0: uma por núcleo), com o\n"
+"GIL liberado, e os resultados voltam na ordem dos pedidos. Com\n"
+"deterministica, os resultados se repetem em toda execução com o\n"
+"mesmo número de threads.");
+
+static PyObject *py_aprofunda_lote(PyObject *, PyObject *args) {
+  PyObject *obj_pedidos, *itens, *obj_jogador, *obj_tabuleiro, *lista;
+  vector<PedidoLote> pedidos;
+  vector<Resultado> resultados;
+  OpcoesLote opcoes;
+  string **tabuleiro;
+  Py_ssize_t i, n;
+  bool ok = true;
+
+  int deterministica = 0;
+
+  if (!PyArg_ParseTuple(args, "O|ii:aprofunda_lote", &obj_pedidos,
+                        &opcoes.threads, &deterministica) ||
+      (itens = PySequence_Fast(obj_pedidos, "os pedidos devem ser uma "
+                               "sequência")) == NULL) {
+    return NULL;
+  }
+  opcoes.deterministica = deterministica;
+  n = PySequence_Fast_GET_SIZE(itens);
+  for (i=0; ok && i<n; i++) {
+    PedidoLote p;
+
+    p.tempo_ms = 0;
+    p.nos_max = 0;
+    ok = PyArg_ParseTuple(PySequence_Fast_GET_ITEM(itens, i),
+                          "OOi|lK:aprofunda_lote", &obj_jogador,
+                          &obj_tabuleiro, &p.nivel_max, &p.tempo_ms,
+                          &p.nos_max) &&
+         le_jogador(obj_jogador, &p.jogador) &&
+         (tabuleiro = le_tabuleiro(obj_tabuleiro)) != NULL;
+    if (ok && p.nivel_max < 1) {
+      PyErr_SetString(PyExc_ValueError, "o nível deve ser positivo");
+      ok = false;
+    }
+    if (ok) {
+      p.tabuleiro = copia_tabuleiro(tabuleiro);
+      pedidos.push_back(p);
+    }
+  }
+  Py_DECREF(itens);
+
+  if (ok) {
+    Py_BEGIN_ALLOW_THREADS
+    resultados = busca_lote(pedidos, opcoes, NULL);
+    Py_END_ALLOW_THREADS
+  }
+  for (i=0; i<(Py_ssize_t) pedidos.size(); i++) {
+    libera_tabuleiro(pedidos[i].tabuleiro);
+  }
+  if (!ok) {
+    return NULL;
+  }
+
+  lista = PyList_New(resultados.size());
+  for (i=0; lista != NULL && i<(Py_ssize_t) resultados.size(); i++) {
+    const Resultado &r = resultados[i];
+    PyObject *item = Py_BuildValue("(l(ii)iK)", (long) r.ganho, r.pos.linha,
+                                   r.pos.coluna, r.nivel, r.nos);
+    if (item == NULL) {
+      Py_DECREF(lista);
+      return NULL;
+    }
+    PyList_SET_ITEM(lista, i, item);
+  }
+  return lista;
+}
+
+PyDoc_STRVAR(doc_variacoes,
+"variacoes(jogador, tabuleiro, nivel_max, linhas=0, threads=1,\n"
+"          tempo_ms=0) -> ([(ganho, (linha, coluna), pv), ...], nivel, nos)\n\n"
+"As linhas melhores jogadas (0: todas), da melhor para a pior, com o\n"
+"ganho exato e a variação principal de cada uma (veja variacoes.h);\n"
+"(-1, -1) na variação é uma passada de vez. As jogadas da raiz são\n"
+"repartidas entre as threads (0: uma por núcleo). O GIL é liberado\n"
+"durante a busca.");
+
+static PyObject *py_variacoes(PyObject *, PyObject *args) {
+  PyObject *obj_jogador, *obj_tabuleiro, *lista, *pv, *item;
+  string **tabuleiro;
+  Controle controle;
+  ResultadoVariacoes r;
+  char jogador;
+  int nivel_max, linhas = 0, threads = 1;
+  long tempo_ms = 0;
+  size_t i, j;
+
+  if (!PyArg_ParseTuple(args, "OOi|iil:variacoes", &obj_jogador,
+                        &obj_tabuleiro, &nivel_max, &linhas, &threads,
+                        &tempo_ms) ||
+      !le_jogador(obj_jogador, &jogador) ||
+      (tabuleiro = le_tabuleiro(obj_tabuleiro)) == NULL) {
+    return NULL;
+  }
+  if (nivel_max < 1) {
+    PyErr_SetString(PyExc_ValueError, "o nível deve ser positivo");
+    return NULL;
+  }
+  if (linhas < 0 || threads < 0) {
+    PyErr_SetString(PyExc_ValueError, "linhas e threads não podem ser "
+                    "negativos");
+    return NULL;
+  }
+
+  Py_BEGIN_ALLOW_THREADS
+  controle.parar = false;
+  controle.prazo = Relogio::now() + chrono::milliseconds(tempo_ms);
+  controle.com_prazo = tempo_ms > 0;
+  controle.nos_max = 0;
+  r = busca_variacoes(jogador, tabuleiro, nivel_max, linhas, threads,
+                      &controle, nullptr);
+  Py_END_ALLOW_THREADS
+
+  lista = PyList_New(r.variacoes.size());
+  for (i=0; lista != NULL && i<r.variacoes.size(); i++) {
+    const Variacao &v = r.variacoes[i];
+
+    pv = PyList_New(v.jogadas.size());
+    for (j=0; pv != NULL && j<v.jogadas.size(); j++) {
+      if ((item = posicao_py(v.jogadas[j])) == NULL) {
+        Py_CLEAR(pv);
+      } else {
+        PyList_SET_ITEM(pv, j, item);
+      }
+    }
+    item = pv == NULL ? NULL :
+      Py_BuildValue("(l(ii)N)", (long) v.ganho, v.pos.linha, v.pos.coluna,
+                    pv);
+    if (item == NULL) {
+      Py_DECREF(lista);
+      return NULL;
+    }
+    PyList_SET_ITEM(lista, i, item);
+  }
+  if (lista == NULL) {
+    return NULL;
+  }
+  return Py_BuildValue("(NiK)", lista, r.nivel, r.nos);
+}
+
+static PyMethodDef metodos[] = {
+  {"novo_tabuleiro", py_novo_tabuleiro, METH_VARARGS, doc_novo_tabuleiro},
+  {"pos_jogaveis", py_pos_jogaveis, METH_VARARGS, doc_pos_jogaveis},
+  {"pontos", py_pontos, METH_VARARGS, doc_pontos},
+  {"executa", py_executa, METH_VARARGS, doc_executa},
+  {"desfaz", py_desfaz, METH_VARARGS, doc_desfaz},
+  {"planeja", py_planeja, METH_VARARGS, doc_planeja},
+  {"aprofunda", py_aprofunda, METH_VARARGS, doc_aprofunda},
+  {"aprofunda_lote", py_aprofunda_lote, METH_VARARGS, doc_aprofunda_lote},
+  {"variacoes", py_variacoes, METH_VARARGS, doc_variacoes},
+  {NULL, NULL, 0, NULL}
+};
+
+PyDoc_STRVAR(doc_modulo, "Motor Reversi em C++ (veja reversimodule.cpp).");
+
+#if PY_MAJOR_VERSION >= 3
+
+static struct PyModuleDef modulo = {
+  PyModuleDef_HEAD_INIT, "_reversi", doc_modulo, -1, metodos,
+  NULL, NULL, NULL, NULL
+};
+
+PyMODINIT_FUNC PyInit__reversi(void) {
+  return PyModule_Create(&modulo);
+}
+
+#else
+
+PyMODINIT_FUNC init_reversi(void) {
+  Py_InitModule3("_reversi", metodos, doc_modulo);
+}
+
+#endif
@@ -0,0 +1,576 @@
+//// Modo servidor ////////////////////////////////////////////////////////////
+
+// Implementação do protocolo descrito em servidor.h.
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cerrno>
+#include <cstring>
+#include <csignal>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "reversi.h"
+#include "servidor.h"
+#include "variacoes.h"
+
+//// Métricas de latência /////////////////////////////////////////////////////
+
+// Latências (em ms) dos pedidos atendidos por todas as sessões. Para
+// os percentis guardamos apenas as últimas *JANELA* medidas.
+class Metricas {
+
+  static const size_t JANELA = 4096;
+
+  mutex _mutex;
+  unsigned long long _pedidos;
+  double _soma, _maior;
+  vector<double> _recentes;
+  size_t _proxima;
+
+public:
+
+  Metricas()
+    : _pedidos(0), _soma(0), _maior(0), _recentes(JANELA), _proxima(0)
+  {
+  }
+
+  void registra(double ms) {
+    lock_guard<mutex> trava(_mutex);
+    _pedidos++;
+    _soma += ms;
+    _maior = max(_maior, ms);
+    _recentes[_proxima] = ms;
+    _proxima = (_proxima + 1) % JANELA;
+  }
+
+  string relatorio() {
+    lock_guard<mutex> trava(_mutex);
+    size_t n = min((size_t) _pedidos, JANELA);
+    vector<double> v(_recentes.begin(), _recentes.begin() + n);
+    ostringstream s;
+
+    sort(v.begin(), v.end());
+    s << fixed << setprecision(3) << "stats requests " << _pedidos
+      << " mean " << (_pedidos > 0 ? _soma / _pedidos : 0)
+      << " p50 " << (n > 0 ? v[n / 2] : 0)
+      << " p90 " << (n > 0 ? v[n * 9 / 10] : 0)
+      << " p99 " << (n > 0 ? v[n * 99 / 100] : 0)
+      << " max " << _maior;
+    return s.str();
+  }
+
+};
+
+static Metricas metricas;
+
+//// Sessão ///////////////////////////////////////////////////////////////////
+
+// Um pedido de busca, com o instante em que foi recebido (para medir a
+// latência). Os pedidos vêm de um *pool* da sessão. Num pedido de
+// ponderação, o prazo e a latência contam a partir do *ponderhit*.
+struct Requisicao {
+  int nivel_max;
+  long tempo_ms; // 0 = sem prazo
+  unsigned long long nos_max; // 0 = sem limite de nós
+  int linhas;                 // multi-PV: -1 = não, 0 = todas as jogadas
+  int threads;                // multi-PV: threads da raiz
+  bool ponder;
+  Relogio::time_point recebida;
+};
+
+class Sessao {
+
+  int _entrada, _saida;
+  string _buffer;         // dados lidos ainda não consumidos
+
+  mutex _mutex;           // protege o estado abaixo
+  mutex _mutex_saida;     // serializa as linhas escritas
+  condition_variable _cv;
+  Pool<Requisicao> _pool;
+  Requisicao *_pendente;  // pedido aguardando a *thread* de busca
+  Requisicao *_atual;     // pedido sendo buscado
+  bool _buscando;
+  bool _ponderando;       // busca de ponderação ainda sem *ponderhit*
+  bool _encerrar;
+  Controle _controle;
+  TabelaTransposicao _tabela;
+  string **_tabuleiro;
+  char _jogador;
+  thread _trabalhador;
+
+  void escreve(const string &linha);
+  bool le_linha(string *linha);
+  void trabalha();
+  string busca(Requisicao *req);
+  Resultado busca_multipv(Requisicao *req);
+  void comando(const string &linha);
+  void go(istringstream &args);
+  void ponderhit();
+
+public:
+
+  Sessao(int entrada, int saida);
+  ~Sessao();
+
+  // Lê e atende comandos até *quit* ou fim da entrada.
+  void atende();
+
+};
+
+Sessao::Sessao(int entrada, int saida)
+  : _entrada(entrada), _saida(saida), _pendente(NULL), _atual(NULL),
+    _buscando(false), _ponderando(false), _encerrar(false),
+    _tabela(TAM_TABELA_PADRAO), _tabuleiro(novo_tabuleiro(8)),
+    _jogador(PRETO)
+{
+  _controle.parar = false;
+  _controle.com_prazo = false;
+  _trabalhador = thread(&Sessao::trabalha, this);
+}
+
+Sessao::~Sessao() {
+  {
+    lock_guard<mutex> trava(_mutex);
+    _encerrar = true;
+    _controle.parar = true;
+  }
+  _cv.notify_all();
+  _trabalhador.join();
+  libera_tabuleiro(_tabuleiro);
+}
+
+// Escreve uma linha inteira na saída.
+void Sessao::escreve(const string &linha) {
+  lock_guard<mutex> trava(_mutex_saida);
+  string s = linha + "\n";
+  size_t escrito = 0;
+  ssize_t n;
+
+  while (escrito < s.size()) {
+    n = write(_saida, s.data() + escrito, s.size() - escrito);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return;
+    }
+    escrito += n;
+  }
+}
+
+// Lê uma linha da entrada (sem o '\n'). Retorna *false* no fim da
+// entrada.
+bool Sessao::le_linha(string *linha) {
+  char dados[4096];
+  size_t fim;
+  ssize_t n;
+
+  while ((fim = _buffer.find('\n')) == string::npos) {
+    n = read(_entrada, dados, sizeof(dados));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      if (_buffer.empty()) {
+        return false;
+      }
+      fim = _buffer.size();
+      _buffer += '\n';
+      break;
+    }
+    _buffer.append(dados, n);
+  }
+  *linha = _buffer.substr(0, fim);
+  _buffer.erase(0, fim + 1);
+  if (!linha->empty() && (*linha)[linha->size() - 1] == '\r') {
+    linha->erase(linha->size() - 1);
+  }
+  return true;
+}
+
+// Laço da *thread* de busca: espera um pedido, busca e responde. A
+// tabela de transposição da sessão só é usada por esta *thread* e
+// sobrevive de um pedido para o outro.
+void Sessao::trabalha() {
+  Requisicao *req;
+  string resposta;
+
+  tabela_busca = &_tabela;
+  while (true) {
+    {
+      unique_lock<mutex> trava(_mutex);
+      while (_pendente == NULL && !_encerrar) {
+        _cv.wait(trava);
+      }
+      if (_encerrar) {
+        return;
+      }
+      req = _pendente;
+      _pendente = NULL;
+      _atual = req;
+
+      // O prazo conta a partir do recebimento do pedido; ao ponderar,
+      // só a partir do *ponderhit* (que pode chegar durante a busca).
+      _controle.prazo = req->recebida + chrono::milliseconds(req->tempo_ms);
+      _controle.com_prazo = !req->ponder && req->tempo_ms > 0;
+      _controle.nos_max = req->nos_max;
+    }
+
+    resposta = busca(req);
+
+    // A sessão fica livre antes de o cliente ver o *bestmove*: assim um
+    // *position* enviado logo em seguida nunca encontra a busca ainda
+    // em andamento.
+    {
+      lock_guard<mutex> trava(_mutex);
+      _pool.devolve(req);
+      _atual = NULL;
+      _buscando = false;
+      escreve(resposta);
+    }
+    _cv.notify_all();
+  }
+}
+
+// Descreve uma jogada nas coordenadas do arquivo de jogadas.
+static string jogada(const Posicao &pos, string **tabuleiro) {
+  int tam = (*tabuleiro[0]).size() - 2;
+  ostringstream s;
+
+  if (pos.linha == -1) {
+    return "pass";
+  }
+  s << tam - pos.linha << " " << pos.coluna - 1;
+  return s.str();
+}
+
+// Porcentagem das consultas à tabela, desde os contadores dados, que
+// encontraram a posição.
+static double acertos_tt(unsigned long long consultas,
+                         unsigned long long acertos) {
+  unsigned long long c = contadores_tt.consultas - consultas;
+
+  return c == 0 ? 0.0 : 100.0 * (contadores_tt.acertos - acertos) / c;
+}
+
+// Busca multi-PV (veja variacoes.h): a cada profundidade completada,
+// uma linha *info* por variação, da melhor para a pior.
+Resultado Sessao::busca_multipv(Requisicao *req) {
+  unsigned long long consultas = contadores_tt.consultas;
+  unsigned long long acertos = contadores_tt.acertos;
+  ResultadoVariacoes v;
+  Resultado r;
+
+  v = busca_variacoes(
+    _jogador, _tabuleiro, req->nivel_max, req->linhas, req->threads,
+    &_controle, [&](const ResultadoVariacoes &parcial) {
+      size_t i, j;
+
+      for (i=0; i<parcial.variacoes.size(); i++) {
+        const Variacao &linha = parcial.variacoes[i];
+        ostringstream info;
+
+        info << "info depth " << parcial.nivel << " multipv " << i + 1
+             << " score " << linha.ganho << " nodes " << parcial.nos
+             << " time " << fixed << setprecision(3)
+             << parcial.segundos * 1000 << " tthits " << setprecision(1)
+             << acertos_tt(consultas, acertos) << " pv";
+        for (j=0; j<linha.jogadas.size(); j++) {
+          info << " " << jogada(linha.jogadas[j], _tabuleiro);
+        }
+        escreve(info.str());
+      }
+    });
+  r.pos = v.variacoes[0].pos;
+  r.ganho = v.variacoes[0].ganho;
+  r.nivel = v.nivel;
+  r.nos = v.nos;
+  r.segundos = v.segundos;
+  return r;
+}
+
+// Executa a busca de um pedido, enviando uma linha *info* a cada
+// profundidade completada, e retorna a linha *bestmove*.
+string Sessao::busca(Requisicao *req) {
+  Resultado r;
+  ostringstream s;
+  double ms;
+  unsigned long long consultas = contadores_tt.consultas;
+  unsigned long long acertos = contadores_tt.acertos;
+
+  if (req->linhas >= 0) {
+    r = busca_multipv(req);
+  } else {
+    r = aprofunda(_jogador, _tabuleiro, req->nivel_max, &_controle,
+                  [&](const Resultado &parcial) {
+                    ostringstream info;
+                    info << "info depth " << parcial.nivel
+                         << " score " << parcial.ganho
+                         << " move " << jogada(parcial.pos, _tabuleiro)
+                         << " nodes " << parcial.nos
+                         << " time " << fixed << setprecision(3)
+                         << parcial.segundos * 1000
+                         << " tthits " << setprecision(1)
+                         << acertos_tt(consultas, acertos);
+                    escreve(info.str());
+                  });
+  }
+
+  // Uma ponderação que terminou antes do *ponderhit* guarda a resposta
+  // até ele chegar (ou até um *stop*).
+  {
+    unique_lock<mutex> trava(_mutex);
+    while (_ponderando && !_controle.parar.load()) {
+      _cv.wait(trava);
+    }
+    _ponderando = false;
+  }
+
+  ms = chrono::duration<double, milli>(Relogio::now() -
+                                       req->recebida).count();
+  metricas.registra(ms);
+  s << "bestmove " << jogada(r.pos, _tabuleiro) << " score " << r.ganho
+    << " depth " << r.nivel << " nodes " << r.nos
+    << " time " << fixed << setprecision(3) << ms;
+  return s.str();
+}
+
+// Trata os argumentos de *go* e entrega o pedido à *thread* de busca.
+void Sessao::go(istringstream &args) {
+  string nome;
+  int nivel_max = 0;
+  long tempo_ms = 0;
+  unsigned long long nos_max = 0;
+  int linhas = -1, threads = 1;
+  bool ponder = false;
+  int tam = (*_tabuleiro[0]).size() - 2;
+  Requisicao *req;
+
+  while (args >> nome) {
+    if (nome == "ponder") {
+      ponder = true;
+      continue;
+    }
+    if (nome == "depth") {
+      args >> nivel_max;
+    } else if (nome == "movetime") {
+      args >> tempo_ms;
+    } else if (nome == "nodes") {
+      args >> nos_max;
+    } else if (nome == "multipv") {
+      args >> linhas;
+    } else if (nome == "threads") {
+      args >> threads;
+    } else {
+      escreve("error unknown go argument: " + nome);
+      return;
+    }
+    if (args.fail() || (nome == "multipv" && linhas < 0) ||
+        (nome == "threads" && threads < 0)) {
+      escreve("error bad value for " + nome);
+      return;
+    }
+  }
+  if (nivel_max <= 0 && tempo_ms <= 0 && nos_max == 0) {
+    escreve("error go needs depth, movetime and/or nodes");
+    return;
+  }
+  // Só com prazo ou limite de nós, aprofundamos até o número de casas do tabuleiro.
+  if (nivel_max <= 0) {
+    nivel_max = tam * tam;
+  }
+
+  lock_guard<mutex> trava(_mutex);
+  if (_buscando) {
+    escreve("error search already running");
+    return;
+  }
+  req = _pool.pega();
+  req->nivel_max = nivel_max;
+  req->tempo_ms = tempo_ms;
+  req->nos_max = nos_max;
+  req->linhas = linhas;
+  req->threads = threads;
+  req->ponder = ponder;
+  req->recebida = Relogio::now();
+  _controle.parar = false;
+  _buscando = true;
+  _ponderando = ponder;
+  _pendente = req;
+  _cv.notify_all();
+}
+
+// O oponente jogou a jogada prevista: a ponderação vira uma busca
+// normal, sem recomeçar. O prazo (se houver) passa a contar agora.
+void Sessao::ponderhit() {
+  lock_guard<mutex> trava(_mutex);
+  Relogio::time_point agora = Relogio::now();
+
+  if (!_ponderando) {
+    escreve("error not pondering");
+    return;
+  }
+  _ponderando = false;
+  if (_pendente != NULL) {
+    _pendente->recebida = agora;
+    _pendente->ponder = false;
+  } else {
+    _atual->recebida = agora;
+    if (_atual->tempo_ms > 0) {
+      _controle.prazo = agora + chrono::milliseconds(_atual->tempo_ms);
+      _controle.com_prazo = true;
+    }
+  }
+  _cv.notify_all();
+}
+
+// Interpreta uma linha de comando.
+void Sessao::comando(const string &linha) {
+  istringstream args(linha);
+  string nome, resto;
+  string **novo;
+  char jogador;
+  int tam;
+
+  args >> nome;
+  if (nome.empty()) {
+    return;
+  }
+  if (nome == "go") {
+    go(args);
+    return;
+  }
+  if (nome == "stop") {
+    {
+      lock_guard<mutex> trava(_mutex);
+      _controle.parar = true;
+    }
+    _cv.notify_all();
+    return;
+  }
+  if (nome == "ponderhit") {
+    ponderhit();
+    return;
+  }
+  if (nome == "isready") {
+    escreve("readyok");
+    return;
+  }
+  if (nome == "stats") {
+    escreve(metricas.relatorio());
+    return;
+  }
+  if (nome != "position" && nome != "newgame") {
+    escreve("error unknown command: " + nome);
+    return;
+  }
+
+  // Os comandos abaixo trocam a posição, o que não pode acontecer
+  // durante uma busca.
+  lock_guard<mutex> trava(_mutex);
+  if (_buscando) {
+    escreve("error search running, send stop first");
+    return;
+  }
+  if (nome == "newgame") {
+    tam = 8;
+    args >> tam;
+    if (tam < 4 || tam % 2 != 0) {
+      escreve("error bad board size");
+      return;
+    }
+    novo = novo_tabuleiro(tam);
+    jogador = PRETO;
+    _tabela.limpa();
+  } else {
+    getline(args >> ws, resto);
+    novo = le_posicao(resto, &jogador);
+    if (novo == NULL) {
+      escreve("error bad position: " + resto);
+      return;
+    }
+  }
+  libera_tabuleiro(_tabuleiro);
+  _tabuleiro = novo;
+  _jogador = jogador;
+}
+
+void Sessao::atende() {
+  string linha;
+
+  while (le_linha(&linha)) {
+    if (linha == "quit") {
+      return;
+    }
+    comando(linha);
+  }
+
+  // Fim da entrada: esperamos a busca em andamento terminar, para que
+  // um lote de comandos vindo de um *pipe* receba todas as respostas.
+  unique_lock<mutex> trava(_mutex);
+  while (_buscando) {
+    _cv.wait(trava);
+  }
+}
+
+//// Pontos de entrada ////////////////////////////////////////////////////////
+
+void serve_sessao(int entrada, int saida) {
+  Sessao sessao(entrada, saida);
+
+  sessao.atende();
+}
+
+int serve_unix(const char *caminho) {
+  struct sockaddr_un endereco;
+  int servidor, cliente;
+
+  // Um cliente que fecha a conexão não deve derrubar o servidor.
+  signal(SIGPIPE, SIG_IGN);
+
+  memset(&endereco, 0, sizeof(endereco));
+  endereco.sun_family = AF_UNIX;
+  if (strlen(caminho) >= sizeof(endereco.sun_path)) {
+    cerr << "Caminho muito longo para o socket: " << caminho << endl;
+    return 1;
+  }
+  strcpy(endereco.sun_path, caminho);
+
+  servidor = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (servidor < 0) {
+    perror("socket");
+    return 1;
+  }
+  unlink(caminho);
+  if (bind(servidor, (struct sockaddr *) &endereco, sizeof(endereco)) < 0 ||
+      listen(servidor, 16) < 0) {
+    perror(caminho);
+    close(servidor);
+    return 1;
+  }
+
+  while (true) {
+    cliente = accept(servidor, NULL, NULL);
+    if (cliente < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("accept");
+      close(servidor);
+      return 1;
+    }
+    thread([cliente]() {
+        serve_sessao(cliente, cliente);
+        close(cliente);
+      }).detach();
+  }
+}
@@ -0,0 +1,80 @@
+#ifndef _SERVIDOR_H_
+#define _SERVIDOR_H_
+
+//// Modo servidor ////////////////////////////////////////////////////////////
+
+// Em vez de jogar uma partida e terminar, o motor pode ficar no ar
+// respondendo a pedidos de análise, com um protocolo de linhas de
+// texto:
+//
+//     position <jogador> <linhas>  define a posição (formato de
+//                                  *le_posicao()*, veja reversi.h)
+//     newgame [tam]                volta à posição inicial (padrão 8x8)
+//     go [depth N] [movetime ms] [nodes N]
+//                                  inicia a busca (aprofundamento
+//                                  iterativo até N, até o prazo e/ou
+//                                  até N nós; só com *depth* e/ou
+//                                  *nodes*, a resposta é
+//                                  determinística para a mesma tabela)
+//     go ... multipv K [threads T]
+//                                  análise: as K melhores jogadas (0:
+//                                  todas) com ganho exato e variação
+//                                  principal, com as jogadas da raiz
+//                                  repartidas entre T threads (padrão
+//                                  1, 0: uma por núcleo; veja
+//                                  variacoes.h)
+//     go ponder [depth N] [movetime ms] [nodes N]
+//                                  pondera: busca a posição dada (a da
+//                                  resposta prevista do oponente) sem
+//                                  prazo e sem responder até o
+//                                  *ponderhit* ou o *stop*
+//     ponderhit                    o oponente jogou a prevista: a
+//                                  ponderação continua como busca
+//                                  normal, com o prazo contando agora
+//     stop                         interrompe a busca em andamento
+//     isready                      responde "readyok"
+//     stats                        latências dos pedidos atendidos
+//     quit                         encerra a sessão
+//
+// Durante a busca o servidor responde com linhas
+//
+//     info depth <d> score <ganho> move <linha> <coluna> nodes <n> time <ms>
+//          tthits <pct>
+//
+// e, ao final, com
+//
+//     bestmove <linha> <coluna> score <ganho> depth <d> nodes <n> time <ms>
+//
+// (ou "bestmove pass ..." quando não há jogada), onde a jogada usa as
+// mesmas coordenadas do arquivo de jogadas e *time* é a latência do
+// pedido, do recebimento do *go* (ou do *ponderhit*) até a resposta.
+// *tthits* é a porcentagem das consultas à tabela de transposição, nesta
+// busca, que encontraram a posição. Com *multipv*, cada profundidade
+// completada dá uma linha por variação, da melhor para a pior, e o
+// *bestmove* é a primeira:
+//
+//     info depth <d> multipv <i> score <ganho> nodes <n> time <ms>
+//          tthits <pct> pv <linha> <coluna> <linha> <coluna> ...
+//
+// (na variação, "pass" é uma passada de vez).
+// Erros são informados com "error <mensagem>".
+//
+// Quando o oponente não joga a prevista, o cliente manda *stop*
+// (ignorando o *bestmove* da ponderação), a nova posição e um *go*.
+// A tabela de transposição da sessão continua com tudo o que a
+// ponderação completou; só *newgame* a esvazia.
+//
+// Cada sessão mantém uma *thread* de busca que vive enquanto a sessão
+// durar, de modo que a arena (e as demais tabelas da *thread*) fica
+// aquecida entre um pedido e outro. No modo *socket*, cada conexão é
+// uma sessão independente, atendida em paralelo com as outras.
+
+// Atende uma única sessão lendo comandos de *entrada* e escrevendo as
+// respostas em *saida* (por exemplo, 0 e 1 para stdin/stdout).
+void serve_sessao(int entrada, int saida);
+
+// Atende conexões em um *socket* Unix no caminho dado, uma sessão por
+// conexão. Só retorna em caso de erro.
+int serve_unix(const char *caminho);
+
+#endif /* _SERVIDOR_H_ */
@@ -0,0 +1,31 @@
+# -*- coding: utf-8 -*-
+
+# Compila o módulo *_reversi*, que expõe o motor em C++ ao Python (veja
+# reversimodule.cpp):
+#
+#     $ python setup.py build_ext --inplace
+
+try:
+    from setuptools import setup, Extension
+except ImportError:
+    from distutils.core import setup, Extension
+
+motor = Extension('_reversi',
+                  sources=['reversimodule.cpp', 'reversi.cpp',
+                           'transposicao.cpp', 'simetria.cpp',
+                           'probcut.cpp', 'estabilidade.cpp', 'lote.cpp',
+                           'afinidade.cpp', 'tabelas.cpp', 'registro.cpp',
+                           'metricas.cpp', 'perfil.cpp',
+                           'fronteira.cpp', 'variacoes.cpp'],
+                  depends=['reversi.h', 'arena.h', 'transposicao.h', 'lote.h',
+                           'afinidade.h', 'tabelas.h', 'registro.h',
+                           'metricas.h', 'perfil.h', 'fronteira.h',
+                           'variacoes.h'],
+                  extra_compile_args=['-O2', '-pthread'],
+                  extra_link_args=['-pthread'],
+                  language='c++')
+
+setup(name='reversi',
+      version='1.0',
+      description='Motor Reversi em C++ para o reversi.py',
+      ext_modules=[motor])
@@ -0,0 +1,171 @@
+//// Simetrias do tabuleiro ///////////////////////////////////////////////////
+
+// Veja simetria.h.
+
+#include "perfil.h"
+#include "reversi.h"
+#include "simetria.h"
+#include "tabelas.h"
+
+void transforma(int t, int tam, int *linha, int *coluna) {
+  if (t & 1) {
+    swap(*linha, *coluna);
+  }
+  if (t & 2) {
+    *linha = tam + 1 - *linha;
+  }
+  if (t & 4) {
+    *coluna = tam + 1 - *coluna;
+  }
+}
+
+void destransforma(int t, int tam, int *linha, int *coluna) {
+  if (t & 4) {
+    *coluna = tam + 1 - *coluna;
+  }
+  if (t & 2) {
+    *linha = tam + 1 - *linha;
+  }
+  if (t & 1) {
+    swap(*linha, *coluna);
+  }
+}
+
+//// Caminho rápido: 8x8 //////////////////////////////////////////////////////
+
+// A casa (linha, coluna) é o bit 8 * (linha - 1) + (coluna - 1). Cada
+// parte de uma transformação vira algumas operações sobre o *bitboard*
+// inteiro (as três são as clássicas da programação de xadrez).
+
+typedef unsigned long long Bitboard;
+
+// Troca linha e coluna (reflexão na diagonal principal).
+static inline Bitboard troca_diagonal(Bitboard x) {
+  Bitboard t;
+
+  t = 0x0F0F0F0F00000000ULL & (x ^ (x << 28));
+  x ^= t ^ (t >> 28);
+  t = 0x3333000033330000ULL & (x ^ (x << 14));
+  x ^= t ^ (t >> 14);
+  t = 0x5500550055005500ULL & (x ^ (x << 7));
+  x ^= t ^ (t >> 7);
+  return x;
+}
+
+// Inverte as linhas: cada linha é um *byte*.
+static inline Bitboard inverte_linhas(Bitboard x) {
+  return __builtin_bswap64(x);
+}
+
+// Inverte as colunas: os bits de cada *byte*.
+static inline Bitboard inverte_colunas(Bitboard x) {
+  x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+  x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+  x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+  return x;
+}
+
+static inline Bitboard aplica(int t, Bitboard x) {
+  if (t & 1) {
+    x = troca_diagonal(x);
+  }
+  if (t & 2) {
+    x = inverte_linhas(x);
+  }
+  if (t & 4) {
+    x = inverte_colunas(x);
+  }
+  return x;
+}
+
+static unsigned long long chave_canonica_8x8(char jogador, string **tabuleiro,
+                                             int *transformacao) {
+  Bitboard pretas = 0, brancas = 0, p, b, menor_p, menor_b;
+  unsigned long long chave = chave_tamanho(8) ^
+                             (jogador == BRANCO ? CHAVE_VEZ : 0);
+  const unsigned long long *const *chaves = tabelas(8)->chaves;
+  int linha, coluna, t, casa;
+
+  for (linha=1; linha<=8; linha++) {
+    for (coluna=1; coluna<=8; coluna++) {
+      char peca = (*tabuleiro[linha])[coluna];
+      Bitboard bit = 1ULL << (8 * (linha - 1) + (coluna - 1));
+      pretas |= peca == PRETO ? bit : 0;
+      brancas |= peca == BRANCO ? bit : 0;
+    }
+  }
+
+  // A imagem canônica é a menor como par (pretas, brancas).
+  menor_p = pretas;
+  menor_b = brancas;
+  *transformacao = 0;
+  for (t=1; t<8; t++) {
+    p = aplica(t, pretas);
+    b = aplica(t, brancas);
+    if (p < menor_p || (p == menor_p && b < menor_b)) {
+      menor_p = p;
+      menor_b = b;
+      *transformacao = t;
+    }
+  }
+
+  // O bit da casa (linha, coluna) é a casa (linha + 1, coluna + 1) das
+  // tabelas, com bordas (veja tabelas.h).
+  for (; menor_p != 0; menor_p &= menor_p - 1) {
+    casa = __builtin_ctzll(menor_p);
+    chave ^= chaves[0][(casa / 8 + 1) * 10 + casa % 8 + 1];
+  }
+  for (; menor_b != 0; menor_b &= menor_b - 1) {
+    casa = __builtin_ctzll(menor_b);
+    chave ^= chaves[1][(casa / 8 + 1) * 10 + casa % 8 + 1];
+  }
+  return chave;
+}
+
+//// Caminho geral ////////////////////////////////////////////////////////////
+
+// Calculamos as chaves das 8 imagens de uma vez, casa por casa, e a
+// imagem canônica é a de menor chave. A imagem de cada casa e a sua
+// chave vêm das tabelas do tamanho (veja tabelas.h), quando houver.
+unsigned long long chave_canonica(char jogador, string **tabuleiro,
+                                  int *transformacao) {
+  int tam = (*tabuleiro[0]).size() - 2, lado = tam + 2;
+  const TabelasTamanho *tab;
+  unsigned long long chaves[8] = {0};
+  int linha, coluna, l, c, t, casa;
+  PERFIL_ESCOPO(PERFIL_SIMETRIA);
+
+  if (tam == 8) {
+    return chave_canonica_8x8(jogador, tabuleiro, transformacao);
+  }
+
+  tab = tabelas(tam);
+  for (linha=1; linha<=tam; linha++) {
+    for (coluna=1; coluna<=tam; coluna++) {
+      char peca = (*tabuleiro[linha])[coluna];
+      if (peca != PRETO && peca != BRANCO) {
+        continue;
+      }
+      casa = linha * lado + coluna;
+      for (t=0; t<8; t++) {
+        if (tab != NULL) {
+          chaves[t] ^= tab->chaves[peca - '0'][tab->imagens[t][casa]];
+        } else {
+          l = linha;
+          c = coluna;
+          transforma(t, tam, &l, &c);
+          chaves[t] ^= chave_casa(l, c, peca);
+        }
+      }
+    }
+  }
+
+  *transformacao = 0;
+  for (t=1; t<8; t++) {
+    if (chaves[t] < chaves[*transformacao]) {
+      *transformacao = t;
+    }
+  }
+  return chaves[*transformacao] ^ chave_tamanho(tam) ^
+         (jogador == BRANCO ? CHAVE_VEZ : 0);
+}
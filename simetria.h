@@ -0,0 +1,37 @@
+#ifndef _SIMETRIA_H_
+#define _SIMETRIA_H_
+
+//// Simetrias do tabuleiro ///////////////////////////////////////////////////
+
+// O tabuleiro quadrado tem 8 simetrias (rotações e reflexões), e a
+// posição inicial é simétrica por algumas delas: as quatro primeiras
+// jogadas possíveis, por exemplo, levam a posições equivalentes. Para
+// que posições equivalentes ocupem uma só entrada no banco de posições
+// (banco.h) e, opcionalmente, na tabela de transposição, usamos a
+// chave *canônica*: a chave de *Zobrist* da menor das 8 imagens da
+// posição.
+//
+// A transformação *t* (0 a 7) é a composição, nesta ordem, de: trocar
+// linha e coluna (bit 0), inverter as linhas (bit 1) e inverter as
+// colunas (bit 2). As coordenadas são as do motor (1 a *tam*).
+
+#include <string>
+
+// Leva a casa (linha, coluna) à sua imagem pela transformação *t*.
+void transforma(int t, int tam, int *linha, int *coluna);
+
+// Volta da imagem pela transformação *t* à casa original.
+void destransforma(int t, int tam, int *linha, int *coluna);
+
+// Chave canônica da posição (no mesmo esquema de *chave_zobrist()*) e,
+// em *transformacao*, a transformação que leva a posição à imagem
+// canônica. No 8x8 as imagens são comparadas como *bitboards*; nos
+// demais tamanhos, pelas próprias chaves.
+unsigned long long chave_canonica(char jogador, std::string **tabuleiro,
+                                  int *transformacao);
+
+// Entra nas chaves canônicas guardadas na tabela de transposição, para
+// que não se confundam com as chaves simples de outras posições.
+const unsigned long long CHAVE_CANONICA = 0x8CB92BA72F3D8DD7ULL;
+
+#endif /* _SIMETRIA_H_ */
@@ -0,0 +1,225 @@
+//// Tabelas pré-calculadas por tamanho ///////////////////////////////////////
+
+// Veja tabelas.h.
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "reversi.h"
+#include "simetria.h"
+#include "tabelas.h"
+
+atomic<const TabelasTamanho *> tabelas_por_tamanho[TAM_MAX_TABELAS + 1];
+
+static mutex mutex_tabelas;
+static string diretorio_cache;
+static bool diretorio_definido = false;
+
+// Bytes das tabelas (sem o cabeçalho) de um tamanho.
+static size_t bytes_tabelas(int tam) {
+  size_t casas = (size_t) (tam + 2) * (tam + 2);
+  return casas * (3 * sizeof(unsigned long long) + 8 * sizeof(int));
+}
+
+// Soma de verificação: FNV-1a sobre palavras de 64 bits (o tamanho das
+// tabelas é sempre múltiplo de 8).
+static unsigned long long soma(const void *dados, size_t bytes) {
+  const unsigned long long *p = (const unsigned long long *) dados;
+  unsigned long long h = 0xCBF29CE484222325ULL;
+  size_t i;
+
+  for (i=0; i<bytes/8; i++) {
+    h = (h ^ p[i]) * 0x100000001B3ULL;
+  }
+  return h;
+}
+
+// Aponta as tabelas para a área *dados*, na ordem do arquivo.
+static TabelasTamanho *aponta(int tam, char *dados) {
+  TabelasTamanho *t = new TabelasTamanho;
+  size_t casas = (size_t) (tam + 2) * (tam + 2);
+  unsigned long long *chaves = (unsigned long long *) dados;
+  int *imagens = (int *) (chaves + 3 * casas);
+  int k;
+
+  t->tam = tam;
+  t->chaves[0] = chaves;
+  t->chaves[1] = chaves + casas;
+  t->viradas = chaves + 2 * casas;
+  for (k=0; k<8; k++) {
+    t->imagens[k] = imagens + k * casas;
+  }
+  return t;
+}
+
+// Calcula as tabelas em *dados* (com *bytes_tabelas(tam)* bytes).
+static void calcula(int tam, char *dados) {
+  int lado = tam + 2, linha, coluna, l, c, k;
+  size_t casas = (size_t) lado * lado, casa;
+  unsigned long long *chaves = (unsigned long long *) dados;
+  int *imagens = (int *) (chaves + 3 * casas);
+
+  for (linha=0; linha<lado; linha++) {
+    for (coluna=0; coluna<lado; coluna++) {
+      casa = (size_t) linha * lado + coluna;
+      chaves[casa] = chave_casa(linha, coluna, PRETO);
+      chaves[casas + casa] = chave_casa(linha, coluna, BRANCO);
+      chaves[2 * casas + casa] = chaves[casa] ^ chaves[casas + casa];
+      for (k=0; k<8; k++) {
+        l = linha;
+        c = coluna;
+        // As bordas não têm imagem (nunca têm peças).
+        if (linha >= 1 && linha <= tam && coluna >= 1 && coluna <= tam) {
+          transforma(k, tam, &l, &c);
+        }
+        imagens[k * casas + casa] = l * lado + c;
+      }
+    }
+  }
+}
+
+// Diretório do cache: o definido pelo programa ou o do ambiente.
+static string diretorio() {
+  const char *v;
+
+  if (diretorio_definido) {
+    return diretorio_cache;
+  }
+  if ((v = getenv("REVERSI_CACHE")) != NULL) {
+    return v;
+  }
+  if ((v = getenv("XDG_CACHE_HOME")) != NULL && *v != '\0') {
+    return string(v) + "/reversi";
+  }
+  if ((v = getenv("HOME")) != NULL && *v != '\0') {
+    return string(v) + "/.cache/reversi";
+  }
+  return "";
+}
+
+static string caminho(const string &dir, int tam) {
+  ostringstream s;
+  s << dir << "/tabelas-" << tam << ".bin";
+  return s.str();
+}
+
+// Mapeia o arquivo de cache, se existir e estiver íntegro.
+static TabelasTamanho *carrega(const string &nome, int tam) {
+  size_t bytes = sizeof(CabecalhoTabelas) + bytes_tabelas(tam);
+  const CabecalhoTabelas *cabecalho;
+  struct stat st;
+  void *mapa;
+  int fd;
+
+  fd = open(nome.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  if (fstat(fd, &st) < 0 || (size_t) st.st_size != bytes) {
+    close(fd);
+    return NULL;
+  }
+  mapa = mmap(NULL, bytes, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapa == MAP_FAILED) {
+    return NULL;
+  }
+  cabecalho = (const CabecalhoTabelas *) mapa;
+  if (memcmp(cabecalho->magica, "RVTABELA", 8) != 0 ||
+      cabecalho->versao != VERSAO_TABELAS ||
+      cabecalho->tam != (unsigned) tam || cabecalho->bytes != bytes ||
+      cabecalho->soma != soma(cabecalho + 1, bytes_tabelas(tam))) {
+    munmap(mapa, bytes);
+    return NULL;
+  }
+  return aponta(tam, (char *) (cabecalho + 1));
+}
+
+// Cria o diretório e os que faltarem acima dele.
+static bool cria_diretorio(const string &dir) {
+  size_t i;
+
+  for (i=1; i<=dir.size(); i++) {
+    if (i == dir.size() || dir[i] == '/') {
+      if (mkdir(dir.substr(0, i).c_str(), 0755) < 0 && errno != EEXIST) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Grava as tabelas no cache. O arquivo é escrito com outro nome e
+// renomeado no fim, para que processos simultâneos (os do *gera*, por
+// exemplo) nunca vejam um arquivo pela metade.
+static void grava(const string &dir, const string &nome, int tam,
+                  const char *dados) {
+  CabecalhoTabelas cabecalho;
+  size_t bytes = bytes_tabelas(tam);
+  ostringstream temporario;
+  bool ok;
+  int fd;
+
+  if (!cria_diretorio(dir)) {
+    return;
+  }
+  memset(&cabecalho, 0, sizeof(cabecalho));
+  memcpy(cabecalho.magica, "RVTABELA", 8);
+  cabecalho.versao = VERSAO_TABELAS;
+  cabecalho.tam = tam;
+  cabecalho.bytes = sizeof(cabecalho) + bytes;
+  cabecalho.soma = soma(dados, bytes);
+  temporario << nome << "." << getpid();
+  fd = open(temporario.str().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return;
+  }
+  ok = write(fd, &cabecalho, sizeof(cabecalho)) == sizeof(cabecalho) &&
+       write(fd, dados, bytes) == (ssize_t) bytes;
+  ok = close(fd) == 0 && ok;
+  if (!ok || rename(temporario.str().c_str(), nome.c_str()) != 0) {
+    unlink(temporario.str().c_str());
+  }
+}
+
+const TabelasTamanho *monta_tabelas(int tam) {
+  lock_guard<mutex> trava(mutex_tabelas);
+  const TabelasTamanho *pronta = tabelas_por_tamanho[tam].load();
+  TabelasTamanho *t = NULL;
+  string dir = tam >= TAM_MIN_CACHE ? diretorio() : "", nome;
+  char *dados;
+
+  if (pronta != NULL) {
+    return pronta;
+  }
+  if (!dir.empty()) {
+    nome = caminho(dir, tam);
+    t = carrega(nome, tam);
+  }
+  if (t == NULL) {
+    dados = (char *) malloc(bytes_tabelas(tam));
+    if (dados == NULL) {
+      throw bad_alloc();
+    }
+    calcula(tam, dados);
+    if (!dir.empty()) {
+      grava(dir, nome, tam, dados);
+    }
+    t = aponta(tam, dados);
+  }
+  tabelas_por_tamanho[tam].store(t, memory_order_release);
+  return t;
+}
+
+void diretorio_cache_tabelas(const string &dir) {
+  lock_guard<mutex> trava(mutex_tabelas);
+  diretorio_cache = dir;
+  diretorio_definido = true;
+}
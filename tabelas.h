@@ -0,0 +1,85 @@
+#ifndef _TABELAS_H_
+#define _TABELAS_H_
+
+//// Tabelas pré-calculadas por tamanho ///////////////////////////////////////
+
+// Algumas contas do motor dependem só do tamanho do tabuleiro e se
+// repetem em todo nó da busca: o número de *Zobrist* de cada peça em
+// cada casa (veja transposicao.h) e a casa em que cada casa cai por
+// cada uma das 8 simetrias (veja simetria.h). Elas são calculadas uma
+// vez por tamanho e guardadas em tabelas, na primeira vez em que o
+// tamanho aparece.
+//
+// Como os programas que jogam uma só partida por processo (o *reversi*
+// lançado pelo *gera* ou pelos testes) pagariam essa construção a cada
+// execução, as tabelas também são gravadas em um arquivo de cache por
+// tamanho e, nas execuções seguintes, mapeadas direto do arquivo
+// (mmap), sem cálculo nem cópia. O arquivo começa com um cabeçalho
+// (veja *CabecalhoTabelas*) com a versão do formato e uma soma de
+// verificação do conteúdo; um arquivo de outra versão, de outro
+// tamanho ou corrompido é ignorado e refeito.
+//
+// Nos tabuleiros pequenos, montar as tabelas custa menos que abrir e
+// conferir um arquivo; por isso o cache só é usado a partir de
+// *TAM_MIN_CACHE*. O diretório do cache é $REVERSI_CACHE (vazio:
+// nenhum) ou, sem ele, $XDG_CACHE_HOME/reversi ou ~/.cache/reversi.
+
+#include <atomic>
+#include <string>
+
+// As casas são numeradas como no tabuleiro com bordas: a casa (linha,
+// coluna) é a de número *linha * (tam + 2) + coluna*.
+struct TabelasTamanho {
+  int tam;
+  const unsigned long long *chaves[2];  // chave_casa() de PRETO e BRANCO
+  const unsigned long long *viradas;    // chaves[0] ^ chaves[1]
+  const int *imagens[8];                // casa da imagem por transformação
+};
+
+// Cabeçalho do arquivo de cache, seguido das tabelas na ordem acima:
+// chaves de PRETO, de BRANCO e viradas (uma por casa, 64 bits) e as 8
+// imagens (uma por casa, 32 bits).
+struct CabecalhoTabelas {
+  char magica[8];             // "RVTABELA"
+  unsigned versao;
+  unsigned tam;
+  unsigned long long bytes;   // tamanho do arquivo inteiro
+  unsigned long long soma;    // soma de verificação das tabelas
+};
+
+static_assert(sizeof(CabecalhoTabelas) == 32,
+              "o cabeçalho faz parte do formato do arquivo");
+
+// Mude a versão sempre que o conteúdo ou o formato das tabelas mudar
+// (inclusive as chaves de *chave_casa()*).
+const unsigned VERSAO_TABELAS = 1;
+
+// Tabuleiros maiores que isso não têm tabelas: as contas são feitas
+// casa a casa, como antes.
+const int TAM_MAX_TABELAS = 1024;
+
+// Menor tamanho cujas tabelas vão para o cache em arquivo.
+const int TAM_MIN_CACHE = 40;
+
+extern std::atomic<const TabelasTamanho *>
+  tabelas_por_tamanho[TAM_MAX_TABELAS + 1];
+
+const TabelasTamanho *monta_tabelas(int tam);
+
+// As tabelas do tamanho *tam* (NULL acima de *TAM_MAX_TABELAS*).
+// Ficam prontas na primeira chamada e valem até o fim do processo.
+inline const TabelasTamanho *tabelas(int tam) {
+  const TabelasTamanho *t;
+
+  if (tam > TAM_MAX_TABELAS) {
+    return NULL;
+  }
+  t = tabelas_por_tamanho[tam].load(std::memory_order_acquire);
+  return t != NULL ? t : monta_tabelas(tam);
+}
+
+// Troca o diretório do cache ("": sem cache). Vale para os tamanhos
+// ainda não usados.
+void diretorio_cache_tabelas(const std::string &diretorio);
+
+#endif /* _TABELAS_H_ */
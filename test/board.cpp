@@ -11,7 +11,7 @@ int const Board::direction[8][2] = {{0, 1}, {0, -1}, {1, 0}, {-1, 0},
                                     {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
 
 Board::Board(int size)
-    : _size(size)
+    : _size(size), _legal_valid(false)
 {
     // Board size must be even and greater than 4.
     if (size < 4 || size % 2 != 0) {
@@ -32,6 +32,38 @@ Board::Board(int size)
     _board[size/2*(size + 1)]     = black;
 }
 
+// Copy the board (the copy has its own state array).
+Board::Board(Board const &other)
+    : _size(other._size), _legal(other._legal),
+      _legal_valid(other._legal_valid)
+{
+    _board = new Cell_state[_size * _size];
+    std::copy(other._board, other._board + _size * _size, _board);
+    std::copy(other._legal_count, other._legal_count + 3, _legal_count);
+}
+
+// Assign the state of other to this board.
+Board &Board::operator= (Board const &other)
+{
+    if (this != &other) {
+        Cell_state *board = new Cell_state[other._size * other._size];
+        std::copy(other._board, other._board + other._size * other._size,
+                  board);
+        delete [] _board;
+        _board = board;
+        _size = other._size;
+        _legal = other._legal;
+        std::copy(other._legal_count, other._legal_count + 3, _legal_count);
+        _legal_valid = other._legal_valid;
+    }
+    return *this;
+}
+
+Board::~Board()
+{
+    delete [] _board;
+}
+
 // Access board at cell c.
 Cell_state &Board::operator[] (Cell const &c) 
 {
@@ -40,6 +72,8 @@ Cell_state &Board::operator[] (Cell const &c)
         throw std::out_of_range("Invalid cell");
     }
 
+    // The caller may change the cell: the valid moves must be rebuilt.
+    _legal_valid = false;
     return _board[c.row() * _size + c.col()];
 }
 
@@ -74,7 +108,7 @@ std::vector<Cell> Board::flips_in_direction(Cell const &start_cell,
     // Add to flip_candidates while cell is valid and of other_player
     while (((0 <= current_i) && (current_i < _size)) &&
            ((0 <= current_j) && (current_j < _size)) &&
-           (*this)[current] == other_player) {
+           _board[current_i * _size + current_j] == other_player) {
         flip_candidates.push_back(current);
         current_i += direction[0];
         current_j += direction[1];
@@ -84,7 +118,7 @@ std::vector<Cell> Board::flips_in_direction(Cell const &start_cell,
     // a cell of player.
     if (!(((0 <= current_i) && (current_i < _size)) &&
           ((0 <= current_j) && (current_j < _size))) ||
-        (*this)[current] != player) {
+        _board[current_i * _size + current_j] != player) {
         // If we didn't found a cell of player, erase the candidates found.
         flip_candidates.erase(flip_candidates.begin(), flip_candidates.end());
     }
@@ -92,13 +126,106 @@ std::vector<Cell> Board::flips_in_direction(Cell const &start_cell,
     return flip_candidates;
 }
 
+// Player that would flip cells playing at (row, col) in direction: the
+// pieces next to it must be of one color and be closed by the other.
+// Returns empty if no player would.
+Cell_state Board::flipper(int row, int col, int const direction[2]) const
+{
+    int i = row + direction[0];
+    int j = col + direction[1];
+    if (!(0 <= i && i < _size && 0 <= j && j < _size) ||
+        _board[i * _size + j] == empty) {
+        return empty;
+    }
+    Cell_state flipped = _board[i * _size + j];
+    do {
+        i += direction[0];
+        j += direction[1];
+    } while (0 <= i && i < _size && 0 <= j && j < _size &&
+             _board[i * _size + j] == flipped);
+    if (!(0 <= i && i < _size && 0 <= j && j < _size) ||
+        _board[i * _size + j] == empty) {
+        return empty;
+    }
+    return _board[i * _size + j];
+}
+
+// Recompute the cached validity of the cell (row, col).
+void Board::update_legal(int row, int col) const
+{
+    unsigned char &legal = _legal[row * _size + col];
+    unsigned char now = 0;
+    unsigned char const both = (1 << black) | (1 << white);
+    if (_board[row * _size + col] == empty) {
+        for (int dir = 0; dir < 8 && now != both; dir++) {
+            Cell_state player = flipper(row, col, direction[dir]);
+            if (player != empty) {
+                now |= 1 << player;
+            }
+        }
+    }
+    _legal_count[black] += ((now >> black) & 1) - ((legal >> black) & 1);
+    _legal_count[white] += ((now >> white) & 1) - ((legal >> white) & 1);
+    legal = now;
+}
+
+// Build the cache of valid moves from scratch.
+void Board::build_legal() const
+{
+    _legal.assign(_size * _size, 0);
+    std::fill(_legal_count, _legal_count + 3, 0);
+    for (int r = 0; r < _size; r++) {
+        for (int c = 0; c < _size; c++) {
+            update_legal(r, c);
+        }
+    }
+    _legal_valid = true;
+}
+
+// Cells whose validity may change when cell c changes: c itself and,
+// in each direction, the first empty cell after the pieces following c.
+// They are added to cells (as row * size + col).
+void Board::around(Cell const &c, std::vector<int> &cells) const
+{
+    cells.push_back(c.row() * _size + c.col());
+    for (int dir = 0; dir < 8; dir++) {
+        int i = c.row() + direction[dir][0];
+        int j = c.col() + direction[dir][1];
+        while (0 <= i && i < _size && 0 <= j && j < _size &&
+               _board[i * _size + j] != empty) {
+            i += direction[dir][0];
+            j += direction[dir][1];
+        }
+        if (0 <= i && i < _size && 0 <= j && j < _size) {
+            cells.push_back(i * _size + j);
+        }
+    }
+}
+
+// Verify if player has any valid move.
+bool Board::has_valid_move(Cell_state player) const
+{
+    if (!_legal_valid) {
+        build_legal();
+    }
+    return _legal_count[player] > 0;
+}
+
 // Verifu a move is valid.
 // m is the move to verify at the this board.
 bool Board::is_valid(Move const &m)
 {
+    Cell_state const &move_position =
+        static_cast<Board const &>(*this)[m.position()];
+
+    // Valid moves are cached (see has_valid_move()).
+    if (_legal_valid) {
+        int i = m.position().row() * _size + m.position().col();
+        return (_legal[i] >> m.player()) & 1;
+    }
+
     // We compute flip candidates in each direction.  If some
     // direction has flip candidates, the move is valid.
-    Cell_state &move_position = (*this)[m.position()];
     if (move_position == empty) {
         for (int dir = 0; dir < 8; dir++) {
             std::vector<Cell> flip_candidates;
@@ -121,7 +248,10 @@ bool Board::is_valid(Move const &m)
 // m is the move to play.
 void Board::play(Move const &m)
 {
-    Cell_state &move_position = (*this)[m.position()];
+    // Checks the range (and throws std::out_of_range).
+    static_cast<Board const &>(*this)[m.position()];
+    Cell_state &move_position =
+        _board[m.position().row() * _size + m.position().col()];
 
     // The cell must be empty.
     if (move_position == empty) {
@@ -144,7 +274,23 @@ void Board::play(Move const &m)
             move_position = m.player();
             // Flip appropriate cells.
             for (std::vector<Cell>::size_type i = 0; i < to_flip.size(); i++) {
-                (*this)[to_flip[i]] = m.player();
+                _board[to_flip[i].row() * _size + to_flip[i].col()] =
+                    m.player();
+            }
+            // Only empty cells seeing a changed cell (through a line of
+            // pieces) may have changed validity.
+            if (_legal_valid) {
+                std::vector<int> cells;
+                around(m.position(), cells);
+                for (std::vector<Cell>::size_type i = 0; i < to_flip.size(); i++) {
+                    around(to_flip[i], cells);
+                }
+                std::sort(cells.begin(), cells.end());
+                cells.erase(std::unique(cells.begin(), cells.end()),
+                            cells.end());
+                for (std::vector<int>::size_type i = 0; i < cells.size(); i++) {
+                    update_legal(cells[i] / _size, cells[i] % _size);
+                }
             }
             return; // Return if legal move
         }
@@ -1,6 +1,7 @@
 #ifndef _BOARD_H_
 #define _BOARD_H_
 
+#include <vector>
 #include "cell.h"
 #include "move.h"
 
@@ -13,6 +14,28 @@ class Board
     // The 8 possible directions for flipping pieces.
     static int const direction[8][2];
 
+    // Cache of valid moves: for each cell, bit 1 << player is set if
+    // player can play there, and _legal_count[player] counts those
+    // cells. Built on first use and then updated by play() only around
+    // the cells it changed. Writing to the board through operator[]
+    // drops the cache (it is rebuilt on next use).
+    mutable std::vector<unsigned char> _legal;
+    mutable int _legal_count[3];
+    mutable bool _legal_valid;
+
+    // Player that would flip cells playing at (row, col) in direction
+    // (empty if none).
+    Cell_state flipper(int row, int col, int const direction[2]) const;
+
+    // Recompute the cached validity of the cell (row, col).
+    void update_legal(int row, int col) const;
+
+    // Build the cache of valid moves from scratch.
+    void build_legal() const;
+
+    // Add to cells the cells whose validity may change when c changes.
+    void around(Cell const &c, std::vector<int> &cells) const;
+
     // Evaluate possible cells to flip.
     // player is the possible player,
     // start_cell is where player could play,
@@ -25,6 +48,14 @@ public:
 
     Board(int size);
 
+    // Copy the board (the copy has its own state array).
+    Board(Board const &other);
+
+    // Assign the state of other to this board.
+    Board &operator= (Board const &other);
+
+    ~Board();
+
     // Access board at cell c.
     Cell_state &operator[] (Cell const &c); 
 
@@ -47,6 +78,10 @@ public:
     // m is the move to verify at the this board.
     bool is_valid(Move const &m);
 
+    // Verify if player has any valid move. O(1) (besides the first call
+    // after the board is written to through operator[]).
+    bool has_valid_move(Cell_state player) const;
+
 };
 
 // Show board in an std::ostream.
@@ -39,8 +39,10 @@ int main(int argc, char *argv[])
             // If a player was skipped, verify validity.
             if (last_player == moves[i].player()) {
                 Cell_state other_player = last_player == black ? white : black;
-                // Look all cells for a valid move of other_player
-                for (int r = 0; r < board_size; r++) {
+                // Look all cells for a valid move of other_player (only
+                // to report it: the board knows if there is one).
+                for (int r = 0; board.has_valid_move(other_player) &&
+                         r < board_size; r++) {
                     for (int c = 0; c < board_size; c++) {
                         Cell current_cell(r, c);
                         Move other_move(other_player, current_cell);
@@ -68,7 +70,8 @@ int main(int argc, char *argv[])
     }
 
     // File ended. Verify if there are any valid moves left.
-    for (int r = 0; r < board_size; r++) {
+    for (int r = 0; (board.has_valid_move(black) ||
+                     board.has_valid_move(white)) && r < board_size; r++) {
         for (int c = 0; c < board_size; c++) {
             Cell current_cell = Cell(r, c);
             Move possible_move_black(black, current_cell);
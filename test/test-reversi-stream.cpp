@@ -0,0 +1,268 @@
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+#include "util.h"
+#include "verifier.h"
+
+// Streaming verifier: validates games while they are being written,
+// one line at a time, instead of reading the whole game file first.
+// Errors are reported with their move number and verification goes on.
+//
+// Input lines are:
+//
+//   black <row> <col>           move of the current game
+//   <id> black <row> <col>      move of game <id> (also white)
+//   game <id> [size <n> ...]    start game <id> and make it current
+//   end                         the current game ended
+//   <id> end                    game <id> ended
+//
+// So a plain game file is a single game, a shard written by gera (one
+// header line before each game) is a sequence of games, and many games
+// can be multiplexed on one pipe by prefixing each line with its game
+// id. A header line also ends the previous current game, if it had
+// moves without id (as in the shards). At end of input, games not yet
+// ended are verified as ended there, unless -f is given: then the file
+// is followed as it grows (like tail -f).
+//
+// Only the board of each open game is kept, never its moves.
+
+// An open game.
+struct Stream_game
+{
+    Game_verifier verifier;
+    int errors;
+    bool without_id; // got moves without id
+
+    Stream_game(int size)
+        : verifier(size), errors(0), without_id(false)
+    {
+    }
+};
+
+typedef std::map<std::string, Stream_game *> Game_map;
+
+static int games_ok = 0, games_with_errors = 0;
+
+static void usage(std::string command)
+{
+    std::cerr << "Usage: "
+              << command << " [-c configfile] [-g gamefile] [-f]\n";
+    exit(1);
+}
+
+static std::string player_name(Cell_state player)
+{
+    return player == black ? "black" : "white";
+}
+
+static bool parse_player(std::string s, Cell_state *player)
+{
+    std::transform(s.begin(), s.end(), s.begin(), tolower);
+    if (s != "black" && s != "white") {
+        return false;
+    }
+    *player = s == "black" ? black : white;
+    return true;
+}
+
+// Verify that game id may end here and forget it.
+static void end_game(Game_map &games, std::string const &id)
+{
+    Game_map::iterator g = games.find(id);
+    if (g == games.end()) {
+        std::cout << "game " << id << ": ended but never started\n";
+        games_with_errors++;
+        return;
+    }
+    Stream_game *game = g->second;
+    std::string error = game->verifier.finish();
+    if (!error.empty()) {
+        std::cout << "game " << id << " move " << game->verifier.moves()
+                  << ": " << error << "\n";
+        game->errors++;
+    }
+    if (game->errors == 0) {
+        std::cout << "game " << id << ": ok ("
+                  << game->verifier.moves() << " moves)\n";
+        games_ok++;
+    }
+    else {
+        std::cout << "game " << id << ": " << game->errors
+                  << " error(s) in " << game->verifier.moves() << " moves\n";
+        games_with_errors++;
+    }
+    std::cout.flush();
+    delete game;
+    games.erase(g);
+}
+
+static Stream_game *find_game(Game_map &games, std::string const &id,
+                              int size)
+{
+    Game_map::iterator g = games.find(id);
+    if (g != games.end()) {
+        return g->second;
+    }
+    Stream_game *game = new Stream_game(size);
+    games[id] = game;
+    return game;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string conf_name = default_conf_name, game_name = "-";
+    bool follow = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:g:f")) != -1) {
+        switch (opt) {
+        case 'c':
+            conf_name = optarg;
+            break;
+        case 'g':
+            game_name = optarg;
+            break;
+        case 'f':
+            follow = true;
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (optind < argc) {
+        usage(argv[0]);
+    }
+
+    // Games without a size in their header use the configured size.
+    int default_size = get_board_size(conf_name);
+
+    std::ifstream game_file;
+    if (game_name != "-") {
+        game_file.open(game_name.c_str());
+        if (!game_file.good()) {
+            std::cerr << "Bad game file " << game_name << std::endl;
+            exit(1);
+        }
+    }
+    std::istream &input = game_name == "-" ? std::cin : game_file;
+
+    Game_map games;
+    std::string current = "-"; // game of the lines without id
+    std::string text, partial;
+    int line = 0;
+    while (true) {
+        std::getline(input, text);
+        if (input.eof()) {
+            // A line without its newline may still be being written.
+            partial += text;
+            if (follow && game_name != "-") {
+                input.clear();
+                usleep(200000);
+                continue;
+            }
+            if (partial.empty()) {
+                break;
+            }
+            text.clear();
+        }
+        text = partial + text;
+        partial.clear();
+        line++;
+
+        std::istringstream fields(text);
+        std::string first, id;
+        Cell_state player;
+        int r, c;
+        if (!(fields >> first)) {
+            continue;
+        }
+        if (first == "game") {
+            int size = default_size;
+            bool valid = true;
+            std::string key;
+            if (!(fields >> id)) {
+                std::cout << "line " << line << ": bad game header\n";
+                continue;
+            }
+            while (fields >> key) {
+                if (key == "size") {
+                    // Board exits on a bad size, which would stop the
+                    // monitor for every other game in the stream.
+                    valid = (fields >> size) && size >= 4 && size % 2 == 0;
+                    if (!valid) {
+                        break;
+                    }
+                }
+            }
+            if (!valid) {
+                std::cout << "line " << line << ": bad game header\n";
+                continue;
+            }
+            if (games.count(current) > 0 && games[current]->without_id) {
+                end_game(games, current);
+            }
+            if (games.count(id) > 0) {
+                std::cout << "game " << id << ": started twice\n";
+                end_game(games, id);
+            }
+            current = id;
+            find_game(games, id, size);
+            continue;
+        }
+        if (first == "end") {
+            end_game(games, current);
+            continue;
+        }
+        bool without_id = parse_player(first, &player);
+        if (without_id) {
+            id = current;
+        }
+        else {
+            std::string second;
+            id = first;
+            if (!(fields >> second)) {
+                std::cout << "line " << line << ": bad line\n";
+                continue;
+            }
+            if (second == "end") {
+                end_game(games, id);
+                continue;
+            }
+            if (!parse_player(second, &player)) {
+                std::cout << "line " << line << ": bad line\n";
+                continue;
+            }
+        }
+        if (!(fields >> r >> c) || !(fields >> std::ws).eof()) {
+            std::cout << "line " << line << ": bad move\n";
+            continue;
+        }
+
+        Stream_game *game = find_game(games, id, default_size);
+        game->without_id = game->without_id || without_id;
+        int n = game->verifier.moves();
+        std::string error = game->verifier.play(Move(player, Cell(r, c)));
+        if (!error.empty()) {
+            std::cout << "game " << id << " move " << n << ": " << error
+                      << " (" << player_name(player) << " at ("
+                      << r << ", " << c << "))\n";
+            std::cout.flush();
+            game->errors++;
+        }
+    }
+
+    // Input ended: the open games end here.
+    while (!games.empty()) {
+        end_game(games, games.begin()->first);
+    }
+    std::cout << "Verified " << games_ok + games_with_errors << " game(s): "
+              << games_ok << " ok, " << games_with_errors
+              << " with errors\n";
+    return games_with_errors == 0 ? 0 : 1;
+}
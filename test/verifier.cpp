@@ -0,0 +1,47 @@
+#include <stdexcept>
+
+#include "verifier.h"
+
+Game_verifier::Game_verifier(int size)
+    : _board(size), _last_player(white), _moves(0)
+{
+}
+
+std::string Game_verifier::play(Move const &m)
+{
+    std::string error;
+
+    // If a player was skipped, verify validity.
+    if (_last_player == m.player()) {
+        Cell_state other_player = _last_player == black ? white : black;
+        if (_board.has_valid_move(other_player)) {
+            error = "A player with valid move was skipped";
+        }
+    }
+    // The move is played even after a skipping error, so that the board
+    // follows the game as written.
+    try {
+        _board.play(m);
+    }
+    catch (Invalid_move_exception) {
+        if (error.empty()) {
+            error = "You tried an invalid move.";
+        }
+    }
+    catch (std::out_of_range &) {
+        if (error.empty()) {
+            error = "Illegal cell.";
+        }
+    }
+    _last_player = m.player();
+    _moves++;
+    return error;
+}
+
+std::string Game_verifier::finish()
+{
+    if (_board.has_valid_move(black) || _board.has_valid_move(white)) {
+        return "Your game file ended prematurely (valid moves left)";
+    }
+    return "";
+}
@@ -0,0 +1,45 @@
+#ifndef _VERIFIER_H_
+#define _VERIFIER_H_
+
+#include <string>
+#include <vector>
+#include "move.h"
+#include "board.h"
+
+// Verify a single game one move at a time, keeping only the board
+// state (memory is O(board), whatever the number of moves). Errors are
+// returned to the caller instead of terminating the program.
+class Game_verifier
+{
+
+    Board _board;
+    Cell_state _last_player; // last player to verify skipping
+    int _moves; // moves consumed so far
+
+public:
+
+    Game_verifier(int size);
+
+    // Verify and play the next move m. Returns an empty string if the
+    // move is legal, or the error message otherwise. An invalid move
+    // is not played, but still counts as the turn of its player.
+    std::string play(Move const &m);
+
+    // Verify that the game may end here. Returns an empty string if no
+    // player has a valid move left, or the error message otherwise.
+    std::string finish();
+
+    // Number of moves consumed (the next move has this number, from 0).
+    int moves() const
+    {
+        return _moves;
+    }
+
+    Board const &board() const
+    {
+        return _board;
+    }
+
+};
+
+#endif /* _VERIFIER_H_ */
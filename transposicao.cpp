@@ -0,0 +1,130 @@
+//// Tabela de transposição ///////////////////////////////////////////////////
+
+// Veja transposicao.h.
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <new>
+#include <sys/mman.h>
+
+#include "reversi.h"
+#include "transposicao.h"
+#include "tabelas.h"
+
+unsigned long long chave_zobrist(char jogador, string **tabuleiro) {
+  int tam = (*tabuleiro[0]).size();
+  const TabelasTamanho *t = tabelas(tam - 2);
+  unsigned long long chave = chave_tamanho(tam - 2) ^
+                             (jogador == BRANCO ? CHAVE_VEZ : 0);
+  int i, j;
+  char peca;
+
+  for (i=1; i<tam-1; i++) {
+    for (j=1; j<tam-1; j++) {
+      peca = (*tabuleiro[i])[j];
+      if (peca == PRETO || peca == BRANCO) {
+        chave ^= t != NULL ? t->chaves[peca - '0'][i * tam + j] :
+                 chave_casa(i, j, peca);
+      }
+    }
+  }
+  return chave;
+}
+
+thread_local ContadoresTT contadores_tt = {0, 0, 0, 0};
+
+// Tamanho de uma página grande no x86-64 (e alinhamento pedido para
+// que o sistema possa usá-las).
+static const size_t PAGINA_GRANDE = 2 * 1024 * 1024;
+
+TabelaTransposicao::TabelaTransposicao(size_t megabytes, bool paginas_grandes)
+  : _geracao(0)
+{
+  size_t n = 1, bytes;
+  void *memoria;
+
+  while (2 * n * sizeof(BaldeTT) <= megabytes * 1024 * 1024) {
+    n *= 2;
+  }
+  bytes = n * sizeof(BaldeTT);
+  if (posix_memalign(&memoria, paginas_grandes ? PAGINA_GRANDE :
+                     sizeof(BaldeTT), bytes) != 0) {
+    throw bad_alloc();
+  }
+  if (paginas_grandes) {
+    // Só um pedido: sem suporte do sistema, seguimos com páginas
+    // normais.
+    madvise(memoria, bytes, MADV_HUGEPAGE);
+  }
+  _baldes = (BaldeTT *) memoria;
+  _mascara = n - 1;
+  limpa();
+}
+
+TabelaTransposicao::~TabelaTransposicao() {
+  free(_baldes);
+}
+
+void TabelaTransposicao::guarda(unsigned long long chave, int nivel,
+                                float ganho, char tipo, int linha,
+                                int coluna) {
+  BaldeTT &balde = _baldes[chave & _mascara];
+  unsigned geracao = _geracao.load(memory_order_relaxed);
+  unsigned long long dados, antigos;
+  unsigned bits;
+  int i, escolhida = 0, valor, menor = INT_MAX;
+  PERFIL_ESCOPO(PERFIL_TABELA);
+
+  // A casa da própria posição, a primeira vazia ou a de menor valor
+  // (o nível, menos 8 por geração de idade).
+  for (i=0; i<CASAS_BALDE; i++) {
+    antigos = balde.casas[i].dados.load(memory_order_relaxed);
+    if ((balde.casas[i].verificacao.load(memory_order_relaxed) ^
+         antigos) == chave || (antigos >> 32 & 0x7F) == 0) {
+      escolhida = i;
+      menor = INT_MIN;
+      break;
+    }
+    valor = (int) (antigos >> 32 & 0x7F) -
+            8 * (int) ((geracao - (antigos >> 59)) & 31);
+    if (valor < menor) {
+      menor = valor;
+      escolhida = i;
+    }
+  }
+  contadores_tt.guardas++;
+  if (menor != INT_MIN) {
+    contadores_tt.substituicoes++;
+  }
+
+  // Jogadas fora do que cabe em 9 bits (tabuleiros acima de 511x511)
+  // não são guardadas; o nível satura em 127, o que só deixa a entrada
+  // valer para menos buscas.
+  if (linha < 1 || linha > 511 || coluna < 1 || coluna > 511) {
+    linha = coluna = 0;
+  }
+  memcpy(&bits, &ganho, sizeof(bits));
+  dados = (unsigned long long) bits |
+          (unsigned long long) min(nivel, 127) << 32 |
+          (unsigned long long) linha << 39 |
+          (unsigned long long) coluna << 48 |
+          (unsigned long long) tipo << 57 |
+          (unsigned long long) geracao << 59;
+  balde.casas[escolhida].verificacao.store(chave ^ dados,
+                                           memory_order_relaxed);
+  balde.casas[escolhida].dados.store(dados, memory_order_relaxed);
+}
+
+void TabelaTransposicao::limpa() {
+  size_t i;
+  int j;
+
+  for (i=0; i<=_mascara; i++) {
+    for (j=0; j<CASAS_BALDE; j++) {
+      _baldes[i].casas[j].verificacao.store(0, memory_order_relaxed);
+      _baldes[i].casas[j].dados.store(0, memory_order_relaxed);
+    }
+  }
+  _geracao.store(0, memory_order_relaxed);
+}
@@ -0,0 +1,192 @@
+#ifndef _TRANSPOSICAO_H_
+#define _TRANSPOSICAO_H_
+
+//// Tabela de transposição ///////////////////////////////////////////////////
+
+// Muitas posições da árvore de busca são alcançadas por ordens de
+// jogadas diferentes (transposições). A tabela de transposição guarda o
+// resultado já calculado de cada posição, identificada por uma chave
+// de *Zobrist*: o XOR de um número pseudoaleatório para cada peça em
+// cada casa, mais um para o jogador da vez. Assim, a chave do filho
+// sai da chave do pai com alguns XORs (veja *Desfazer::chave* em
+// reversi.h), sem percorrer o tabuleiro.
+//
+// A tabela sobrevive de uma busca para a outra: é isso que permite ao
+// motor reaproveitar o que calculou enquanto *ponderava* (veja
+// pondera.h), mesmo quando o oponente não jogou a jogada prevista.
+
+#include <cstddef>
+#include <cstring>
+#include <atomic>
+#include <string>
+
+#include "perfil.h"
+
+// Mistura de 64 bits (a finalização do *splitmix64*), usada para
+// gerar os números de cada casa sem precisar de tabelas.
+inline unsigned long long mistura(unsigned long long x) {
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+// Número da peça *peca* ('0' ou '1') na casa (linha, coluna).
+inline unsigned long long chave_casa(int linha, int coluna, char peca) {
+  return mistura(((unsigned long long) linha << 32) |
+                 ((unsigned long long) coluna << 1) | (peca - '0'));
+}
+
+// Número do jogador da vez: entra na chave quando é a vez do BRANCO.
+const unsigned long long CHAVE_VEZ = 0xD1B54A32D192ED03ULL;
+
+// Número do tamanho do tabuleiro: entra em toda chave, para que as
+// mesmas peças em tabuleiros de tamanhos diferentes (que o servidor e
+// o lote buscam com a mesma tabela) não deem a mesma chave. Não pode
+// entrar nos números das casas: ele se cancelaria com um número par
+// de peças.
+inline unsigned long long chave_tamanho(int tam) {
+  return mistura(0x7A3ULL << 32 | tam);
+}
+
+// Calcula a chave de uma posição do zero.
+unsigned long long chave_zobrist(char jogador, std::string **tabuleiro);
+
+// Uma entrada guarda o ganho de uma posição buscada até *nivel* (exato
+// ou um limite, conforme *tipo*), com a melhor jogada encontrada
+// (linha -1 se não houver). É a forma em que as entradas saem da
+// tabela; dentro dela, ficam compactadas (veja *CasaTT*).
+struct EntradaTT {
+  unsigned long long chave;
+  float ganho;
+  short nivel;
+  short linha, coluna;
+  char tipo;
+};
+
+// Tipos de entrada: com a poda alfa-beta, o ganho guardado pode ser
+// exato ou apenas um limite (veja *minimax()* em reversi.cpp).
+const char TT_EXATO = 0;
+const char TT_INFERIOR = 1;   // ganho >= guardado
+const char TT_SUPERIOR = 2;   // ganho <= guardado
+
+// Contadores das consultas feitas pela *thread* atual (em qualquer
+// tabela). *substituicoes* conta as vezes em que guardar uma posição
+// descartou outra (uma colisão no balde).
+struct ContadoresTT {
+  unsigned long long consultas, acertos, guardas, substituicoes;
+};
+
+extern thread_local ContadoresTT contadores_tt;
+
+// Uma entrada compactada em 64 bits (*dados*): o ganho (32 bits), o
+// nível (7, saturado em 127), a linha e a coluna da jogada (9 cada, 0
+// sem jogada: tabuleiros de até 511x511), o tipo (2) e a geração em
+// que foi guardada (5). A chave
+// fica em *verificacao*, em XOR com os dados: as duas palavras são
+// escritas sem trava, e uma leitura que pegue metade de uma escrita e
+// metade de outra não confere com a chave e vale como ausente.
+struct CasaTT {
+  std::atomic<unsigned long long> verificacao, dados;
+};
+
+// Um balde ocupa exatamente uma linha de cache: a consulta de uma
+// posição lê uma só linha da memória, qualquer que seja a casa.
+const int CASAS_BALDE = 4;
+
+struct alignas(64) BaldeTT {
+  CasaTT casas[CASAS_BALDE];
+};
+
+static_assert(sizeof(BaldeTT) == 64, "o balde deve ocupar uma linha de cache");
+
+// O balde é escolhido pelos bits baixos da chave, e a posição pode
+// estar em qualquer uma das suas casas. Ao guardar, a posição
+// substitui a si mesma ou, se não estiver no balde, a casa vazia ou a
+// menos valiosa: a de menor nível, descontadas as gerações passadas
+// desde que foi guardada (as entradas de buscas antigas saem antes).
+//
+// A tabela pode ser compartilhada por várias *threads* sem travas
+// (veja *CasaTT*); uma escrita concorrente pode, no máximo, perder
+// uma das entradas.
+//
+// As casas são zeradas no construtor, então as páginas da tabela
+// ficam no nó NUMA da *thread* que a cria (veja afinidade.h).
+class TabelaTransposicao {
+
+  BaldeTT *_baldes;
+  size_t _mascara;
+  std::atomic<unsigned> _geracao;
+
+  TabelaTransposicao(const TabelaTransposicao &);
+  TabelaTransposicao &operator=(const TabelaTransposicao &);
+
+public:
+
+  // Cria uma tabela de até *megabytes* MB (arredondado para baixo até
+  // uma potência de 2 de baldes). Com *paginas_grandes*, a tabela é
+  // alinhada a 2 MB e pede ao sistema páginas grandes (*transparent
+  // huge pages*): numa tabela de centenas de MB, consultas aleatórias
+  // com páginas de 4 KB erram quase sempre a TLB.
+  TabelaTransposicao(size_t megabytes, bool paginas_grandes = false);
+  ~TabelaTransposicao();
+
+  // Procura a posição; se estiver na tabela, copia a entrada para *e*.
+  bool busca(unsigned long long chave, EntradaTT *e) {
+    const BaldeTT &balde = _baldes[chave & _mascara];
+    unsigned long long dados;
+    unsigned bits;
+    int i;
+    PERFIL_ESCOPO(PERFIL_TABELA);
+
+    contadores_tt.consultas++;
+    for (i=0; i<CASAS_BALDE; i++) {
+      dados = balde.casas[i].dados.load(std::memory_order_relaxed);
+      if ((balde.casas[i].verificacao.load(std::memory_order_relaxed) ^
+           dados) == chave && (dados >> 32 & 0x7F) != 0) {
+        bits = (unsigned) dados;
+        memcpy(&e->ganho, &bits, sizeof(bits));
+        e->chave = chave;
+        e->nivel = dados >> 32 & 0x7F;
+        e->linha = dados >> 39 & 0x1FF;
+        e->coluna = dados >> 48 & 0x1FF;
+        if (e->linha == 0) {
+          e->linha = e->coluna = -1;
+        }
+        e->tipo = dados >> 57 & 3;
+        contadores_tt.acertos++;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void guarda(unsigned long long chave, int nivel, float ganho, char tipo,
+              int linha, int coluna);
+
+  // Traz o balde da posição para o cache, sem esperar: chamada assim
+  // que a chave de um filho é conhecida, a leitura da memória corre
+  // junto com o resto do trabalho até a consulta.
+  void antecipa(unsigned long long chave) const {
+    __builtin_prefetch(&_baldes[chave & _mascara]);
+  }
+
+  // Começa uma nova geração (uma nova busca): as entradas guardadas
+  // até aqui passam a ser substituídas primeiro.
+  void nova_geracao() {
+    _geracao.store((_geracao.load(std::memory_order_relaxed) + 1) & 31,
+                   std::memory_order_relaxed);
+  }
+
+  // Esvazia a tabela (por exemplo, em um novo jogo).
+  void limpa();
+
+  // Quantidade de entradas (casas) da tabela.
+  size_t entradas() const { return (_mascara + 1) * CASAS_BALDE; }
+
+};
+
+// Tamanho padrão das tabelas do programa principal e do servidor.
+const size_t TAM_TABELA_PADRAO = 16;
+
+#endif /* _TRANSPOSICAO_H_ */
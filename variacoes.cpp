@@ -0,0 +1,413 @@
+//// Variações principais (multi-PV) //////////////////////////////////////////
+
+// Veja variacoes.h.
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "variacoes.h"
+#include "fronteira.h"
+#include "metricas.h"
+#include "registro.h"
+
+// Meia largura da janela de aspiração, em peças.
+static const float JANELA_ASPIRACAO = 2;
+
+// Uma jogada da raiz durante a busca, com o resultado da última
+// profundidade: o ganho exato ou, se a jogada só foi testada contra o
+// limiar, um limite superior. Como a avaliação conta peças, o ganho
+// oscila entre os níveis pares e os ímpares (quem joga por último
+// leva vantagem), então a janela de aspiração fica em volta do último
+// ganho exato de mesma paridade (*aspiracao*), não do anterior.
+struct JogadaRaiz {
+  Posicao pos;
+  float ganho;
+  bool exato;
+  float aspiracao[2];
+  bool com_aspiracao[2];
+};
+
+//// Threads da raiz //////////////////////////////////////////////////////////
+
+// As *threads* que buscam as jogadas da raiz vivem enquanto durar a
+// busca (a arena e a fronteira de cada uma ficam aquecidas de uma
+// fase para a outra). A *thread* que chamou é a de número 0 e busca
+// no próprio tabuleiro; cada uma das outras tem uma cópia dele e
+// espera a próxima fase.
+class EquipeRaiz {
+
+  string **_tabuleiro;
+  TabelaTransposicao *_tabela;
+  vector<string **> _copias;
+  mutex _mutex;
+  condition_variable _cv;
+  function<void (string **)> _tarefa;
+  int _fase, _ativas;
+  bool _encerrar;
+  unsigned long long _nos;   // das outras *threads*, até a última fase
+  ContadoresTT _contadores;  // das outras *threads*, a repassar à 0
+  vector<thread> _threads;
+
+  void trabalha(int t);
+
+public:
+
+  EquipeRaiz(int threads, string **tabuleiro, TabelaTransposicao *tabela);
+  ~EquipeRaiz();
+
+  EquipeRaiz(const EquipeRaiz &) = delete;
+  EquipeRaiz &operator=(const EquipeRaiz &) = delete;
+
+  // Roda a *tarefa* em todas as *threads* (com o tabuleiro de cada uma)
+  // e espera todas terminarem.
+  void executa(function<void (string **)> tarefa);
+
+  // Nós visitados pelas outras *threads* desde o início.
+  unsigned long long nos() const { return _nos; }
+
+};
+
+EquipeRaiz::EquipeRaiz(int threads, string **tabuleiro,
+                       TabelaTransposicao *tabela)
+  : _tabuleiro(tabuleiro), _tabela(tabela), _fase(0), _ativas(0),
+    _encerrar(false), _nos(0), _contadores() {
+  int t;
+
+  // As cópias são feitas aqui, antes que a *thread* 0 comece a jogar e
+  // desfazer jogadas no tabuleiro original.
+  for (t=1; t<threads; t++) {
+    _copias.push_back(copia_tabuleiro(tabuleiro));
+  }
+  for (t=1; t<threads; t++) {
+    _threads.push_back(thread(&EquipeRaiz::trabalha, this, t));
+  }
+}
+
+EquipeRaiz::~EquipeRaiz() {
+  size_t t;
+
+  {
+    lock_guard<mutex> trava(_mutex);
+    _encerrar = true;
+  }
+  _cv.notify_all();
+  for (t=0; t<_threads.size(); t++) {
+    _threads[t].join();
+    libera_tabuleiro(_copias[t]);
+  }
+}
+
+void EquipeRaiz::trabalha(int t) {
+  string **tabuleiro = _copias[t - 1];
+  EscopoFronteira fronteira(tabuleiro);
+  unsigned long long nos;
+  int fase = 0;
+
+  tabela_busca = _tabela;
+  while (true) {
+    {
+      unique_lock<mutex> trava(_mutex);
+      while (_fase == fase && !_encerrar) {
+        _cv.wait(trava);
+      }
+      if (_encerrar) {
+        break;
+      }
+      fase = _fase;
+    }
+    nos = nos_visitados;
+    _tarefa(tabuleiro);
+    {
+      lock_guard<mutex> trava(_mutex);
+      _nos += nos_visitados - nos;
+      _contadores.consultas += contadores_tt.consultas;
+      _contadores.acertos += contadores_tt.acertos;
+      _contadores.guardas += contadores_tt.guardas;
+      _contadores.substituicoes += contadores_tt.substituicoes;
+      contadores_tt = ContadoresTT();
+      if (--_ativas == 0) {
+        _cv.notify_all();
+      }
+    }
+  }
+  tabela_busca = NULL;
+}
+
+void EquipeRaiz::executa(function<void (string **)> tarefa) {
+  {
+    lock_guard<mutex> trava(_mutex);
+    _tarefa = tarefa;
+    _ativas = _threads.size();
+    _fase++;
+  }
+  _cv.notify_all();
+  tarefa(_tabuleiro);
+
+  unique_lock<mutex> trava(_mutex);
+  while (_ativas > 0) {
+    _cv.wait(trava);
+  }
+  contadores_tt.consultas += _contadores.consultas;
+  contadores_tt.acertos += _contadores.acertos;
+  contadores_tt.guardas += _contadores.guardas;
+  contadores_tt.substituicoes += _contadores.substituicoes;
+  _contadores = ContadoresTT();
+}
+
+//// Busca ////////////////////////////////////////////////////////////////////
+
+// Ganho da jogada *pos* da raiz, buscando a posição depois dela com a
+// janela (*alfa*, *beta*) do ponto de vista de quem joga na raiz.
+static float busca_raiz(char jogador, string **tabuleiro, Posicao pos,
+                        int nivel, unsigned long long chave, float alfa,
+                        float beta) {
+  Arena::Marca marca = arena_busca.marca();
+  Desfazer desfazer;
+  float valor;
+
+  executa(&pos, jogador, tabuleiro, &desfazer);
+  valor = -minimax('0' + (jogador + 1) % 2, tabuleiro, nivel - 1,
+                   chave ^ desfazer.chave ^ CHAVE_VEZ, -beta, -alfa).ganho;
+  desfaz(&desfazer, tabuleiro);
+  arena_busca.volta(marca);
+  return valor;
+}
+
+// Ganho exato de uma jogada, dentro de (*alfa*, *beta*) e, se houver,
+// da janela de aspiração. Se o ganho sair da janela, abrimos o lado em
+// que ele saiu.
+static float busca_exata(char jogador, string **tabuleiro, JogadaRaiz &j,
+                         int nivel, unsigned long long chave, float alfa,
+                         float beta, Controle *controle) {
+  float valor;
+
+  if (j.com_aspiracao[nivel % 2]) {
+    alfa = max(alfa, j.aspiracao[nivel % 2] - JANELA_ASPIRACAO);
+    beta = min(beta, j.aspiracao[nivel % 2] + JANELA_ASPIRACAO);
+  }
+  while (true) {
+    valor = busca_raiz(jogador, tabuleiro, j.pos, nivel, chave, alfa, beta);
+    if (controle != NULL && controle->parar.load()) {
+      return valor;
+    }
+    if (valor <= alfa && alfa > -INFINITO) {
+      alfa = -INFINITO;
+    } else if (valor >= beta && beta < INFINITO) {
+      beta = INFINITO;
+    } else {
+      j.aspiracao[nivel % 2] = valor;
+      j.com_aspiracao[nivel % 2] = true;
+      return valor;
+    }
+  }
+}
+
+// Variação principal da jogada *pos*: seguimos, na tabela, as jogadas
+// guardadas a partir da posição depois dela, até *nivel* jogadas (uma
+// jogada da tabela só é aceita se for válida na posição). O tabuleiro
+// volta ao que era.
+static vector<Posicao> variacao(char jogador, string **tabuleiro,
+                                Posicao pos, int nivel,
+                                TabelaTransposicao *tabela) {
+  int tam = (*tabuleiro[0]).size() - 2;
+  vector<Posicao> jogadas(1, pos);
+  vector<Desfazer> feitas(1);
+  char vez = '0' + (jogador + 1) % 2;
+  EntradaTT entrada;
+  int i;
+
+  executa(&pos, jogador, tabuleiro, &feitas[0]);
+  while ((int) jogadas.size() < nivel &&
+         busca_tabela(tabela, vez, tabuleiro, &entrada)) {
+    pos.linha = entrada.linha;
+    pos.coluna = entrada.coluna;
+    if (pos.linha == -1) {
+      // Passada de vez, se o jogador da vez não tiver jogada mas o
+      // outro tiver.
+      if (tem_jogada(vez, tabuleiro) ||
+          !tem_jogada('0' + (vez + 1) % 2, tabuleiro)) {
+        break;
+      }
+      jogadas.push_back(POS_NULA);
+    } else {
+      if (pos.linha < 1 || pos.linha > tam || pos.coluna < 1 ||
+          pos.coluna > tam || !pos_valida(&pos, vez, tabuleiro)) {
+        break;
+      }
+      feitas.push_back(Desfazer());
+      executa(&pos, vez, tabuleiro, &feitas.back());
+      jogadas.push_back(pos);
+    }
+    vez = '0' + (vez + 1) % 2;
+  }
+  for (i=feitas.size()-1; i>=0; i--) {
+    desfaz(&feitas[i], tabuleiro);
+  }
+  return jogadas;
+}
+
+// Aprofundamento iterativo sobre as jogadas da raiz (veja variacoes.h).
+ResultadoVariacoes busca_variacoes(
+  char jogador, string **tabuleiro, int nivel_max, int linhas, int threads,
+  Controle *controle,
+  function<void (const ResultadoVariacoes &)> a_cada_nivel) {
+  Relogio::time_point inicio = Relogio::now();
+  ContadoresTT tt = contadores_tt;
+  RegistroBusca *registro = registro_busca;
+  TabelaTransposicao *tabela = tabela_busca;
+  unique_ptr<TabelaTransposicao> propria;
+  unsigned long long chave = chave_zobrist(jogador, tabuleiro);
+  ResultadoVariacoes resultado, parcial;
+  vector<JogadaRaiz> jogadas;
+  vector<Posicao> jogaveis;
+  vector<float> melhores;
+  mutex mutex_limiar;
+  float limiar;
+  int nivel, k, i;
+  PERFIL_ESCOPO(PERFIL_JOGADA);
+  EscopoFronteira fronteira(tabuleiro);
+
+  // Sem jogada, o *aprofunda()* resolve a passada de vez (ou o fim).
+  jogaveis = pos_jogaveis(jogador, tabuleiro);
+  if (jogaveis.empty()) {
+    Resultado r = aprofunda(jogador, tabuleiro, nivel_max, controle,
+                            nullptr);
+    Variacao v = {POS_NULA, r.ganho, vector<Posicao>(1, POS_NULA)};
+
+    resultado.variacoes.push_back(v);
+    resultado.nivel = r.nivel;
+    resultado.nos = r.nos;
+    resultado.segundos = r.segundos;
+    if (a_cada_nivel) {
+      a_cada_nivel(resultado);
+    }
+    return resultado;
+  }
+
+  for (i=0; i<(int) jogaveis.size(); i++) {
+    JogadaRaiz j = {jogaveis[i], 0, false, {0, 0}, {false, false}};
+    jogadas.push_back(j);
+  }
+  k = linhas > 0 ? min(linhas, (int) jogadas.size()) : jogadas.size();
+  if (threads <= 0) {
+    threads = max(1u, thread::hardware_concurrency());
+  }
+  threads = min(threads, (int) jogadas.size());
+
+  if (tabela == NULL) {
+    propria.reset(new TabelaTransposicao(TAM_TABELA_PADRAO));
+    tabela = propria.get();
+    tabela_busca = tabela;
+  }
+  tabela->nova_geracao();
+  registro_busca = NULL;
+  nos_visitados = 0;
+  arena_busca.reinicia();
+  resultado.nivel = 0;
+
+  EquipeRaiz equipe(threads, tabuleiro, tabela);
+  for (nivel=1; nivel<=nivel_max; nivel++) {
+    Controle *c = nivel > 1 ? controle : NULL;
+    atomic<int> proxima(0);
+
+    // Primeira fase: as *k* primeiras jogadas (as melhores da
+    // profundidade anterior), com ganho exato.
+    equipe.executa([&](string **tab) {
+      int j;
+
+      controle_busca = c;
+      while ((j = proxima++) < k) {
+        jogadas[j].ganho = busca_exata(jogador, tab, jogadas[j], nivel,
+                                       chave, -INFINITO, INFINITO, c);
+        jogadas[j].exato = true;
+      }
+      controle_busca = NULL;
+    });
+    if (c != NULL && c->parar.load()) {
+      break;
+    }
+
+    // Segunda fase: as demais, testadas contra o limiar (o ganho da
+    // *k*-ésima melhor até agora).
+    melhores.clear();
+    for (i=0; i<k; i++) {
+      melhores.push_back(jogadas[i].ganho);
+    }
+    sort(melhores.begin(), melhores.end());
+    limiar = melhores[0];
+    proxima = k;
+    equipe.executa([&](string **tab) {
+      float l, valor;
+      int j;
+
+      controle_busca = c;
+      while ((j = proxima++) < (int) jogadas.size()) {
+        {
+          lock_guard<mutex> trava(mutex_limiar);
+          l = limiar;
+        }
+        valor = busca_raiz(jogador, tab, jogadas[j].pos, nivel, chave, l,
+                           l + 1);
+        jogadas[j].exato = false;
+        if (valor > l && !(c != NULL && c->parar.load())) {
+          valor = busca_exata(jogador, tab, jogadas[j], nivel, chave, l,
+                              INFINITO, c);
+          jogadas[j].exato = true;
+          lock_guard<mutex> trava(mutex_limiar);
+          if (valor > limiar) {
+            melhores[0] = valor;
+            sort(melhores.begin(), melhores.end());
+            limiar = melhores[0];
+          }
+        }
+        jogadas[j].ganho = valor;
+      }
+      controle_busca = NULL;
+    });
+    if (c != NULL && c->parar.load()) {
+      break;
+    }
+
+    // Ordenamos para a próxima profundidade (e para o resultado): os
+    // limites superiores nunca passam do limiar, então as *k* primeiras
+    // são as melhores exatas.
+    stable_sort(jogadas.begin(), jogadas.end(),
+                [](const JogadaRaiz &a, const JogadaRaiz &b) {
+                  return a.ganho > b.ganho ||
+                    (a.ganho == b.ganho && a.exato && !b.exato);
+                });
+    parcial.variacoes.clear();
+    for (i=0; i<k; i++) {
+      Variacao v = {jogadas[i].pos, jogadas[i].ganho,
+                    variacao(jogador, tabuleiro, jogadas[i].pos, nivel,
+                             tabela)};
+      parcial.variacoes.push_back(v);
+    }
+    parcial.nivel = nivel;
+    parcial.nos = nos_visitados + equipe.nos();
+    parcial.segundos =
+      chrono::duration<double>(Relogio::now() - inicio).count();
+    resultado = parcial;
+    if (a_cada_nivel) {
+      a_cada_nivel(resultado);
+    }
+  }
+
+  resultado.nos = nos_visitados + equipe.nos();
+  resultado.segundos =
+    chrono::duration<double>(Relogio::now() - inicio).count();
+  arena_busca.reinicia();
+  registro_busca = registro;
+  if (propria) {
+    tabela_busca = NULL;
+  }
+  if (metricas_motor != NULL) {
+    metricas_motor->registra(tabuleiro, resultado.segundos, resultado.nos,
+                             contadores_tt.consultas - tt.consultas,
+                             contadores_tt.acertos - tt.acertos);
+  }
+  return resultado;
+}
@@ -0,0 +1,68 @@
+#ifndef _VARIACOES_H_
+#define _VARIACOES_H_
+
+//// Variações principais (multi-PV) //////////////////////////////////////////
+
+// Para a análise, não basta a melhor jogada: queremos o ganho de todas
+// as jogadas da posição (ou das *K* melhores), cada uma com a sua
+// variação principal. *minimax()* chega a calcular um ganho por jogada
+// da raiz, mas com a janela da poda só o da melhor é exato.
+//
+// *busca_variacoes()* faz o aprofundamento iterativo buscando cada
+// jogada da raiz separadamente, em duas fases por profundidade:
+//
+// * as *K* jogadas que lideraram a profundidade anterior (todas, com
+//   *K* = 0) são buscadas com uma janela de aspiração em volta do seu
+//   último ganho exato de mesma paridade (a contagem de peças oscila
+//   entre os níveis pares e os ímpares); se o ganho sair da janela, o
+//   lado que falhou é aberto e a jogada é buscada de novo;
+// * as demais só precisam mostrar que não superam a *K*-ésima melhor
+//   até agora (o limiar): cada uma é testada com a janela nula no
+//   limiar e só é buscada por inteiro, entrando entre as *K*, se o
+//   superar.
+//
+// As jogadas de cada fase são repartidas entre *threads* (as da raiz
+// são independentes), da mais promissora para a menos, com uma só
+// tabela de transposição para todas (veja transposicao.h): a da
+// *thread* que chamou ou, sem ela, uma criada para a busca. A variação
+// de cada jogada sai da tabela, seguindo as jogadas guardadas a partir
+// da posição depois dela.
+//
+// Como no *aprofunda()*, a primeira profundidade nunca é interrompida
+// e o resultado é o da última profundidade completada. O limite de nós
+// do controle vale para cada *thread*. Com mais de uma *thread*, ou
+// com a tabela já usada, o ganho de uma jogada pode vir de uma busca
+// mais funda guardada na tabela, e os nós variam de uma execução para
+// outra.
+
+#include <functional>
+#include <vector>
+
+#include "reversi.h"
+
+// Uma jogada da raiz: o seu ganho exato e a variação principal (a
+// própria jogada seguida das respostas previstas; POS_NULA é uma
+// passada de vez).
+struct Variacao {
+  Posicao pos;
+  float ganho;
+  vector<Posicao> jogadas;
+};
+
+struct ResultadoVariacoes {
+  vector<Variacao> variacoes;  // da melhor para a pior
+  int nivel;
+  unsigned long long nos;      // de todas as *threads*
+  double segundos;
+};
+
+// Busca as *linhas* melhores jogadas (0: todas) até *nivel_max*, com
+// *threads* *threads* (0: uma por núcleo), chamando *a_cada_nivel* a
+// cada profundidade completada. Sem jogada, a única variação é a
+// passada de vez (ou o fim de jogo), com o ganho do *aprofunda()*.
+ResultadoVariacoes busca_variacoes(
+  char jogador, string **tabuleiro, int nivel_max, int linhas, int threads,
+  Controle *controle,
+  function<void (const ResultadoVariacoes &)> a_cada_nivel);
+
+#endif /* _VARIACOES_H_ */